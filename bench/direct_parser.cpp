@@ -0,0 +1,110 @@
+#include <chrono>
+#include <iostream>
+#include <tuple>
+
+#include "./synthetic_grammar.h"
+
+// generated at build time by emit_bench_parser
+#include "synthetic_parser.h"
+
+
+using namespace bench;
+
+using std::cout;
+using std::endl;
+
+
+// must be the arguments of emit_bench_parser in meson.build
+static const int NONTERMINAL_COUNT = 16;
+static const int RULE_COUNT = 4;
+
+static const unsigned int CORPUS_SEED = 20240601;
+static const int SENTENCE_COUNT = 64;
+static const int SENTENCE_LENGTH = 512;
+static const int PARSE_REPEAT = 8;
+
+
+using Clock = std::chrono::steady_clock;
+
+static double _ms (Clock::time_point begin, Clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+// symbols are different objects, so nodes are matched by name
+static void _flatten (const Node &root, vector<std::tuple<string, int, const Token*>> &result) {
+  result.clear();
+  NodeWalker walker;
+  walker.walk(root, [&result](const Node &node, int) {
+    result.push_back({ node.termnon()->name, node.reduced_rule_idx(), node.token() });
+    return true;
+  });
+}
+
+// table driver and generated parser on the same corpus
+int main () {
+  SyntheticGrammar grammar(NONTERMINAL_COUNT, RULE_COUNT);
+  ParsingTableGenerator generator;
+  grammar.addSymbols(generator);
+  auto table = generator.generateTable();
+  if (table == null)
+    return 1;
+
+  SyntheticParser parser;
+  if (SyntheticParser::STATE_COUNT != table->state_count()
+      || SyntheticParser::RULE_COUNT != table->rule_count()) {
+    cout << "err: generated parser is not made from this grammar" << endl;
+    return 1;
+  }
+
+  auto corpus = grammar.makeCorpus(CORPUS_SEED, SENTENCE_COUNT, SENTENCE_LENGTH);
+  size_t token_count = 0;
+  for (auto &tokens : corpus)
+    token_count += tokens.size();
+
+  // same trees, otherwise numbers mean nothing
+  vector<std::tuple<string, int, const Token*>> table_nodes, direct_nodes;
+  for (auto &tokens : corpus) {
+    auto table_tree = table->generateParseTree("", tokens);
+    auto direct_tree = parser.parse(tokens);
+    if (table_tree == null || direct_tree == null) {
+      cout << "err: synthetic sentence is not accepted" << endl;
+      return 1;
+    }
+    _flatten(*table_tree, table_nodes);
+    _flatten(*direct_tree, direct_nodes);
+    if (table_nodes != direct_nodes) {
+      cout << "err: generated parser makes a different tree" << endl;
+      return 1;
+    }
+  }
+
+  auto table_begin = Clock::now();
+  for (int ri=0; ri<PARSE_REPEAT; ++ri) {
+    for (auto &tokens : corpus)
+      table->generateParseTree("", tokens);
+  }
+  auto table_end = Clock::now();
+
+  auto direct_begin = Clock::now();
+  for (int ri=0; ri<PARSE_REPEAT; ++ri) {
+    for (auto &tokens : corpus)
+      parser.parse(tokens);
+  }
+  auto direct_end = Clock::now();
+
+  auto parsed_tokens = (double)token_count * PARSE_REPEAT;
+  auto table_ns = _ms(table_begin, table_end) * 1e6 / parsed_tokens;
+  auto direct_ns = _ms(direct_begin, direct_end) * 1e6 / parsed_tokens;
+
+  cout << "{" << endl
+      << "  \"nonterminals\": " << NONTERMINAL_COUNT << "," << endl
+      << "  \"rules_per_nonterminal\": " << RULE_COUNT << "," << endl
+      << "  \"states\": " << table->state_count() << "," << endl
+      << "  \"corpus_tokens\": " << token_count << "," << endl
+      << "  \"table_parse_ns_per_token\": " << table_ns << "," << endl
+      << "  \"direct_parse_ns_per_token\": " << direct_ns << "," << endl
+      << "  \"speedup\": " << table_ns / direct_ns << endl
+      << "}" << endl;
+
+  return 0;
+}
@@ -0,0 +1,40 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "./synthetic_grammar.h"
+
+
+using namespace bench;
+
+using std::cout;
+using std::endl;
+
+
+// writes the direct-coded parser of a synthetic grammar to a header.
+// usage: emit_bench_parser <output> <nonterminal_count> <rule_count>
+int main (int argc, char *argv[]) {
+  if (argc < 4) {
+    cout << "usage: " << argv[0] << " <output> <nonterminal_count> <rule_count>" << endl;
+    return 1;
+  }
+
+  SyntheticGrammar grammar(std::atoi(argv[2]), std::atoi(argv[3]));
+  ParsingTableGenerator generator;
+  grammar.addSymbols(generator);
+  auto table = generator.generateTable();
+  if (table == null)
+    return 1;
+
+  auto source = table->toCppSource("SyntheticParser");
+  if (source.empty() == true)
+    return 1;
+
+  std::ofstream os(argv[1], std::ofstream::trunc);
+  os << source;
+  if (os.good() == false) {
+    cout << "err: cannot write \'" << argv[1] << "\'" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,523 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "../src/green_tree.h"
+#include "../src/parse_tree_cache.h"
+#include "../src/parsing_table_cache.h"
+#include "../test/alloc_counter.h"
+#include "./synthetic_grammar.h"
+
+
+using namespace bench;
+
+using std::cout;
+using std::endl;
+
+
+static const unsigned int CORPUS_SEED = 20240601;
+static const int SENTENCE_COUNT = 64;
+static const int SENTENCE_LENGTH = 512;
+static const int PARSE_REPEAT = 4;
+static const int PIPELINE_LENGTH = 200000;
+static const int CONFIG_KEY_COUNT = 4000;
+static const int CONFIG_NESTED_COUNT = 50;
+
+
+using Clock = std::chrono::steady_clock;
+
+static double _ms (Clock::time_point begin, Clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+
+// text of a sentence, terminal names separated by spaces
+static string _makeText (const SyntheticGrammar &grammar, const vector<Token> &tokens) {
+  string text;
+  for (auto &t : tokens) {
+    if (t.type == 0)
+      break;
+    text += grammar.terminal_name(t.type);
+    text += ' ';
+  }
+  return text;
+}
+
+// splits text on spaces and finds types by name, so lexing costs like a real lexer
+class NameLexer {
+public:
+  NameLexer (const SyntheticGrammar &grammar) {
+    for (int type=1; type<grammar.token_type_count(); ++type)
+      types_[grammar.terminal_name(type)] = type;
+  }
+
+  // push(token) is false to stop
+  template <class Push>
+  void lex (const string &text, Push &&push) const {
+    int begin = 0;
+    for (int ci=0; ci<text.size(); ++ci) {
+      if (text[ci] != ' ')
+        continue;
+      auto itr = types_.find(std::string_view(text.data() + begin, ci - begin));
+      if (push(Token((itr == types_.end())? -1: itr->second, begin, ci - 1, 0, 0, 0)) == false)
+        return;
+      begin = ci + 1;
+    }
+    push(Token(0, text.size(), text.size(), 0, 0, 0));
+  }
+
+private:
+  std::unordered_map<std::string_view, int> types_;  // views of names in grammar
+};
+
+static double _nsPerToken (Clock::time_point begin, Clock::time_point end, double token_count) {
+  return _ms(begin, end) * 1e6 / token_count;
+}
+
+// the helpers below measure one feature each and write its fields of the
+// grammar's json object, each line ending with a comma
+
+static bool _benchGeneration (const SyntheticGrammar &grammar, ParsingTableGenerator &generator, shared_ptr<ParsingTable> &table) {
+  grammar.addSymbols(generator);
+
+  size_t alloc_begin = g_alloc_count;
+  auto gen_begin = Clock::now();
+  table = generator.generateTable();
+  auto gen_end = Clock::now();
+  auto gen_allocs = g_alloc_count - alloc_begin;
+  if (table == null) {
+    cout << "err: table is not generated" << endl;
+    return false;
+  }
+
+  auto &gen_stats = generator.stats();
+  cout << "      \"generation_ms\": " << _ms(gen_begin, gen_end) << "," << endl
+      << "      \"generation_allocs\": " << gen_allocs << "," << endl
+      << "      \"generation_phases_ms\": { "
+          << "\"first\": " << gen_stats.first_ms << ", "
+          << "\"closure\": " << gen_stats.closure_ms << ", "
+          << "\"discovery\": " << gen_stats.discovery_ms << ", "
+          << "\"merge\": " << gen_stats.merge_ms << ", "
+          << "\"table\": " << gen_stats.table_ms << " }," << endl
+      << "      \"lr1_states\": " << gen_stats.lr1_state_count << "," << endl
+      << "      \"lalr_states\": " << gen_stats.lalr_state_count << "," << endl
+      << "      \"conflicts\": " << gen_stats.conflict_count << "," << endl
+      << "      \"configs\": " << gen_stats.config_count << "," << endl
+      << "      \"lookahead_unions\": " << gen_stats.lookahead_union_count << "," << endl;
+  return true;
+}
+
+static bool _benchSaveLoad (ParsingTable &table, shared_ptr<ParsingTable> &loaded) {
+  vector<unsigned char> data;
+  auto save_begin = Clock::now();
+  table.saveBinary(data);
+  auto save_end = Clock::now();
+
+  auto load_begin = Clock::now();
+  loaded = make_shared<ParsingTable>(data);
+  auto load_end = Clock::now();
+  if (loaded->state_count() != table.state_count()) {
+    cout << "err: saved table is not loaded" << endl;
+    return false;
+  }
+
+  TableSize table_size, minimized_size;
+  loaded->minimizeStates(&table_size, &minimized_size);
+
+  cout << "      \"table_bytes\": " << data.size() << "," << endl
+      << "      \"save_ms\": " << _ms(save_begin, save_end) << "," << endl
+      << "      \"load_ms\": " << _ms(load_begin, load_end) << "," << endl
+      << "      \"minimized_states\": " << minimized_size.state_count << "," << endl
+      << "      \"table_cells\": " << table_size.cell_count << "," << endl;
+  return true;
+}
+
+// cold start from the cache: fingerprint, file read and load
+static bool _benchCache (ParsingTableGenerator &generator, ParsingTable &table) {
+  auto cache_dir = (std::filesystem::temp_directory_path() / "bench_lalr_parsergen_cache").string();
+  ParsingTableCache cache(cache_dir);
+  cache.store(generator.fingerprint(), table);
+  auto cache_begin = Clock::now();
+  auto cached = cache.generateTable(generator);
+  auto cache_end = Clock::now();
+  std::filesystem::remove_all(cache_dir);
+  if (cached == null || cache.hit_count() != 1) {
+    cout << "err: cached table is not loaded" << endl;
+    return false;
+  }
+
+  cout << "      \"cache_hit_ms\": " << _ms(cache_begin, cache_end) << "," << endl;
+  return true;
+}
+
+// every N_i as an entry of one table, against one table per N_i
+static bool _benchEntries (const SyntheticGrammar &grammar, const vector<vector<Token>> &corpus) {
+  ParsingTableGenerator entry_generator;
+  grammar.addSymbols(entry_generator);
+  grammar.addEntrySymbols(entry_generator);
+  auto entry_begin = Clock::now();
+  auto entry_table = entry_generator.generateTable();
+  auto entry_end = Clock::now();
+  vector<unsigned char> entry_data;
+  if (entry_table == null || entry_table->saveBinary(entry_data) == false) {
+    cout << "err: entry table is not generated" << endl;
+    return false;
+  }
+  for (auto &tokens : corpus) {
+    if (entry_table->generateEntryParseTree("N_0", "", tokens) == null) {
+      cout << "err: synthetic sentence is not accepted from entry N_0" << endl;
+      return false;
+    }
+  }
+
+  double separate_ms = 0;
+  size_t separate_bytes = 0;
+  int separate_states = 0;
+  for (int ni=0; ni<grammar.nonterminal_count(); ++ni) {
+    ParsingTableGenerator separate_generator;
+    grammar.addSymbols(separate_generator, ni);
+    auto separate_begin = Clock::now();
+    auto separate_table = separate_generator.generateTable();
+    separate_ms += _ms(separate_begin, Clock::now());
+    vector<unsigned char> separate_data;
+    separate_table->saveBinary(separate_data);
+    separate_bytes += separate_data.size();
+    separate_states += separate_table->state_count();
+  }
+
+  cout << "      \"entries\": " << grammar.nonterminal_count() << "," << endl
+      << "      \"entry_table_states\": " << entry_table->state_count() << "," << endl
+      << "      \"entry_table_bytes\": " << entry_data.size() << "," << endl
+      << "      \"entry_generation_ms\": " << _ms(entry_begin, entry_end) << "," << endl
+      << "      \"separate_table_states\": " << separate_states << "," << endl
+      << "      \"separate_table_bytes\": " << separate_bytes << "," << endl
+      << "      \"separate_generation_ms\": " << separate_ms << "," << endl;
+  return true;
+}
+
+static void _benchParse (ParsingTable &table, const vector<vector<Token>> &corpus, double parsed_tokens) {
+  size_t alloc_begin = g_alloc_count;
+  auto parse_begin = Clock::now();
+  for (int ri=0; ri<PARSE_REPEAT; ++ri) {
+    for (auto &tokens : corpus)
+      table.generateParseTree("", tokens);
+  }
+  auto parse_end = Clock::now();
+  auto parse_allocs = g_alloc_count - alloc_begin;
+
+  cout << "      \"parse_ns_per_token\": " << _nsPerToken(parse_begin, parse_end, parsed_tokens) << "," << endl
+      << "      \"parse_allocs_per_token\": " << parse_allocs / parsed_tokens << "," << endl;
+}
+
+// warm context, nodes and stack reused between parses
+static void _benchContext (ParsingTable &table, const vector<vector<Token>> &corpus, double parsed_tokens) {
+  ParseContext context;
+  for (auto &tokens : corpus)
+    table.generateParseTree("", tokens, context);
+
+  size_t alloc_begin = g_alloc_count;
+  auto context_begin = Clock::now();
+  for (int ri=0; ri<PARSE_REPEAT; ++ri) {
+    for (auto &tokens : corpus)
+      table.generateParseTree("", tokens, context);
+  }
+  auto context_end = Clock::now();
+  auto context_allocs = g_alloc_count - alloc_begin;
+
+  cout << "      \"context_parse_ns_per_token\": " << _nsPerToken(context_begin, context_end, parsed_tokens) << "," << endl
+      << "      \"context_parse_allocs\": " << context_allocs << "," << endl;
+}
+
+// one big input, lexed then parsed, and lexed while parsed
+static bool _benchPipeline (const SyntheticGrammar &grammar, ParsingTable &table) {
+  std::mt19937 rng(CORPUS_SEED);
+  vector<Token> big_tokens;
+  grammar.makeLongSentence(rng, PIPELINE_LENGTH, big_tokens);
+  auto big_text = _makeText(grammar, big_tokens);
+  NameLexer lexer(grammar);
+
+  vector<Token> lexed;
+  lexed.reserve(big_tokens.size());
+  auto push_lexed = [&lexed](const Token &t) { lexed.push_back(t); return true; };
+  ParseContext big_context;
+  lexer.lex(big_text, push_lexed);
+  table.generateParseTree(big_text.c_str(), lexed, big_context);
+
+  lexed.clear();
+  auto serial_begin = Clock::now();
+  lexer.lex(big_text, push_lexed);
+  auto lex_end = Clock::now();
+  auto serial_tree = table.generateParseTree(big_text.c_str(), lexed, big_context);
+  auto serial_end = Clock::now();
+
+  // warmed like the serial one
+  TokenStream stream;
+  auto lex_stream = [&lexer, &big_text](TokenStream &out) {
+    lexer.lex(big_text, [&out](const Token &t) { return out.push(t); });
+  };
+  table.generateParseTreePipelined(big_text.c_str(), lex_stream, stream, big_context);
+
+  auto pipelined_begin = Clock::now();
+  auto pipelined_tree = table.generateParseTreePipelined(big_text.c_str(), lex_stream, stream, big_context);
+  auto pipelined_end = Clock::now();
+  if (serial_tree == null || pipelined_tree == null) {
+    cout << "err: big sentence is not accepted" << endl;
+    return false;
+  }
+
+  cout << "      \"pipeline_tokens\": " << lexed.size() << "," << endl
+      << "      \"lex_ms\": " << _ms(serial_begin, lex_end) << "," << endl
+      << "      \"serial_lex_parse_ms\": " << _ms(serial_begin, serial_end) << "," << endl
+      << "      \"pipelined_lex_parse_ms\": " << _ms(pipelined_begin, pipelined_end) << "," << endl;
+  return true;
+}
+
+// profile-guided state order
+static bool _benchReorder (ParsingTable &table, const vector<vector<Token>> &corpus, double parsed_tokens) {
+  ParseStats stats;
+  for (auto &tokens : corpus)
+    table.generateParseTree("", tokens, stats);
+  auto reordered = table.renumberStates(stats.layoutOrder(table.state_count()));
+  if (reordered == null || reordered->isEquivalent(table) == false) {
+    cout << "err: reordered table is not equivalent" << endl;
+    return false;
+  }
+
+  auto reordered_begin = Clock::now();
+  for (int ri=0; ri<PARSE_REPEAT; ++ri) {
+    for (auto &tokens : corpus)
+      reordered->generateParseTree("", tokens);
+  }
+  auto reordered_end = Clock::now();
+
+  cout << "      \"max_stack_depth\": " << stats.max_stack_depth() << "," << endl
+      << "      \"reordered_parse_ns_per_token\": " << _nsPerToken(reordered_begin, reordered_end, parsed_tokens) << "," << endl;
+  return true;
+}
+
+// glr driver stays on its deterministic loop for a conflict-free table
+static void _benchForest (ParsingTable &table, const vector<vector<Token>> &corpus, double parsed_tokens) {
+  auto forest_begin = Clock::now();
+  for (int ri=0; ri<PARSE_REPEAT; ++ri) {
+    for (auto &tokens : corpus)
+      table.generateParseForest("", tokens);
+  }
+  auto forest_end = Clock::now();
+
+  cout << "      \"forest_parse_ns_per_token\": " << _nsPerToken(forest_begin, forest_end, parsed_tokens) << "," << endl;
+}
+
+// soa tokens, built once like a lexer would
+static void _benchTokenBuffer (ParsingTable &table, const vector<vector<Token>> &corpus, double parsed_tokens) {
+  vector<TokenBuffer> buffers(corpus.size(), TokenBuffer(false));
+  for (int si=0; si<corpus.size(); ++si) {
+    buffers[si].reserve(corpus[si].size());
+    for (auto &t : corpus[si])
+      buffers[si].push(t);
+  }
+
+  auto buffer_begin = Clock::now();
+  for (int ri=0; ri<PARSE_REPEAT; ++ri) {
+    for (auto &buffer : buffers)
+      table.generateParseTree("", buffer);
+  }
+  auto buffer_end = Clock::now();
+
+  cout << "      \"token_buffer_parse_ns_per_token\": " << _nsPerToken(buffer_begin, buffer_end, parsed_tokens) << "," << endl;
+}
+
+// one json object per grammar size
+static bool _benchGrammar (int nonterminal_count, int rule_count, bool is_first) {
+  SyntheticGrammar grammar(nonterminal_count, rule_count);
+
+  cout << (is_first ? "" : ",") << endl
+      << "    {" << endl
+      << "      \"nonterminals\": " << grammar.nonterminal_count() << "," << endl
+      << "      \"rules_per_nonterminal\": " << grammar.rule_count() << "," << endl
+      << "      \"token_types\": " << grammar.token_type_count() << "," << endl;
+
+  ParsingTableGenerator generator;
+  shared_ptr<ParsingTable> table, loaded;
+  if (_benchGeneration(grammar, generator, table) == false
+      || _benchSaveLoad(*table, loaded) == false
+      || _benchCache(generator, *table) == false)
+    return false;
+
+  auto corpus = grammar.makeCorpus(CORPUS_SEED, SENTENCE_COUNT, SENTENCE_LENGTH);
+  size_t token_count = 0;
+  for (auto &tokens : corpus)
+    token_count += tokens.size();
+  auto parsed_tokens = (double)token_count * PARSE_REPEAT;
+
+  // every sentence must be accepted, otherwise numbers mean nothing
+  for (auto &tokens : corpus) {
+    if (loaded->generateParseTree("", tokens) == null) {
+      cout << "err: synthetic sentence is not accepted" << endl;
+      return false;
+    }
+  }
+  cout << "      \"corpus_tokens\": " << token_count << "," << endl;
+
+  if (_benchEntries(grammar, corpus) == false)
+    return false;
+  _benchParse(*loaded, corpus, parsed_tokens);
+  _benchContext(*loaded, corpus, parsed_tokens);
+  if (_benchPipeline(grammar, *loaded) == false
+      || _benchReorder(*loaded, corpus, parsed_tokens) == false)
+    return false;
+  _benchForest(*loaded, corpus, parsed_tokens);
+  _benchTokenBuffer(*loaded, corpus, parsed_tokens);
+
+  cout << "      \"states\": " << loaded->state_count() << endl
+      << "    }";
+  return true;
+}
+
+// indentation-structured config, split at top-level keys and parsed on all cores
+static bool _benchParallel () {
+  auto term_key    = make_shared<Terminal>("key", 1);
+  auto term_colon  = make_shared<Terminal>("colon", 2);
+  auto term_value  = make_shared<Terminal>("value", 3);
+  auto term_nl     = make_shared<Terminal>("nl", 4);
+  auto term_indent = make_shared<Terminal>("indent", 5);
+  auto term_dedent = make_shared<Terminal>("dedent", 6);
+
+  auto start = make_shared<Nonterminal>("S");
+  auto non_map = make_shared<Nonterminal>("MAP");
+  auto non_kv = make_shared<Nonterminal>("KV");
+  start->rules.push_back(Rule(start, { non_map }));
+  non_map->rules.push_back(Rule(non_map, { non_kv, non_map }));
+  non_map->rules.push_back(Rule(non_map, { non_kv }));
+  non_kv->rules.push_back(Rule(non_kv, { term_key, term_colon, term_value, term_nl }));
+  non_kv->rules.push_back(Rule(non_kv, { term_key, term_colon, term_nl, term_indent, non_map, term_dedent }));
+
+  ParsingTableGenerator generator;
+  generator.addSymbol(start, true);
+  generator.addSymbol(non_map);
+  generator.addSymbol(non_kv);
+  auto table = generator.generateTable();
+
+  // only column matters for splitting, offsets are token idxs
+  vector<Token> tokens;
+  auto push = [&tokens](int type, unsigned int column) {
+    int idx = tokens.size();
+    tokens.push_back(Token(type, idx, idx, 0, column, 0));
+  };
+  for (int ki=0; ki<CONFIG_KEY_COUNT; ++ki) {
+    push(1, 0);
+    push(2, 1);
+    push(4, 2);
+    push(5, 0);
+    for (int ni=0; ni<CONFIG_NESTED_COUNT; ++ni) {
+      push(1, 2);
+      push(2, 3);
+      push(3, 4);
+      push(4, 5);
+    }
+    push(6, 1);
+  }
+  push(0, 0);
+
+  int thread_count = std::max(1u, std::thread::hardware_concurrency());
+  auto begins = ParsingTable::findChunkBegins(tokens, thread_count * 4);
+
+  auto sequential_begin = Clock::now();
+  auto sequential_tree = table->generateParseTree("", tokens);
+  auto sequential_end = Clock::now();
+
+  bool is_parallel = false;
+  auto parallel_begin = Clock::now();
+  auto parallel_tree = table->generateParseTreeParallel("", tokens, "MAP", begins, thread_count, &is_parallel);
+  auto parallel_end = Clock::now();
+  if (sequential_tree == null || parallel_tree == null || is_parallel == false) {
+    cout << "err: config is not parsed in parallel" << endl;
+    return false;
+  }
+
+  // repeated blocks interned once. text is not kept, offsets are token idxs
+  GreenInterner interner;
+  auto intern_begin = Clock::now();
+  auto green_root = interner.intern(*sequential_tree, null);
+  auto intern_end = Clock::now();
+  auto same_root = interner.intern(*parallel_tree, null);
+  if (same_root != green_root) {
+    cout << "err: same trees are not the same green node" << endl;
+    return false;
+  }
+
+  // saved tree loaded instead of parsing, one text byte per token
+  string text(tokens.size(), 'x');
+  auto source_path = (std::filesystem::temp_directory_path() / "bench_lalr_parsergen_config.txt").string();
+  ParseTreeCache cache(table);
+  auto store_begin = Clock::now();
+  bool is_stored = cache.store(source_path, text.c_str(), text.size(), *sequential_tree, tokens);
+  auto store_end = Clock::now();
+  auto load_begin = Clock::now();
+  auto loaded = cache.load(source_path, text.c_str(), text.size());
+  auto load_end = Clock::now();
+  auto cache_bytes = is_stored? std::filesystem::file_size(ParseTreeCache::path(source_path)): 0;
+  std::filesystem::remove(ParseTreeCache::path(source_path));
+  if (loaded == null) {
+    cout << "err: saved config tree is not loaded" << endl;
+    return false;
+  }
+
+  cout << "  \"parallel\": {" << endl
+      << "    \"tokens\": " << tokens.size() << "," << endl
+      << "    \"threads\": " << thread_count << "," << endl
+      << "    \"chunks\": " << begins.size() + 1 << "," << endl
+      << "    \"sequential_ms\": " << _ms(sequential_begin, sequential_end) << "," << endl
+      << "    \"parallel_ms\": " << _ms(parallel_begin, parallel_end) << endl
+      << "  }," << endl
+      << "  \"green\": {" << endl
+      << "    \"tree_nodes\": " << interner.request_count() / 2 << "," << endl
+      << "    \"green_nodes\": " << interner.size() << "," << endl
+      << "    \"tree_node_bytes\": " << interner.request_count() / 2 * sizeof(Node) << "," << endl
+      << "    \"green_node_bytes\": " << interner.size() * sizeof(GreenNode) << "," << endl
+      << "    \"intern_ms\": " << _ms(intern_begin, intern_end) << endl
+      << "  }," << endl
+      << "  \"tree_cache\": {" << endl
+      << "    \"bytes\": " << cache_bytes << "," << endl
+      << "    \"store_ms\": " << _ms(store_begin, store_end) << "," << endl
+      << "    \"load_ms\": " << _ms(load_begin, load_end) << "," << endl
+      << "    \"parse_ms\": " << _ms(sequential_begin, sequential_end) << endl
+      << "  }," << endl;
+  return true;
+}
+
+// nonterminal counts can be given as arguments. generation grows steeply, 64 takes minutes
+int main (int argc, char *argv[]) {
+  vector<int> nonterminal_counts = { 8, 16, 32 };
+  if (argc > 1) {
+    nonterminal_counts.clear();
+    for (int ai=1; ai<argc; ++ai)
+      nonterminal_counts.push_back(std::atoi(argv[ai]));
+  }
+
+  cout << "{" << endl
+      << "  \"seed\": " << CORPUS_SEED << "," << endl
+      << "  \"sentences\": " << SENTENCE_COUNT << "," << endl
+      << "  \"grammars\": [";
+
+  bool is_first = true;
+  for (auto nonterminal_count : nonterminal_counts) {
+    if (_benchGrammar(nonterminal_count, 4, is_first) == false)
+      return 1;
+    is_first = false;
+  }
+
+  cout << endl
+      << "  ]," << endl;
+  if (_benchParallel() == false)
+    return 1;
+  cout << "  \"peak_rss_kb\": " << GenerationStats::peakRssKB() << endl
+      << "}" << endl;
+
+  return 0;
+}
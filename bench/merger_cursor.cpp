@@ -0,0 +1,97 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "../external/paw_print/paw_print.h"
+
+
+using namespace paw_print;
+
+using std::cout;
+using std::endl;
+using std::setw;
+using std::to_string;
+
+
+static const int KEY_COUNT    = 256;
+static const int LOOKUP_COUNT = 200000;
+
+
+// every layer has all keys with a nested map, so each lookup is merged on every layer
+static shared_ptr<Cursor> _makeLayer (int layer) {
+  auto paw = make_shared<PawPrint>("layer " + to_string(layer));
+  paw->beginMap();
+  for (int ki=0; ki<KEY_COUNT; ++ki) {
+    paw->pushKey("key_" + to_string(ki));
+    paw->beginMap();
+      paw->pushKey("layer");
+      paw->pushSint4B(layer);
+      paw->pushKey("value");
+      paw->pushSint4B(ki);
+    paw->endMap();
+  }
+  paw->endMap();
+  return PawPrint::root(paw);
+}
+
+static double _measureLookup (const MergerCursor &merger, const vector<string> &keys) {
+  int64 sum = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (int li=0; li<LOOKUP_COUNT; ++li) {
+    auto &key = keys[li % keys.size()];
+    sum += merger.getElem(key)->getElem("value")->get(0);
+  }
+  auto end = std::chrono::steady_clock::now();
+
+  // keep sum alive
+  if (sum == -1)
+    cout << sum << endl;
+
+  return std::chrono::duration<double, std::nano>(end - begin).count() / LOOKUP_COUNT;
+}
+
+static void _benchLayers (int layer_count) {
+  vector<shared_ptr<Cursor>> layers;
+  for (int li=0; li<layer_count; ++li)
+    layers.push_back(_makeLayer(li));
+
+  vector<string> keys;
+  std::mt19937 rng(7);
+  for (int ki=0; ki<1024; ++ki)
+    keys.push_back("key_" + to_string(rng() % KEY_COUNT));
+
+  MergerCursor lazy(layers, 2);
+  lazy.size();  // let lazy one build its pairs first
+
+  MergerCursor frozen(layers, 2);
+  auto freeze_begin = std::chrono::steady_clock::now();
+  frozen.freeze();
+  auto freeze_end = std::chrono::steady_clock::now();
+
+  auto single = PawPrint::root(layers.back()->paw_print());
+  MergerCursor single_merger({ single }, 1, false, false);
+
+  cout << setw(6) << layer_count
+      << setw(14) << _measureLookup(lazy, keys)
+      << setw(14) << _measureLookup(frozen, keys)
+      << setw(14) << _measureLookup(single_merger, keys)
+      << setw(14) << std::chrono::duration<double, std::micro>(freeze_end - freeze_begin).count()
+      << endl;
+}
+
+int main () {
+  cout << "MergerCursor lookup (ns/lookup), " << KEY_COUNT << " keys per layer" << endl;
+  cout << setw(6) << "layers"
+      << setw(14) << "lazy"
+      << setw(14) << "frozen"
+      << setw(14) << "single doc"
+      << setw(14) << "freeze(us)"
+      << endl;
+
+  for (auto layer_count : { 2, 4, 8 })
+    _benchLayers(layer_count);
+
+  return 0;
+}
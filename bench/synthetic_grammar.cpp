@@ -0,0 +1,137 @@
+#include "./synthetic_grammar.h"
+
+#include <string>
+
+
+namespace bench {
+
+using std::to_string;
+
+
+SyntheticGrammar::SyntheticGrammar (int nonterminal_count, int rule_count)
+:nonterminal_count_(nonterminal_count),
+ rule_count_((rule_count < 2)? 2: rule_count) {
+
+  start_ = make_shared<Nonterminal>("S");
+  for (int ni=0; ni<nonterminal_count_; ++ni) {
+    nons_ .push_back(make_shared<Nonterminal>("N_" + to_string(ni)));
+    lists_.push_back(make_shared<Nonterminal>("L_" + to_string(ni)));
+  }
+
+  // terminals per nonterminal: atom, open, close, prefix * (rule_count-2)
+  int token_type = 1;
+  for (int ni=0; ni<nonterminal_count_; ++ni) {
+    auto i = to_string(ni);
+    terminals_.push_back(make_shared<Terminal>("atom_"  + i, token_type++));
+    terminals_.push_back(make_shared<Terminal>("open_"  + i, token_type++));
+    terminals_.push_back(make_shared<Terminal>("close_" + i, token_type++));
+    for (int ri=1; ri<=rule_count_-2; ++ri)
+      terminals_.push_back(make_shared<Terminal>("prefix_" + i + "_" + to_string(ri), token_type++));
+  }
+
+  int term_per_non = rule_count_ + 1;
+  for (int ni=0; ni<nonterminal_count_; ++ni) {
+    auto &non  = nons_ [ni];
+    auto &list = lists_[ni];
+    auto &next = nons_ [(ni + 1) % nonterminal_count_];
+    auto term_base = ni * term_per_non;
+
+    non->rules.push_back(Rule(non, { terminals_[term_base] }));
+    non->rules.push_back(Rule(non, { terminals_[term_base + 1], list, terminals_[term_base + 2] }));
+    for (int ri=1; ri<=rule_count_-2; ++ri) {
+      non->rules.push_back(Rule(non, {
+        terminals_[term_base + 2 + ri],
+        nons_[(ni + ri) % nonterminal_count_] }));
+    }
+
+    list->rules.push_back(Rule(list, { next, list }));
+    list->rules.push_back(Rule(list, { next }));
+  }
+
+  start_->rules.push_back(Rule(start_, { nons_[0] }));
+}
+
+void SyntheticGrammar::addSymbols (ParsingTableGenerator &generator, int start_idx) const {
+  generator.addSymbol(start_, start_idx < 0);
+  for (int ni=0; ni<nonterminal_count_; ++ni) {
+    generator.addSymbol(nons_ [ni], ni == start_idx);
+    generator.addSymbol(lists_[ni]);
+  }
+}
+
+void SyntheticGrammar::addEntrySymbols (ParsingTableGenerator &generator) const {
+  for (auto &non : nons_)
+    generator.addEntrySymbol(non);
+}
+
+void SyntheticGrammar::_pushToken (const shared_ptr<Terminal> &term, vector<Token> &tokens) const {
+  int idx = tokens.size();
+  tokens.push_back(Token(term->token_type, idx, idx, 0, 0, 0));
+}
+
+void SyntheticGrammar::_derive (
+    std::mt19937 &rng,
+    int non_idx,
+    int &budget,
+    vector<Token> &tokens) const {
+
+  int term_per_non = rule_count_ + 1;
+  auto term_base = non_idx * term_per_non;
+
+  // atom only if budget is used up
+  int rule_idx = (budget <= 0)? 0: rng() % rule_count_;
+  --budget;
+
+  if (rule_idx == 0) {
+    _pushToken(terminals_[term_base], tokens);
+  }else if (rule_idx == 1) {
+    _pushToken(terminals_[term_base + 1], tokens);
+    auto next = (non_idx + 1) % nonterminal_count_;
+    do {
+      _derive(rng, next, budget, tokens);
+    } while (budget > 0 && rng() % 3 != 0);
+    _pushToken(terminals_[term_base + 2], tokens);
+  }else {
+    _pushToken(terminals_[term_base + rule_idx + 1], tokens);
+    _derive(rng, (non_idx + rule_idx - 1) % nonterminal_count_, budget, tokens);
+  }
+}
+
+void SyntheticGrammar::makeSentence (
+    std::mt19937 &rng,
+    int target_length,
+    vector<Token> &tokens) const {
+
+  int budget = target_length / 2;
+  _derive(rng, 0, budget, tokens);
+  tokens.push_back(Token(0, tokens.size(), tokens.size(), 0, 0, 0));
+}
+
+void SyntheticGrammar::makeLongSentence (
+    std::mt19937 &rng,
+    int length,
+    vector<Token> &tokens) const {
+
+  _pushToken(terminals_[1], tokens);
+  while (tokens.size() < length) {
+    int budget = 32;
+    _derive(rng, 1 % nonterminal_count_, budget, tokens);
+  }
+  _pushToken(terminals_[2], tokens);
+  tokens.push_back(Token(0, tokens.size(), tokens.size(), 0, 0, 0));
+}
+
+vector<vector<Token>> SyntheticGrammar::makeCorpus (
+    unsigned int seed,
+    int sentence_count,
+    int target_length) const {
+
+  std::mt19937 rng(seed);
+  vector<vector<Token>> corpus(sentence_count);
+  for (auto &tokens : corpus)
+    makeSentence(rng, target_length, tokens);
+
+  return corpus;
+}
+
+}
@@ -0,0 +1,85 @@
+#ifndef BENCH_SYNTHETIC_GRAMMAR
+#define BENCH_SYNTHETIC_GRAMMAR
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/parse_table.h"
+#include "../src/parsing_table_generator.h"
+
+
+namespace bench {
+
+using std::make_shared;
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+using namespace parse_table;
+
+
+// scalable LALR(1) grammar. for each i < nonterminal_count:
+//   N_i -> atom_i
+//   N_i -> open_i L_i close_i
+//   L_i -> N_(i+1) L_i | N_(i+1)
+//   N_i -> prefix_i_r N_(i+r)          (r = 1 .. rule_count-2)
+// S -> N_0
+class SyntheticGrammar {
+public:
+  SyntheticGrammar (int nonterminal_count, int rule_count);
+
+  inline int nonterminal_count () const { return nonterminal_count_; }
+  inline int rule_count () const { return rule_count_; }
+  inline int token_type_count () const { return terminals_.size() + 1; }  // with end(0)
+  inline const string& terminal_name (int token_type) const { return terminals_[token_type - 1]->name; }
+
+  // start_idx >= 0 makes N_start_idx the start symbol instead of S
+  void addSymbols (ParsingTableGenerator &generator, int start_idx=-1) const;
+
+  // every N_i as an entry symbol
+  void addEntrySymbols (ParsingTableGenerator &generator) const;
+
+  // random sentence derived from S. ends with end token (type 0).
+  // once target_length is used up, shortest rules are chosen
+  void makeSentence (
+      std::mt19937 &rng,
+      int target_length,
+      vector<Token> &tokens) const;
+
+  // sentence of about length tokens, a list of random N_1 under N_0.
+  // the list is right recursive, so the parse stack grows with it
+  void makeLongSentence (
+      std::mt19937 &rng,
+      int length,
+      vector<Token> &tokens) const;
+
+  // fixed-seed corpus. same seed gives same sentences
+  vector<vector<Token>> makeCorpus (
+      unsigned int seed,
+      int sentence_count,
+      int target_length) const;
+
+
+private:
+  int nonterminal_count_;
+  int rule_count_;
+
+  shared_ptr<Nonterminal> start_;
+  vector<shared_ptr<Nonterminal>> nons_;
+  vector<shared_ptr<Nonterminal>> lists_;
+  vector<shared_ptr<Terminal>> terminals_;
+
+  void _derive (
+      std::mt19937 &rng,
+      int non_idx,
+      int &budget,
+      vector<Token> &tokens) const;
+
+  void _pushToken (const shared_ptr<Terminal> &term, vector<Token> &tokens) const;
+};
+
+}
+
+#endif
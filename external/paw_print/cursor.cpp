@@ -1,5 +1,6 @@
 #include "./curses.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 #include <cstring>
@@ -45,7 +46,22 @@ DataType Cursor::type () const {
   if (paw_print_->isReference(idx_) == true)
     return paw_print_->getReference(idx_)->type();
 
-  return paw_print_->type(idx_);
+  auto t = paw_print_->type(idx_);
+  if (t == PawPrint::Data::TYPE_STRING_REF)
+    return PawPrint::Data::TYPE_STRING;
+
+  return t;
+}
+
+
+int Cursor::getStringId () const {
+  if (isValid() == false)
+    return -1;
+
+  if (paw_print_->isReference(idx_) == true)
+    return paw_print_->getReference(idx_)->getStringId();
+
+  return paw_print_->getStringId(idx_);
 }
 
 
@@ -118,6 +134,11 @@ bool Cursor::isKeyValuePair () const {
 }
 
 
+bool Cursor::isArray () const {
+  return type() == PawPrint::Data::TYPE_ARRAY;
+}
+
+
 string Cursor::get (const char *default_value) const {
   return get<string>(default_value);
 }
@@ -146,7 +167,12 @@ shared_ptr<Cursor> Cursor::getElem (const char *key) const {
     return make_shared<Cursor>(paw_print_, -1);
 
   auto &sorted_data_idxs = paw_print_->getSortedDataIdxsOfMap(idx_);
-  int pair_idx = paw_print_->findRawIdxOfValue(sorted_data_idxs, 0, sorted_data_idxs.size() - 1, key);
+  int pair_idx = paw_print_->findRawIdxOfValue(
+      sorted_data_idxs,
+      0,
+      sorted_data_idxs.size() - 1,
+      key,
+      paw_print_->findStringId(key));
   if (pair_idx < 0)
     return make_shared<Cursor>(paw_print_, -1);
 
@@ -180,11 +206,32 @@ int Cursor::size () const {
     return paw_print_->getDataIdxsOfSequence(idx_).size();
   else if (isMap() == true)
     return paw_print_->getDataIdxsOfMap(idx_).size();
+  else if (isArray() == true)
+    return paw_print_->getArraySize(idx_);
   else
     return 1;
 }
 
 
+template <class T>
+static void _arrayToString (
+    stringstream &ss,
+    const Cursor &cursor,
+    int indent
+) {
+  auto values = cursor.getArray<T>();
+  for (int vi = 0; vi < values.size(); ++vi) {
+    if (vi != 0) {
+      for (int i = 0; i<indent; ++i)
+        ss << " ";
+    }
+
+    // print char/byte as number
+    ss << "- " << +values[vi] << endl;
+  }
+}
+
+
 string Cursor::toString (int indent, int indent_inc, bool ignore_indent) const {
   if (paw_print_->isReference(idx_) == true)
     return paw_print_->getReference(idx_)->toString(indent, indent_inc, ignore_indent);
@@ -260,6 +307,24 @@ string Cursor::toString (int indent, int indent_inc, bool ignore_indent) const {
       }
       break;
 
+    case PawPrint::Data::TYPE_ARRAY:
+      if (size() <= 0)
+        ss << "[ ]" << endl;
+      switch (paw_print_->getArrayElemType(idx_)) {
+        case PawPrint::Data::TYPE_SINT_1B: _arrayToString<char  >(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_UINT_1B: _arrayToString<byte  >(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_SINT_2B: _arrayToString<short >(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_UINT_2B: _arrayToString<ushort>(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_SINT_4B: _arrayToString<int   >(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_UINT_4B: _arrayToString<uint  >(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_SINT_8B: _arrayToString<int64 >(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_UINT_8B: _arrayToString<uint64>(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_REAL_4B: _arrayToString<float >(ss, *this, indent); break;
+        case PawPrint::Data::TYPE_REAL_8B: _arrayToString<double>(ss, *this, indent); break;
+        default: break;
+      }
+      break;
+
     default:
       // TODO err
       cout << "err: cannot cursor convert to string type \'"
@@ -371,6 +436,7 @@ MergerCursor::MergerCursor (
     bool need_merge_map/*=true*/
 )
 :super(),
+ is_frozen_(false),
  size_(-1),
  merge_level_(merge_level),
  need_merge_sequence_(need_merge_sequence),
@@ -388,6 +454,7 @@ MergerCursor::MergerCursor (
     bool need_merge_map/*=true*/
 )
 :super(),
+ is_frozen_(false),
  size_(-1),
  merge_level_(merge_level),
  need_merge_sequence_(need_merge_sequence),
@@ -421,7 +488,7 @@ bool MergerCursor::pushCursor (const shared_ptr<Cursor> &cursor) {
     return false;
 
   cursor_stack_.push_back(cursor);
-  size_ = -1;
+  _unfreeze();
   return true;
 }
 
@@ -430,12 +497,131 @@ shared_ptr<Cursor> MergerCursor::popCursor () {
   if (cursor_stack_.size() <= 0)
     return make_shared<Cursor>();
 
-  auto &c = cursor_stack_.back();
+  auto c = cursor_stack_.back();
   cursor_stack_.pop_back();
+  _unfreeze();
+  return c;
+}
+
+
+static const shared_ptr<Cursor>& _freezeChild (const shared_ptr<Cursor> &c) {
+  auto merger = std::dynamic_pointer_cast<MergerCursor>(c);
+  if (merger != null)
+    merger->freeze();
+
   return c;
 }
 
 
+void MergerCursor::freeze () {
+  _unfreeze();
+
+  if (cursor_stack_.size() <= 0)
+    return;
+
+  switch (type()) {
+    case PawPrint::Data::TYPE_SEQUENCE: {
+      if (need_merge_sequence_ == false)
+        break;
+
+      auto elem_size = size();
+      frozen_elems_.reserve(elem_size);
+      for (int i=0; i<elem_size; ++i)
+        frozen_elems_.push_back(_freezeChild(getElem(i)));
+      break;
+    }
+
+    case PawPrint::Data::TYPE_MAP: {
+      if (need_merge_map_ == false)
+        break;
+
+      _resetMapSizeAndKeyValuePairs();
+
+      frozen_elems_.reserve(key_value_pairs_.size());
+      frozen_sorted_pair_idxs_.reserve(key_value_pairs_.size());
+      for (int pi=0; pi<key_value_pairs_.size(); ++pi) {
+        auto &pair = _freezeChild(key_value_pairs_[pi]);
+        frozen_elems_.push_back(_freezeChild(pair->getValue()));
+        frozen_sorted_pair_idxs_.push_back(pi);
+      }
+
+      std::sort(
+          frozen_sorted_pair_idxs_.begin(),
+          frozen_sorted_pair_idxs_.end(),
+          [this](int a, int b) {
+            return strcmp(key_value_pairs_[a]->getKey(), key_value_pairs_[b]->getKey()) < 0;
+          }
+      );
+      break;
+    }
+
+    case PawPrint::Data::TYPE_KEY_VALUE_PAIR:
+      frozen_value_ = _freezeChild(getValue());
+      break;
+
+    default:
+      break;
+  }
+
+  is_frozen_ = true;
+}
+
+
+void MergerCursor::_unfreeze () {
+  is_frozen_ = false;
+  size_ = -1;
+  key_value_pairs_.clear();
+  key_value_pair_layers_.clear();
+  frozen_elems_.clear();
+  frozen_sorted_pair_idxs_.clear();
+  frozen_value_ = null;
+}
+
+
+int MergerCursor::_findFrozenPairIdx (const char *key) const {
+  int first = 0;
+  int last  = frozen_sorted_pair_idxs_.size() - 1;
+  while (first <= last) {
+    int mid = (first + last) / 2;
+    auto pi = frozen_sorted_pair_idxs_[mid];
+
+    auto cmp_res = strcmp(key, key_value_pairs_[pi]->getKey());
+    if (cmp_res < 0)
+      last = mid - 1;
+    else if (cmp_res > 0)
+      first = mid + 1;
+    else
+      return pi;
+  }
+
+  return -1;
+}
+
+
+int MergerCursor::getWinningLayer (const char *key) const {
+  if (cursor_stack_.size() <= 0 || type() != PawPrint::Data::TYPE_MAP)
+    return -1;
+
+  if (need_merge_map_ == false)
+    return (cursor_stack_.back()->findKeyValuePair(key)->isValid() == true)? cursor_stack_.size() - 1: -1;
+
+  if (is_frozen_ == true) {
+    auto pi = _findFrozenPairIdx(key);
+    return (pi < 0)? -1: key_value_pair_layers_[pi];
+  }
+
+  if (key_value_pairs_.size() <= 0)
+    _resetMapSizeAndKeyValuePairs();
+
+  for (int pi=0; pi<key_value_pairs_.size(); ++pi) {
+    if (strcmp(key_value_pairs_[pi]->getKey(), key) == 0)
+      return key_value_pair_layers_[pi];
+  }
+
+  return -1;
+}
+
+
 int MergerCursor::size () const {
   if (size_ >= 0)
     return size_;
@@ -489,6 +675,12 @@ shared_ptr<Cursor> MergerCursor::getElem (int idx) const {
   if (need_merge_sequence_ == false)
     return cursor_stack_.back()->getElem(idx);
 
+  if (is_frozen_ == true) {
+    if (idx < 0 || idx >= frozen_elems_.size())
+      return make_shared<Cursor>();
+    return frozen_elems_[idx];
+  }
+
   for (auto &c : cursor_stack_) {
     if (idx >= c->size()) {
       idx -= c->size();
@@ -529,6 +721,13 @@ shared_ptr<Cursor> MergerCursor::getElem (const char *key) const {
   if (need_merge_map_ == false)
     return cursor_stack_.back()->getElem(key);
 
+  if (is_frozen_ == true) {
+    auto pi = _findFrozenPairIdx(key);
+    if (pi < 0)
+      return make_shared<Cursor>();
+    return frozen_elems_[pi];
+  }
+
   auto pair = findKeyValuePair(key);
   if (pair->isValid() == false)
     return pair;
@@ -569,6 +768,7 @@ shared_ptr<Cursor> MergerCursor::getKeyValuePair (int idx) const {
 void MergerCursor::_resetMapSizeAndKeyValuePairs () const {
   size_ = 0;
   key_value_pairs_.clear();
+  key_value_pair_layers_.clear();
   
   if (cursor_stack_.size() <= 0)
     return;
@@ -588,6 +788,7 @@ void MergerCursor::_resetMapSizeAndKeyValuePairs () const {
       if (key_exists_map.find(key) != key_exists_map.end())
         continue;
       key_exists_map[key] = 1;
+      key_value_pair_layers_.push_back(ci);
 
 
       // end of merge
@@ -700,6 +901,9 @@ shared_ptr<Cursor> MergerCursor::getValue () const {
   if (cursor_stack_.size() <= 0)
     return make_shared<Cursor>();
 
+  if (is_frozen_ == true && frozen_value_ != null)
+    return frozen_value_;
+
   auto top_value = cursor_stack_.back()->getValue();
   auto top_value_type = top_value->type();
   if (MergerCursor::isAvailableType(top_value_type) == false)
@@ -728,6 +932,13 @@ shared_ptr<Cursor> MergerCursor::getValue () const {
 
 
 shared_ptr<Cursor> MergerCursor::findKeyValuePair (const char *key) const {
+  if (is_frozen_ == true) {
+    auto pi = _findFrozenPairIdx(key);
+    if (pi < 0)
+      return make_shared<Cursor>();
+    return key_value_pairs_[pi];
+  }
+
   // make key_value_pairs_
   if (key_value_pairs_.size() <= 0)
     _resetMapSizeAndKeyValuePairs();
@@ -787,34 +998,153 @@ int MergerCursor::getLine () const {
 
 
 
-MapLoader::MapLoader () {
+MapLoader::MapLoader ()
+:required_count_(0),
+ is_compiled_(false),
+ walk_sorted_keys_(false)
+{
 }
 
 
 MapLoader::MapLoader (
   const vector<std::pair<string, LoaderFunc>> &cases
 )
-:cases_ (cases)
+:MapLoader()
 {
+  for (auto &c : cases)
+    addCase(c.first.c_str(), c.second);
 }
 
 
-void MapLoader::load (const shared_ptr<Cursor> &cursor) {
-  if (cursor->isMap() == false)
-    return;
+void MapLoader::addCase (const char *key, LoaderFunc func, bool is_required/*=false*/) {
+  cases_.push_back(std::pair<string, LoaderFunc>(key, func));
+  is_required_list_.push_back(is_required);
+  if (is_required == true)
+    ++required_count_;
 
-  for (int pi=0; pi<cursor->size(); ++pi) {
-  auto pair = cursor->getKeyValuePair(pi);
-  auto key   = pair->getKey  ();
-  auto value = pair->getValue();
+  is_compiled_ = false;
+}
 
-  for (auto &c : cases_) {
-    if (c.first == key) {
-      c.second(value);
-      break;
+
+void MapLoader::compile (bool walk_sorted_keys/*=false*/) {
+  walk_sorted_keys_ = walk_sorted_keys;
+
+  // first case wins on duplicated key, same as linear scan
+  case_idx_map_.clear();
+  case_idx_map_.reserve(cases_.size());
+  for (int ci=cases_.size()-1; ci>=0; --ci)
+    case_idx_map_[cases_[ci].first] = ci;
+
+  sorted_case_idxs_.clear();
+  for (auto &itr : case_idx_map_)
+    sorted_case_idxs_.push_back(itr.second);
+  std::sort(sorted_case_idxs_.begin(), sorted_case_idxs_.end(), [this](int a, int b) {
+    return cases_[a].first < cases_[b].first;
+  });
+
+  is_compiled_ = true;
+}
+
+
+int MapLoader::_findCaseIdx (const char *key) const {
+  if (is_compiled_ == true) {
+    auto itr = case_idx_map_.find(std::string_view(key));
+    return (itr == case_idx_map_.end())? -1: itr->second;
+  }
+
+  for (int ci=0; ci<cases_.size(); ++ci) {
+    if (cases_[ci].first == key)
+      return ci;
+  }
+
+  return -1;
+}
+
+
+void MapLoader::_walkSortedKeys (
+    const shared_ptr<Cursor> &cursor,
+    vector<char> &is_loaded_list,
+    vector<string> *unknown_keys
+) {
+  auto &paw = cursor->paw_print();
+  auto &sorted_pair_idxs = paw->getSortedDataIdxsOfMap(cursor->idx());
+
+  int ci = 0;
+  for (auto pair_idx : sorted_pair_idxs) {
+    auto key = paw->getStrValue(paw->getKeyRawIdxOfPair(pair_idx));
+
+    // skip cases smaller than key
+    int cmp_res = 1;
+    while (ci < sorted_case_idxs_.size()) {
+      cmp_res = strcmp(cases_[sorted_case_idxs_[ci]].first.c_str(), key);
+      if (cmp_res >= 0)
+        break;
+      ++ci;
+    }
+
+    if (cmp_res != 0) {
+      if (unknown_keys != null)
+        unknown_keys->push_back(key);
+      continue;
+    }
+
+    auto case_idx = sorted_case_idxs_[ci];
+    cases_[case_idx].second(make_shared<Cursor>(paw, paw->getValueRawIdxOfPair(pair_idx)));
+    is_loaded_list[case_idx] = 1;
+  }
+}
+
+
+bool MapLoader::load (
+    const shared_ptr<Cursor> &cursor,
+    vector<string> *missing_keys/*=null*/,
+    vector<string> *unknown_keys/*=null*/
+) {
+  if (cursor->isMap() == false)
+    return required_count_ <= 0;
+
+  // local, so a case func may load a nested map with this loader
+  vector<char> is_loaded_list(cases_.size(), 0);
+
+  // lockstep walk works on plain map of PawPrint only
+  auto is_plain_map =
+      dynamic_cast<MergerCursor*>(cursor.get()) == null &&
+      cursor->paw_print()->isReference(cursor->idx()) == false;
+
+  if (is_compiled_ == true && walk_sorted_keys_ == true && is_plain_map == true) {
+    _walkSortedKeys(cursor, is_loaded_list, unknown_keys);
+  }else {
+    for (int pi=0; pi<cursor->size(); ++pi) {
+      auto pair = cursor->getKeyValuePair(pi);
+      auto key  = pair->getKey();
+
+      auto ci = _findCaseIdx(key);
+      if (ci < 0) {
+        if (unknown_keys != null)
+          unknown_keys->push_back(key);
+        continue;
+      }
+
+      cases_[ci].second(pair->getValue());
+      is_loaded_list[ci] = 1;
     }
   }
+
+  // check required keys
+  if (required_count_ <= 0)
+    return true;
+
+  bool has_all_required = true;
+  for (int ci=0; ci<cases_.size(); ++ci) {
+    if (is_required_list_[ci] == false || is_loaded_list[ci] == true)
+      continue;
+
+    has_all_required = false;
+    if (missing_keys != null)
+      missing_keys->push_back(cases_[ci].first);
   }
+
+  return has_all_required;
 }
 
 
@@ -3,8 +3,11 @@
 
 #include <functional>
 #include <memory>
+#include <span>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #include "./defines.h"
@@ -16,7 +19,9 @@ namespace paw_print {
 
 using std::function;
 using std::shared_ptr;
+using std::span;
 using std::string;
+using std::unordered_map;
 using std::vector;
 
 
@@ -49,9 +54,13 @@ public:
   bool isSequence () const;
   bool isMap () const;
   bool isKeyValuePair () const;
+  bool isArray () const;
 
   bool isNull () const;
 
+  // id on string table of PawPrint. -1 if not interned
+  int getStringId () const;
+
   virtual bool isValid () const;
 
   string get (char const* default_value) const;
@@ -79,6 +88,23 @@ public:
     return default_value;
   }
 
+  // payload of TYPE_ARRAY. empty if elem type is not T. a payload that lost
+  // its alignment (copied to an odd offset) is read from an aligned copy
+  template <typename T>
+  span<const T> getArray () const {
+    if (isValid() == false)
+      return span<const T>();
+
+    if (paw_print_->isReference(idx_) == true)
+      return paw_print_->getReference(idx_)->getArray<T>();
+
+    if (isArray() == false || paw_print_->getArrayElemType(idx_) != PawPrint::Data::typeOf<T>())
+      return span<const T>();
+
+    auto data = paw_print_->getAlignedArrayData(idx_, alignof(T));
+    return span<const T>((const T*)data, paw_print_->getArraySize(idx_));
+  }
+
   virtual shared_ptr<Cursor> getElem (int idx) const;
   virtual shared_ptr<Cursor> getElem (const char *key) const;
   virtual shared_ptr<Cursor> getElem (const string &key) const;
@@ -249,6 +275,14 @@ public:
   bool pushCursor (const shared_ptr<Cursor> &cursor);
   shared_ptr<Cursor> popCursor ();
 
+  // materialize merged view (recursively) so lookups cost same as single PawPrint.
+  // pushCursor/popCursor drop it
+  void freeze ();
+  inline bool is_frozen () const { return is_frozen_; }
+
+  // idx on cursor stack which the value of key comes from. -1 if not found
+  int getWinningLayer (const char *key) const;
+
   shared_ptr<Cursor> getElem (int idx) const override;
   shared_ptr<Cursor> getElem (const char *key) const override;
   shared_ptr<Cursor> getElem (const string &key) const override;
@@ -271,8 +305,15 @@ public:
 
 private:
   mutable vector<shared_ptr<Cursor>> key_value_pairs_;
+  mutable vector<int> key_value_pair_layers_;
   mutable string name_;
 
+  // frozen index
+  bool is_frozen_;
+  vector<shared_ptr<Cursor>> frozen_elems_;   // sequence elems or map values
+  vector<int> frozen_sorted_pair_idxs_;       // key_value_pairs_ idx sorted by key
+  shared_ptr<Cursor> frozen_value_;           // for key value pair
+
   vector<shared_ptr<Cursor>> cursor_stack_;
   mutable int size_;  // -1 if need compute
   unsigned short merge_level_;
@@ -281,6 +322,8 @@ private:
 
 
   void _resetMapSizeAndKeyValuePairs () const;
+  void _unfreeze ();
+  int _findFrozenPairIdx (const char *key) const;
 };
 
 
@@ -294,17 +337,47 @@ public:
   MapLoader (const vector<std::pair<string, LoaderFunc>> &cases);
 
 
-  void load (const shared_ptr<Cursor> &cursor);
+  // returns false if a required key is missing.
+  // missing_keys/unknown_keys are filled on the same pass if given
+  bool load (
+      const shared_ptr<Cursor> &cursor,
+      vector<string> *missing_keys = null,
+      vector<string> *unknown_keys = null);
 
-  inline void addCase (const char *key, LoaderFunc func) {
-    cases_.push_back(std::pair<string, LoaderFunc>(key, func));
-  }
+  void addCase (const char *key, LoaderFunc func, bool is_required = false);
+
+  // build dispatch table. with walk_sorted_keys, load() walks sorted keys
+  // of map and sorted cases in lockstep (funcs are called in key order)
+  void compile (bool walk_sorted_keys = false);
 
   inline size_t case_size () const { return cases_.size(); }
+  PAW_GETTER(bool, is_compiled)
 
 
 private:
+  class KeyHash {
+  public:
+    using is_transparent = void;
+    size_t operator () (std::string_view key) const {
+      return std::hash<std::string_view>()(key);
+    }
+  };
+
   vector<std::pair<string, LoaderFunc>> cases_;
+  vector<char> is_required_list_;
+  int required_count_;
+
+  bool is_compiled_;
+  bool walk_sorted_keys_;
+  unordered_map<string, int, KeyHash, std::equal_to<>> case_idx_map_;
+  vector<int> sorted_case_idxs_;
+
+
+  int _findCaseIdx (const char *key) const;
+  void _walkSortedKeys (
+      const shared_ptr<Cursor> &cursor,
+      vector<char> &is_loaded_list,
+      vector<string> *unknown_keys);
 };
 
 
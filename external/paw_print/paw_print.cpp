@@ -69,40 +69,60 @@ PawPrint::PawPrint (const string &name, double        value) :PawPrint(name) { p
 PawPrint::PawPrint (const string &name, const char   *value) :PawPrint(name) { pushString(value); }
 PawPrint::PawPrint (const string &name, const string &value) :PawPrint(name) { pushString(value); }
 
+PawPrint::PawPrint (const string &name, const vector<int   > &value) :PawPrint(name) { pushSequence(span<const int   >(value)); }
+PawPrint::PawPrint (const string &name, const vector<double> &value) :PawPrint(name) { pushSequence(span<const double>(value)); }
+
+PawPrint::PawPrint (const string &name, const vector<string> &value)
+:PawPrint(name)
+{
+  beginSequence();
+  for (auto &v : value)
+    pushString(v);
+  endSequence();
+}
+
 
 const PawPrint& PawPrint::operator = (const shared_ptr<Cursor> &cursor) {
   auto cursor_idx = cursor->idx();
   auto data_size = cursor->paw_print()->dataSize(cursor_idx);
 
   raw_data_.resize(data_size);
-  column_map_.clear();
-  line_map_  .clear();
+  positions_.clear();
+  aligned_array_copies_.clear();
   last_pushed_idx_ = -1;
 
   // copy raw_data
   auto &cursor_raw_data = cursor->paw_print()->raw_data_;
-  for (int di=0; di<raw_data_.size(); ++di) {
-    raw_data_[di] = cursor_raw_data[di + cursor_idx];
+  memcpy(raw_data_.data(), &cursor_raw_data[cursor_idx], data_size);
+
+  // copy string table
+  auto &src = *cursor->paw_print();
+  string_idxs_.clear();
+  string_id_map_.clear();
+  interned_id_map_  = src.interned_id_map_;
+  interned_strings_ = src.interned_strings_;
+  string_ref_idxs_.clear();
+  for (auto ref_idx : src.string_ref_idxs_) {
+    auto idx = ref_idx - cursor_idx;
+    if (idx >= 0 && idx < data_size)
+      string_ref_idxs_.push_back(idx);
   }
-
-  // copy column_map
-  auto &cursor_column_map = cursor->paw_print()->column_map_;
-  for (auto &itr : cursor_column_map) {
-    auto idx = itr.first - cursor_idx;
-    if (idx < 0 || idx >= data_size)
-      continue;
-
-    column_map_[idx] = itr.second;
+  if (src.string_idxs_.size() > 0) {
+    auto src_table_idx = src.string_idxs_[0] - sizeof(DataType) - sizeof(uint);
+    auto table_size = src.dataSize(src_table_idx);
+    raw_data_.resize(data_size + table_size);
+    memcpy(&raw_data_[data_size], &src.raw_data_[src_table_idx], table_size);
+    _loadStringTable(data_size);
   }
+  is_closed_ = string_idxs_.size() > 0;
 
-  // copy line_map
-  auto &cursor_line_map = cursor->paw_print()->line_map_;
-  for (auto &itr : cursor_line_map) {
-    auto idx = itr.first - cursor_idx;
+  // copy positions (already sorted by idx)
+  for (auto &p : cursor->paw_print()->positions_) {
+    auto idx = p.idx - cursor_idx;
     if (idx < 0 || idx >= data_size)
       continue;
 
-    line_map_[idx] = itr.second;
+    positions_.push_back({idx, p.column, p.line});
   }
 
   return *this;
@@ -128,13 +148,90 @@ const shared_ptr<Cursor>& PawPrint::getReference (int idx) const {
 }
 
 PawPrint::Data::StrSizeType PawPrint::getStrSize (int idx) const {
-  return _getRawData<PawPrint::Data::StrSizeType>(idx + sizeof(DataType));
+  auto id = getStringId(idx);
+  if (id >= 0) {
+    if (id < string_idxs_.size())
+      return getStrSize(string_idxs_[id]);
+    if (id < interned_strings_.size())
+      return interned_strings_[id].size() + 1;
+    return 1;   // broken id reads as ""
+  }
+
+  Data::StrSizeType size;
+  memcpy(&size, &raw_data_[idx + sizeof(DataType)], sizeof(size));
+  return size;
 }
 
 const char* PawPrint::getStrValue (int idx) const {
+  auto id = getStringId(idx);
+  if (id >= 0) {
+    if (id < string_idxs_.size())
+      return getStrValue(string_idxs_[id]);
+    if (id < interned_strings_.size())
+      return interned_strings_[id].c_str();
+    return "";
+  }
+
   return (const char*)&raw_data_[idx + sizeof(DataType) + sizeof(PawPrint::Data::StrSizeType)];
 }
 
+int PawPrint::getStringId (int idx) const {
+  if (idx < 0 || type(idx) != Data::TYPE_STRING_REF)
+    return -1;
+
+  Data::StringIdType id;
+  memcpy(&id, &raw_data_[idx + sizeof(DataType)], sizeof(id));
+  return id;
+}
+
+int PawPrint::findStringId (const char *value) const {
+  if (string_idxs_.size() <= 0)
+    return -1;
+
+  if (string_id_map_.size() <= 0) {
+    string_id_map_.reserve(string_idxs_.size());
+    for (int si=0; si<string_idxs_.size(); ++si)
+      string_id_map_[getStrValue(string_idxs_[si])] = si;
+  }
+
+  auto itr = string_id_map_.find(value);
+  if (itr == string_id_map_.end())
+    return -1;
+
+  return itr->second;
+}
+
+DataType PawPrint::getArrayElemType (int idx) const {
+  return _getRawData<DataType>(idx + sizeof(DataType));
+}
+
+PawPrint::Data::ArraySizeType PawPrint::getArraySize (int idx) const {
+  Data::ArraySizeType size;
+  memcpy(&size, &raw_data_[idx + sizeof(DataType) * 2 + sizeof(byte)], sizeof(size));
+  return size;
+}
+
+const byte* PawPrint::getArrayData (int idx) const {
+  auto pad = _getRawData<byte>(idx + sizeof(DataType) * 2);
+  return &raw_data_[idx + Data::ARRAY_HEADER_SIZE + pad];
+}
+
+const byte* PawPrint::getAlignedArrayData (int idx, int align) const {
+  auto data = getArrayData(idx);
+  if (reinterpret_cast<uintptr_t>(data) % align == 0)
+    return data;
+
+  // uint64 blocks are aligned for every number type
+  auto itr = aligned_array_copies_.find(idx);
+  if (itr == aligned_array_copies_.end()) {
+    auto size = Data::numberSize(getArrayElemType(idx)) * getArraySize(idx);
+    itr = aligned_array_copies_.emplace(idx, vector<uint64>((size + sizeof(uint64) - 1) / sizeof(uint64))).first;
+    if (size > 0)
+      memcpy(itr->second.data(), data, size);
+  }
+  return (const byte*)itr->second.data();
+}
+
 int PawPrint::getKeyRawIdxOfPair (int pair_idx) const {
   return pair_idx + sizeof(DataType);
 }
@@ -144,6 +241,22 @@ int PawPrint::getValueRawIdxOfPair (int pair_idx) const {
   return key_idx + dataSize(key_idx);
 }
 
+int PawPrint::Data::numberSize (DataType type) {
+  switch (type) {
+    case TYPE_SINT_1B: return 1;
+    case TYPE_UINT_1B: return 1;
+    case TYPE_SINT_2B: return 2;
+    case TYPE_UINT_2B: return 2;
+    case TYPE_SINT_4B: return 4;
+    case TYPE_UINT_4B: return 4;
+    case TYPE_SINT_8B: return 8;
+    case TYPE_UINT_8B: return 8;
+    case TYPE_REAL_4B: return 4;
+    case TYPE_REAL_8B: return 8;
+    default: return 0;
+  }
+}
+
 int PawPrint::dataSize (int idx) const {
   int result = sizeof(DataType);
 
@@ -187,6 +300,25 @@ int PawPrint::dataSize (int idx) const {
       result += sizeof(Data::ReferenceIdxType);
       break;
 
+    case Data::TYPE_STRING_REF:
+      result += sizeof(Data::StringIdType);
+      break;
+
+    case Data::TYPE_STRING_TABLE: {
+      uint count;
+      memcpy(&count, &raw_data_[idx + result], sizeof(count));
+      result += sizeof(count);
+      for (uint si=0; si<count; ++si)
+        result += dataSize(idx + result);
+      break;
+    }
+
+    case Data::TYPE_ARRAY:
+      result = Data::ARRAY_HEADER_SIZE
+          + _getRawData<byte>(idx + sizeof(DataType) * 2)
+          + Data::numberSize(getArrayElemType(idx)) * getArraySize(idx);
+      break;
+
     default: break;
   }
 
@@ -216,9 +348,11 @@ public:
   }
 
   bool operator () (int a_idx, int b_idx) {
-    auto a_key_idx = paw_print_.getKeyRawIdxOfPair(a_idx);
     auto b_key_idx = paw_print_.getKeyRawIdxOfPair(b_idx);
-    return strcmp(paw_print_.getStrValue(a_key_idx), paw_print_.getStrValue(b_key_idx)) < 0;
+    return paw_print_.compareKey(
+        a_idx,
+        paw_print_.getStrValue(b_key_idx),
+        paw_print_.getStringId(b_key_idx)) < 0;
   }
 
 private:
@@ -226,46 +360,39 @@ private:
 };
 
 
-static void _makeDataIdxsOfMap (
-    const PawPrint *paw,
-    int map_idx,
-    unordered_map<int, vector<int>> &data_idxs_of_map_map,
-    unordered_map<int, vector<int>> &sorted_data_idxs_of_map_map
-) {
+const vector<int>& PawPrint::getDataIdxsOfMap (int map_idx) const {
+  if (data_idxs_of_map_map_.find(map_idx) != data_idxs_of_map_map_.end())
+    return data_idxs_of_map_map_[map_idx];
 
-  // make datas
-  auto &result   = data_idxs_of_map_map[map_idx];
-  auto &sorted_res = sorted_data_idxs_of_map_map[map_idx];
+  auto &result = data_idxs_of_map_map_[map_idx];
   auto idx = map_idx + sizeof(DataType);
-  while (paw->type(idx) != PawPrint::Data::TYPE_MAP_END) {
-    result  .push_back(idx);
-    sorted_res.push_back(idx);
+  while (type(idx) != Data::TYPE_MAP_END) {
+    result.push_back(idx);
 
-    idx += paw->dataSize(idx);
+    idx += dataSize(idx);
   }
 
-  std::sort(sorted_res.begin(), sorted_res.end(), SortFuncForKey(*paw));
-}
-
-const vector<int>& PawPrint::getDataIdxsOfMap (int map_idx) const {
-  if (data_idxs_of_map_map_.find(map_idx) == data_idxs_of_map_map_.end())
-    _makeDataIdxsOfMap(this, map_idx, data_idxs_of_map_map_, sorted_data_idxs_of_map_map_);
-
-  return data_idxs_of_map_map_[map_idx];
+  return result;
 }
 
 const vector<int>& PawPrint::getSortedDataIdxsOfMap(int map_idx) const {
-  if (sorted_data_idxs_of_map_map_.find(map_idx) == sorted_data_idxs_of_map_map_.end())
-    _makeDataIdxsOfMap(this, map_idx, data_idxs_of_map_map_, sorted_data_idxs_of_map_map_);
+  if (sorted_data_idxs_of_map_map_.find(map_idx) != sorted_data_idxs_of_map_map_.end())
+    return sorted_data_idxs_of_map_map_[map_idx];
+
+  // sort only when it is needed. keys may refer string table
+  auto &sorted_res = sorted_data_idxs_of_map_map_[map_idx];
+  sorted_res = getDataIdxsOfMap(map_idx);
+  std::sort(sorted_res.begin(), sorted_res.end(), SortFuncForKey(*this));
 
-  return sorted_data_idxs_of_map_map_[map_idx];
+  return sorted_res;
 }
 
 int PawPrint::findRawIdxOfValue (
     const vector<int> &sorted_map_datas,
     int first,
     int last,
-    const char *key
+    const char *key,
+    int key_string_id
 ) const {
 
   if (first > last)
@@ -273,213 +400,168 @@ int PawPrint::findRawIdxOfValue (
 
   int mid = (first + last) / 2;
   auto mid_pair_idx = sorted_map_datas[mid];
-  auto mid_key_idx = getKeyRawIdxOfPair(mid_pair_idx);
-  auto mid_key = getStrValue(mid_key_idx);
 
-  auto cmp_res = strcmp(key, mid_key);
+  auto cmp_res = -compareKey(mid_pair_idx, key, key_string_id);
   if (cmp_res < 0)
-    return findRawIdxOfValue(sorted_map_datas, first, mid - 1, key);
+    return findRawIdxOfValue(sorted_map_datas, first, mid - 1, key, key_string_id);
   else if (cmp_res > 0)
-    return findRawIdxOfValue(sorted_map_datas, mid + 1, last, key);
+    return findRawIdxOfValue(sorted_map_datas, mid + 1, last, key, key_string_id);
   else
     return mid_pair_idx;
 }
 
 
-int PawPrint::pushNull (uint column, uint line) {
-  if (is_closed_ == true)
-    return-1;
-
-  last_pushed_idx_ = raw_data_.size();
-  raw_data_.resize(last_pushed_idx_ + sizeof(DataType));
-  *((DataType*)&raw_data_[last_pushed_idx_]) = Data::TYPE_NULL;
+int PawPrint::compareKey (int pair_idx, const char *key, int key_string_id) const {
+  auto key_idx = getKeyRawIdxOfPair(pair_idx);
 
-  if (column > 0)
-    column_map_[last_pushed_idx_] = column;
-  if (line > 0)
-    line_map_[last_pushed_idx_] = line;
+  // ids are ordered as strings once string table is written
+  if (key_string_id >= 0 && string_idxs_.size() > 0) {
+    auto id = getStringId(key_idx);
+    if (id >= 0)
+      return (id < key_string_id)? -1: (id > key_string_id)? 1: 0;
+  }
 
-  return last_pushed_idx_;
+  return strcmp(getStrValue(key_idx), key);
 }
 
 
-template<typename T>
-int __pushNumber (
-    PawPrint const* paw_print,
-    vector<byte>& raw_data,
-    int& last_pushed_idx,
-    unordered_map<int, uint>& column_map,
-    unordered_map<int, uint>& line_map,
-    DataType data_type,
-    T value,
-    uint column,
-    uint line
-) {
-  if (paw_print->is_closed() == true)
-    return -1;
+size_t PawPrint::_appendRawData (size_t size) {
+  auto idx = raw_data_.size();
+  auto needed = idx + size;
+  if (needed > raw_data_.capacity())
+    raw_data_.reserve(std::max(needed, raw_data_.capacity() * 2));
+
+  raw_data_.resize(needed);
+  return idx;
+}
 
-  last_pushed_idx = raw_data.size();
-  raw_data.resize(last_pushed_idx + sizeof(DataType) + sizeof(T));
-  *((DataType*)&raw_data[last_pushed_idx                   ]) = data_type;
-  *((T*       )&raw_data[last_pushed_idx + sizeof(DataType)]) = value;
 
-  if (column > 0)
-    column_map[last_pushed_idx] = column;
-  if (line > 0)
-    line_map[last_pushed_idx] = line;
+void PawPrint::_addPosition (int idx, uint column, uint line) {
+  if (column <= 0 && line <= 0)
+    return;
 
-  return last_pushed_idx;
+  positions_.push_back({idx, column, line});
 }
 
 
-int PawPrint::pushSint1B (char value, uint column, uint line) {
-  return __pushNumber<char>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_SINT_1B,
-      value,
-      column,
-      line
+const PawPrint::SourcePosition* PawPrint::_findPosition (int idx) const {
+  auto itr = std::lower_bound(
+      positions_.begin(),
+      positions_.end(),
+      idx,
+      [](const SourcePosition &p, int idx) { return p.idx < idx; }
   );
+  if (itr == positions_.end() || itr->idx != idx)
+    return null;
+
+  return &*itr;
 }
 
 
-int PawPrint::pushUint1B (byte value, uint column, uint line) {
-  return __pushNumber<byte>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_UINT_1B,
-      value,
-      column,
-      line
-  );
-} 
+int PawPrint::_pushMark (DataType data_type, uint column, uint line) {
+  if (is_closed_ == true)
+    return -1;
 
+  last_pushed_idx_ = _appendRawData(sizeof(DataType));
+  _setRawData<DataType>(last_pushed_idx_, data_type);
 
-int PawPrint::pushSint2B (short value, uint column, uint line) {
-  return __pushNumber<short>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_SINT_2B,
-      value,
-      column,
-      line
-  );
-} 
+  _addPosition(last_pushed_idx_, column, line);
 
+  return last_pushed_idx_;
+}
 
-int PawPrint::pushUint2B (ushort value, uint column, uint line) {
-  return __pushNumber<ushort>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_UINT_2B,
-      value,
-      column,
-      line
-  );
-} 
 
+template <class T>
+int PawPrint::_pushNumber (DataType data_type, T value, uint column, uint line) {
+  if (is_closed_ == true)
+    return -1;
 
-int PawPrint::pushSint4B (int value, uint column, uint line) {
-  return __pushNumber<int>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_SINT_4B,
-      value,
-      column,
-      line
-  );
-} 
+  last_pushed_idx_ = _appendRawData(sizeof(DataType) + sizeof(T));
+  _setRawData<DataType>(last_pushed_idx_                   , data_type);
+  _setRawData<T       >(last_pushed_idx_ + sizeof(DataType), value    );
 
+  _addPosition(last_pushed_idx_, column, line);
 
-int PawPrint::pushUint4B (uint value, uint column, uint line) {
-  return __pushNumber<uint>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_UINT_4B,
-      value,
-      column,
-      line
-  );
-} 
+  return last_pushed_idx_;
+}
 
 
-int PawPrint::pushSint8B (int64 value, uint column, uint line) {
-  return __pushNumber<int64>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_SINT_8B,
-      value,
-      column,
-      line
-  );
-} 
+template <class T>
+int PawPrint::_pushNumberSequence (
+    DataType data_type,
+    span<const T> values,
+    uint column,
+    uint line
+) {
+  if (is_closed_ == true)
+    return -1;
 
+  // begin + (type, value) * n + end in one allocation
+  auto elem_size = sizeof(DataType) + sizeof(T);
+  auto idx = _appendRawData(sizeof(DataType) * 2 + elem_size * values.size());
+  _setRawData<DataType>(idx, Data::TYPE_SEQUENCE_START);
 
-int PawPrint::pushUint8B (uint64 value, uint column, uint line) {
-  return __pushNumber<uint64>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_UINT_8B,
-      value,
-      column,
-      line
-  );
-} 
+  auto elem_idx = idx + sizeof(DataType);
+  for (auto &v : values) {
+    _setRawData<DataType>(elem_idx                   , data_type);
+    _setRawData<T       >(elem_idx + sizeof(DataType), v        );
+    elem_idx += elem_size;
+  }
 
+  last_pushed_idx_ = elem_idx;
+  _setRawData<DataType>(last_pushed_idx_, Data::TYPE_SEQUENCE_END);
 
-int PawPrint::pushReal4B (float value, uint column, uint line) {
-  return __pushNumber<float>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_REAL_4B,
-      value,
-      column,
-      line
-  );
-} 
+  _addPosition(idx, column, line);
 
+  return idx;
+}
 
-int PawPrint::pushReal8B (double value, uint column, uint line) {
-  return __pushNumber<double>(
-      this,
-      raw_data_,
-      last_pushed_idx_,
-      column_map_,
-      line_map_,
-      PawPrint::Data::TYPE_REAL_8B,
-      value,
-      column,
-      line
-  );
-} 
+
+template <class T>
+int PawPrint::_pushNumberArray (span<const T> values, uint column, uint line) {
+  if (is_closed_ == true)
+    return -1;
+
+  // pad so the payload is aligned when raw_data is
+  auto header_end = raw_data_.size() + Data::ARRAY_HEADER_SIZE;
+  byte pad = (alignof(T) - header_end % alignof(T)) % alignof(T);
+  Data::ArraySizeType count = values.size();
+
+  last_pushed_idx_ = _appendRawData(Data::ARRAY_HEADER_SIZE + pad + sizeof(T) * count);
+  _setRawData<DataType>(last_pushed_idx_                       , Data::TYPE_ARRAY   );
+  _setRawData<DataType>(last_pushed_idx_ + sizeof(DataType)    , Data::typeOf<T>()  );
+  _setRawData<byte    >(last_pushed_idx_ + sizeof(DataType) * 2, pad                );
+  _setRawData<Data::ArraySizeType>(
+      last_pushed_idx_ + sizeof(DataType) * 2 + sizeof(byte), count);
+  if (count > 0) {
+    memcpy(
+        &raw_data_[last_pushed_idx_ + Data::ARRAY_HEADER_SIZE + pad],
+        values.data(),
+        sizeof(T) * count
+    );
+  }
+
+  _addPosition(last_pushed_idx_, column, line);
+
+  return last_pushed_idx_;
+}
+
+
+int PawPrint::pushNull (uint column, uint line) {
+  return _pushMark(Data::TYPE_NULL, column, line);
+}
+
+
+int PawPrint::pushSint1B (char   value, uint column, uint line) { return _pushNumber(Data::TYPE_SINT_1B, value, column, line); }
+int PawPrint::pushUint1B (byte   value, uint column, uint line) { return _pushNumber(Data::TYPE_UINT_1B, value, column, line); }
+int PawPrint::pushSint2B (short  value, uint column, uint line) { return _pushNumber(Data::TYPE_SINT_2B, value, column, line); }
+int PawPrint::pushUint2B (ushort value, uint column, uint line) { return _pushNumber(Data::TYPE_UINT_2B, value, column, line); }
+int PawPrint::pushSint4B (int    value, uint column, uint line) { return _pushNumber(Data::TYPE_SINT_4B, value, column, line); }
+int PawPrint::pushUint4B (uint   value, uint column, uint line) { return _pushNumber(Data::TYPE_UINT_4B, value, column, line); }
+int PawPrint::pushSint8B (int64  value, uint column, uint line) { return _pushNumber(Data::TYPE_SINT_8B, value, column, line); }
+int PawPrint::pushUint8B (uint64 value, uint column, uint line) { return _pushNumber(Data::TYPE_UINT_8B, value, column, line); }
+int PawPrint::pushReal4B (float  value, uint column, uint line) { return _pushNumber(Data::TYPE_REAL_4B, value, column, line); }
+int PawPrint::pushReal8B (double value, uint column, uint line) { return _pushNumber(Data::TYPE_REAL_8B, value, column, line); }
 
 
 int PawPrint::pushBool (bool value, uint column, uint line) {
@@ -487,29 +569,49 @@ int PawPrint::pushBool (bool value, uint column, uint line) {
 }
 
 
+int PawPrint::pushSequence (span<const char  > values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_SINT_1B, values, column, line); }
+int PawPrint::pushSequence (span<const byte  > values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_UINT_1B, values, column, line); }
+int PawPrint::pushSequence (span<const short > values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_SINT_2B, values, column, line); }
+int PawPrint::pushSequence (span<const ushort> values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_UINT_2B, values, column, line); }
+int PawPrint::pushSequence (span<const int   > values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_SINT_4B, values, column, line); }
+int PawPrint::pushSequence (span<const uint  > values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_UINT_4B, values, column, line); }
+int PawPrint::pushSequence (span<const int64 > values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_SINT_8B, values, column, line); }
+int PawPrint::pushSequence (span<const uint64> values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_UINT_8B, values, column, line); }
+int PawPrint::pushSequence (span<const float > values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_REAL_4B, values, column, line); }
+int PawPrint::pushSequence (span<const double> values, uint column, uint line) { return _pushNumberSequence(Data::TYPE_REAL_8B, values, column, line); }
+
+
+int PawPrint::pushArray (span<const char  > values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const byte  > values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const short > values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const ushort> values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const int   > values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const uint  > values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const int64 > values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const uint64> values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const float > values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+int PawPrint::pushArray (span<const double> values, uint column, uint line) { return _pushNumberArray(values, column, line); }
+
+
 int PawPrint::pushString (const char *value, uint column, uint line) {
   if (is_closed_ == true)
     return -1;
 
-  last_pushed_idx_ = raw_data_.size();
-  int str_count = strlen(value) + 1;
-  raw_data_.resize(
-      last_pushed_idx_
-        + sizeof(DataType)
+  Data::StrSizeType str_count = strlen(value) + 1;
+  last_pushed_idx_ = _appendRawData(
+      sizeof(DataType)
         + sizeof(Data::StrSizeType)
         + sizeof(const char) * str_count
   );
-  *((DataType*         )&raw_data_[last_pushed_idx_                   ]) = Data::TYPE_STRING;
-  *((Data::StrSizeType*)&raw_data_[last_pushed_idx_ + sizeof(DataType)]) = str_count;
-  auto p = (const char*)&raw_data_[
-      last_pushed_idx_ + sizeof(DataType) + sizeof(Data::StrSizeType)
-  ];
-  memcpy((void*)p, (void*)value, sizeof(const char) * str_count);
-
-  if (column > 0)
-    column_map_[last_pushed_idx_] = column;
-  if (line > 0)
-    line_map_[last_pushed_idx_] = line;
+  _setRawData<DataType         >(last_pushed_idx_                   , Data::TYPE_STRING);
+  _setRawData<Data::StrSizeType>(last_pushed_idx_ + sizeof(DataType), str_count        );
+  memcpy(
+      &raw_data_[last_pushed_idx_ + sizeof(DataType) + sizeof(Data::StrSizeType)],
+      value,
+      sizeof(const char) * str_count
+  );
+
+  _addPosition(last_pushed_idx_, column, line);
 
   return last_pushed_idx_;
 }
@@ -519,150 +621,197 @@ int PawPrint::pushReference (const shared_ptr<Cursor> &cursor, uint column, uint
   if (is_closed_ == true)
     return -1;
 
-  last_pushed_idx_ = raw_data_.size();
-  raw_data_.resize(
-      last_pushed_idx_
-        + sizeof(DataType)
-        + sizeof(Data::ReferenceIdxType)
-  );
-  *((DataType*              )&raw_data_[last_pushed_idx_                   ]) = Data::TYPE_REFERENCE;
-  *((Data::ReferenceIdxType*)&raw_data_[last_pushed_idx_ + sizeof(DataType)]) = references_.size();
+  last_pushed_idx_ = _appendRawData(sizeof(DataType) + sizeof(Data::ReferenceIdxType));
+  _setRawData<DataType              >(last_pushed_idx_                   , Data::TYPE_REFERENCE);
+  _setRawData<Data::ReferenceIdxType>(last_pushed_idx_ + sizeof(DataType), references_.size()  );
 
   references_.push_back(cursor);
 
-  if (column > 0)
-    column_map_[last_pushed_idx_] = column;
-  if (line > 0)
-    line_map_[last_pushed_idx_] = line;
+  _addPosition(last_pushed_idx_, column, line);
 
   return last_pushed_idx_;
 }
 
 
 int PawPrint::beginSequence (uint column, uint line) {
-  if (is_closed_ == true)
-    return -1;
+  return _pushMark(Data::TYPE_SEQUENCE_START, column, line);
+}
 
-  last_pushed_idx_ = raw_data_.size();
-  raw_data_.resize(last_pushed_idx_ + sizeof(DataType));
-  *((DataType*)&raw_data_[last_pushed_idx_]) = Data::TYPE_SEQUENCE_START;
 
-  if (column > 0)
-    column_map_[last_pushed_idx_] = column;
-  if (line > 0)
-    line_map_[last_pushed_idx_] = line;
+int PawPrint::endSequence (uint column, uint line) {
+  return _pushMark(Data::TYPE_SEQUENCE_END, column, line);
+}
 
-  return last_pushed_idx_;
+
+int PawPrint::pushKeyValuePair (uint column, uint line) {
+  return _pushMark(Data::TYPE_KEY_VALUE_PAIR, column, line);
 }
 
 
-int PawPrint::endSequence (uint column, uint line) {
+int PawPrint::pushKey (const char *value, uint column, uint line) {
   if (is_closed_ == true)
     return -1;
 
-  last_pushed_idx_ = raw_data_.size();
-  raw_data_.resize(last_pushed_idx_ + sizeof(DataType));
-  *((DataType*)&raw_data_[last_pushed_idx_]) = Data::TYPE_SEQUENCE_END;
+  auto idx = pushKeyValuePair(column, line);
 
-  if (column > 0)
-    column_map_[last_pushed_idx_] = column;
-  if (line > 0)
-    line_map_[last_pushed_idx_] = line;
+  pushString(value, column, line);
 
-  return last_pushed_idx_;
+  return idx;
 }
 
 
-int PawPrint::pushKeyValuePair (uint column, uint line) {
+int PawPrint::pushInternedString (const char *value, uint column, uint line) {
   if (is_closed_ == true)
     return -1;
 
-  last_pushed_idx_ = raw_data_.size();
-  raw_data_.resize(last_pushed_idx_ + sizeof(DataType));
-  *((DataType*)&raw_data_[last_pushed_idx_]) = Data::TYPE_KEY_VALUE_PAIR;
+  // provisional id. it will be sorted on pushStringTable()
+  auto itr = interned_id_map_.find(value);
+  Data::StringIdType id;
+  if (itr != interned_id_map_.end()) {
+    id = itr->second;
+  }else {
+    id = interned_strings_.size();
+    interned_strings_.push_back(value);
+    interned_id_map_[value] = id;
+  }
+
+  last_pushed_idx_ = _appendRawData(sizeof(DataType) + sizeof(Data::StringIdType));
+  _setRawData<DataType          >(last_pushed_idx_                   , Data::TYPE_STRING_REF);
+  _setRawData<Data::StringIdType>(last_pushed_idx_ + sizeof(DataType), id                   );
+  string_ref_idxs_.push_back(last_pushed_idx_);
 
-  if (column > 0)
-    column_map_[last_pushed_idx_] = column;
-  if (line > 0)
-    line_map_[last_pushed_idx_] = line;
+  _addPosition(last_pushed_idx_, column, line);
 
   return last_pushed_idx_;
 }
 
 
-int PawPrint::pushKey (const char *value, uint column, uint line) {
+int PawPrint::pushInternedKey (const char *value, uint column, uint line) {
   if (is_closed_ == true)
     return -1;
 
   auto idx = pushKeyValuePair(column, line);
 
-  pushString(value, column, line);
+  pushInternedString(value, column, line);
 
   return idx;
 }
 
 
-int PawPrint::beginMap (uint column, uint line) {
+int PawPrint::pushStringTable () {
   if (is_closed_ == true)
     return -1;
 
-  last_pushed_idx_ = raw_data_.size();
-  raw_data_.resize(last_pushed_idx_ + sizeof(DataType));
-  *((DataType*)&raw_data_[last_pushed_idx_]) = Data::TYPE_MAP_START;
+  // sort strings, then fix ids of references
+  vector<Data::StringIdType> order(interned_strings_.size());
+  for (int si=0; si<order.size(); ++si)
+    order[si] = si;
+  std::sort(order.begin(), order.end(), [this](Data::StringIdType a, Data::StringIdType b) {
+    return interned_strings_[a] < interned_strings_[b];
+  });
+
+  vector<Data::StringIdType> new_ids(order.size());
+  for (int si=0; si<order.size(); ++si)
+    new_ids[order[si]] = si;
+
+  for (auto ref_idx : string_ref_idxs_) {
+    auto id = getStringId(ref_idx);
+    _setRawData<Data::StringIdType>(ref_idx + sizeof(DataType), new_ids[id]);
+  }
 
-  if (column > 0)
-    column_map_[last_pushed_idx_] = column;
-  if (line > 0)
-    line_map_[last_pushed_idx_] = line;
+  // write table
+  auto table_idx = _appendRawData(sizeof(DataType) + sizeof(uint));
+  _setRawData<DataType>(table_idx                   , Data::TYPE_STRING_TABLE);
+  _setRawData<uint    >(table_idx + sizeof(DataType), (uint)order.size()     );
+  for (auto id : order)
+    pushString(interned_strings_[id]);
 
-  return last_pushed_idx_;
+  interned_id_map_ .clear();
+  interned_strings_.clear();
+  string_ref_idxs_ .clear();
+  _loadStringTable(table_idx);
+
+  last_pushed_idx_ = table_idx;
+  is_closed_ = true;
+
+  return table_idx;
 }
 
 
-int PawPrint::endMap (uint column, uint line) {
-  if (is_closed_ == true)
-    return -1;
+void PawPrint::_loadStringTable (int table_idx) {
+  string_idxs_.clear();
+  string_id_map_.clear();
 
-  last_pushed_idx_ = raw_data_.size();
-  raw_data_.resize(last_pushed_idx_ + sizeof(DataType));
-  *((DataType*)&raw_data_[last_pushed_idx_]) = Data::TYPE_MAP_END;
+  uint count;
+  memcpy(&count, &raw_data_[table_idx + sizeof(DataType)], sizeof(count));
+  string_idxs_.reserve(count);
 
-  if (column > 0)
-    column_map_[last_pushed_idx_] = column;
-  if (line > 0)
-    line_map_[last_pushed_idx_] = line;
+  auto idx = table_idx + sizeof(DataType) + sizeof(count);
+  for (uint si=0; si<count; ++si) {
+    string_idxs_.push_back(idx);
+    idx += dataSize(idx);
+  }
+}
 
-  return last_pushed_idx_;
+
+int PawPrint::beginMap (uint column, uint line) {
+  return _pushMark(Data::TYPE_MAP_START, column, line);
+}
+
+
+int PawPrint::endMap (uint column, uint line) {
+  return _pushMark(Data::TYPE_MAP_END, column, line);
 }
 
 
 void PawPrint::setRawData (const vector<byte> &raw_data) {
   raw_data_ = raw_data;
+  string_idxs_.clear();
+  string_id_map_.clear();
+  aligned_array_copies_.clear();
+
+  if (raw_data_.size() <= 0)
+    return;
+
+  // string table is right after root data
+  auto table_idx = dataSize(0);
+  if (table_idx < raw_data_.size() && type(table_idx) == Data::TYPE_STRING_TABLE) {
+    _loadStringTable(table_idx);
+    is_closed_ = true;
+  }
+}
+
+
+void PawPrint::reserve (size_t raw_data_size, size_t position_count) {
+  raw_data_.reserve(raw_data_size);
+  positions_.reserve(position_count);
 }
 
 
 uint PawPrint::getColumn (int idx) const {
-  if (column_map_.find(idx) == column_map_.end())
+  auto p = _findPosition(idx);
+  if (p == null)
     return 0;
 
-  return column_map_.at(idx);
+  return p->column;
 }
 
 
 uint PawPrint::getLine (int idx) const {
-  if (line_map_.find(idx) == line_map_.end())
+  auto p = _findPosition(idx);
+  if (p == null)
     return 0;
 
-  return line_map_.at(idx);
+  return p->line;
 }
 
 
 uint PawPrint::findMaxLine () const {
   uint max_line = 0;
 
-  for (auto &itr : line_map_) {
-    if (itr.second > max_line)
-      max_line = itr.second;
+  for (auto &p : positions_) {
+    if (p.line > max_line)
+      max_line = p.line;
   }
 
   return max_line;
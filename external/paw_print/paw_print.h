@@ -1,9 +1,12 @@
 #ifndef EXTERNAL_PAW_PRINT_SRC_PAW_PRINT
 #define EXTERNAL_PAW_PRINT_SRC_PAW_PRINT
 
+#include <cstring>
 #include <iostream>
+#include <span>
 #include <stack>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -18,6 +21,7 @@ namespace paw_print {
 
 using std::cout;
 using std::endl;
+using std::span;
 using std::stack;
 using std::string;
 using std::unordered_map;
@@ -58,6 +62,8 @@ public:
   public:
     using StrSizeType = unsigned short;
     using ReferenceIdxType = uint;
+    using ArraySizeType = uint;
+    using StringIdType = uint;
 
 
     static const DataType TYPE_NONE = 0xff;
@@ -87,6 +93,45 @@ public:
     static const DataType TYPE_KEY_VALUE_PAIR = 16;
 
     static const DataType TYPE_REFERENCE = 17;
+
+    // [type][elem type][pad size][count][pad][elem * count]
+    // payload is aligned to elem size from the start of raw_data
+    static const DataType TYPE_ARRAY = 18;
+
+    // [type][string id] . string is stored once on TYPE_STRING_TABLE
+    static const DataType TYPE_STRING_REF = 19;
+
+    // [type][count][TYPE_STRING * count] . placed right after root data.
+    // strings are sorted, so comparing ids is same as comparing strings
+    static const DataType TYPE_STRING_TABLE = 20;
+
+    static const int ARRAY_HEADER_SIZE =
+        sizeof(DataType) * 2 + sizeof(byte) + sizeof(ArraySizeType);
+
+    static int numberSize (DataType type);
+
+    template <class T>
+    static constexpr DataType typeOf () {
+      if constexpr (std::is_same_v<T, char  >) return TYPE_SINT_1B;
+      if constexpr (std::is_same_v<T, byte  >) return TYPE_UINT_1B;
+      if constexpr (std::is_same_v<T, short >) return TYPE_SINT_2B;
+      if constexpr (std::is_same_v<T, ushort>) return TYPE_UINT_2B;
+      if constexpr (std::is_same_v<T, int   >) return TYPE_SINT_4B;
+      if constexpr (std::is_same_v<T, uint  >) return TYPE_UINT_4B;
+      if constexpr (std::is_same_v<T, int64 >) return TYPE_SINT_8B;
+      if constexpr (std::is_same_v<T, uint64>) return TYPE_UINT_8B;
+      if constexpr (std::is_same_v<T, float >) return TYPE_REAL_4B;
+      if constexpr (std::is_same_v<T, double>) return TYPE_REAL_8B;
+      return TYPE_NONE;
+    }
+  };
+
+  // column/line of a pushed data. kept sorted by idx (pushes only append)
+  class PAW_PRINT_API SourcePosition {
+  public:
+    int  idx;
+    uint column;
+    uint line;
   };
 
 
@@ -143,6 +188,9 @@ public:
 
   void setRawData (const vector<byte> &raw_data);
 
+  // reserve bytes for writing. growth after it is geometric
+  void reserve (size_t raw_data_size, size_t position_count=0);
+
   uint getColumn (int idx) const;
   uint getLine (int idx) const;
   uint findMaxLine () const;
@@ -179,16 +227,69 @@ public:
 
   int pushKeyValuePair (uint column=0, uint line=0);
 
+  // push a whole sequence of numbers at once. returns idx of sequence start
+  int pushSequence (span<const char  > values, uint column=0, uint line=0);
+  int pushSequence (span<const byte  > values, uint column=0, uint line=0);
+  int pushSequence (span<const short > values, uint column=0, uint line=0);
+  int pushSequence (span<const ushort> values, uint column=0, uint line=0);
+  int pushSequence (span<const int   > values, uint column=0, uint line=0);
+  int pushSequence (span<const uint  > values, uint column=0, uint line=0);
+  int pushSequence (span<const int64 > values, uint column=0, uint line=0);
+  int pushSequence (span<const uint64> values, uint column=0, uint line=0);
+  int pushSequence (span<const float > values, uint column=0, uint line=0);
+  int pushSequence (span<const double> values, uint column=0, uint line=0);
+
+  // push numbers as one packed TYPE_ARRAY. read it with Cursor::getArray<T>()
+  int pushArray (span<const char  > values, uint column=0, uint line=0);
+  int pushArray (span<const byte  > values, uint column=0, uint line=0);
+  int pushArray (span<const short > values, uint column=0, uint line=0);
+  int pushArray (span<const ushort> values, uint column=0, uint line=0);
+  int pushArray (span<const int   > values, uint column=0, uint line=0);
+  int pushArray (span<const uint  > values, uint column=0, uint line=0);
+  int pushArray (span<const int64 > values, uint column=0, uint line=0);
+  int pushArray (span<const uint64> values, uint column=0, uint line=0);
+  int pushArray (span<const float > values, uint column=0, uint line=0);
+  int pushArray (span<const double> values, uint column=0, uint line=0);
+
   int pushKey (const char *value, uint column=0, uint line=0);
   inline int pushKey (const string &value, uint column=0, uint line=0) {
     return pushKey(value.c_str(), column, line);
   }
 
+  // store value once on string table and push a reference to it.
+  // pushStringTable() must be called after the root data is done
+  int pushInternedString (const char *value, uint column=0, uint line=0);
+  inline int pushInternedString (const string &value, uint column=0, uint line=0) {
+    return pushInternedString(value.c_str(), column, line);
+  }
+
+  int pushInternedKey (const char *value, uint column=0, uint line=0);
+  inline int pushInternedKey (const string &value, uint column=0, uint line=0) {
+    return pushInternedKey(value.c_str(), column, line);
+  }
+
+  // write interned strings and close PawPrint
+  int pushStringTable ();
+
 
   // read
   Data::StrSizeType getStrSize (int idx) const;
   const char* getStrValue (int idx) const;
 
+  // -1 if data on idx is not interned
+  int getStringId (int idx) const;
+  // -1 if not on string table
+  int findStringId (const char *value) const;
+  inline int string_count () const { return string_idxs_.size(); }
+
+  DataType getArrayElemType (int idx) const;
+  Data::ArraySizeType getArraySize (int idx) const;
+  const byte* getArrayData (int idx) const;
+  // payload at an address aligned to align. a payload that lost its alignment,
+  // like one copied to an odd offset by operator = (cursor), is copied once
+  // to an aligned buffer kept with this
+  const byte* getAlignedArrayData (int idx, int align) const;
+
   int getKeyRawIdxOfPair   (int pair_idx) const;
   int getValueRawIdxOfPair (int pair_idx) const;
 
@@ -207,7 +308,11 @@ public:
       const vector<int> &map_datas,
       int first,
       int last,
-      const char *key) const;
+      const char *key,
+      int key_string_id = -1) const;
+
+  // compare key of pair with key. compare ids if both are interned
+  int compareKey (int pair_idx, const char *key, int key_string_id) const;
 
 
 private:
@@ -216,6 +321,7 @@ private:
   mutable unordered_map<int, vector<int>> data_idxs_of_sequence_map_;
   mutable unordered_map<int, vector<int>> data_idxs_of_map_map_;
   mutable unordered_map<int, vector<int>> sorted_data_idxs_of_map_map_;
+  mutable unordered_map<int, vector<uint64>> aligned_array_copies_;
   bool is_closed_;
   int last_pushed_idx_;
 
@@ -223,14 +329,42 @@ private:
 
   stack<int> curly_open_idx_stack_;
   stack<int> square_open_idx_stack_;
-  unordered_map<int, uint> column_map_;
-  unordered_map<int, uint> line_map_;
+  vector<SourcePosition> positions_;
+
+  // string table
+  vector<int> string_idxs_;  // raw idx of each string on table
+  mutable unordered_map<string, int> string_id_map_;
+  unordered_map<string, Data::StringIdType> interned_id_map_;  // for writing
+  vector<string> interned_strings_;
+  vector<int> string_ref_idxs_;
+
+  void _loadStringTable (int table_idx);
 
 
   template <class T>
   const T& _getRawData (int idx) const {
     return *((T*)&raw_data_[idx]);
   }
+
+  template <class T>
+  inline void _setRawData (size_t idx, T value) {
+    memcpy(&raw_data_[idx], &value, sizeof(T));
+  }
+
+  size_t _appendRawData (size_t size);
+  void _addPosition (int idx, uint column, uint line);
+  const SourcePosition* _findPosition (int idx) const;
+
+  int _pushMark (DataType data_type, uint column, uint line);
+
+  template <class T>
+  int _pushNumber (DataType data_type, T value, uint column, uint line);
+
+  template <class T>
+  int _pushNumberSequence (DataType data_type, span<const T> values, uint column, uint line);
+
+  template <class T>
+  int _pushNumberArray (span<const T> values, uint column, uint line);
 };
 
 }
@@ -0,0 +1,88 @@
+#include "./cache_file.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+
+namespace parse_table {
+
+namespace fs = std::filesystem;
+
+using std::cout;
+using std::endl;
+using std::ofstream;
+
+
+static void _pushUint (vector<unsigned char> &buffer, uint64_t value, int size) {
+	for (int bi=0; bi<size; ++bi)
+		buffer.push_back((unsigned char)(value >> (bi * 8)));
+}
+
+static uint64_t _readUint (const unsigned char *data, int size) {
+	uint64_t value = 0;
+	for (int bi=0; bi<size; ++bi)
+		value |= (uint64_t)data[bi] << (bi * 8);
+	return value;
+}
+
+
+CacheFileFormat::CacheFileFormat (const char (&magic)[5], uint32_t version, int field_count)
+:version_(version),
+ field_count_(field_count) {
+	std::copy(magic, magic + 4, magic_);
+}
+
+vector<unsigned char> CacheFileFormat::make (const vector<uint64_t> &fields, const unsigned char *data, size_t size) const {
+	vector<unsigned char> file(magic_, magic_ + 4);
+	file.reserve(headerSize() + size);
+	_pushUint(file, version_, 4);
+	for (int fi=0; fi<field_count_; ++fi)
+		_pushUint(file, (fi < fields.size())? fields[fi]: 0, 8);
+	file.insert(file.end(), data, data + size);
+	return file;
+}
+
+vector<uint64_t> CacheFileFormat::readFields (const unsigned char *file, size_t size) const {
+	vector<uint64_t> fields;
+	if (file == null || size < headerSize()
+			|| std::equal(magic_, magic_ + 4, file) == false
+			|| _readUint(file + 4, 4) != version_)
+		return fields;
+
+	for (int fi=0; fi<field_count_; ++fi)
+		fields.push_back(_readUint(file + 8 + fi * 8, 8));
+	return fields;
+}
+
+bool CacheFileFormat::write (const string &path, const vector<unsigned char> &file, const string &kind) {
+	std::error_code ec;
+	auto temp_path = path + ".tmp" + std::to_string(std::random_device()());
+	{
+		ofstream os(temp_path, std::ofstream::binary | std::ofstream::trunc);
+		if (os.is_open() == false) {
+			// TODO err: cannot write {temp_path}
+			cout << "err: cannot write " << kind << " \'" << temp_path << "\'" << endl;
+			return false;
+		}
+		os.write((const char*)file.data(), file.size());
+		if (os.good() == false) {
+			os.close();
+			fs::remove(temp_path, ec);
+			cout << "err: cannot write " << kind << " \'" << temp_path << "\'" << endl;
+			return false;
+		}
+	}
+
+	fs::rename(temp_path, path, ec);
+	if (ec) {
+		fs::remove(temp_path, ec);
+		cout << "err: cannot move " << kind << " to \'" << path << "\'" << endl;
+		return false;
+	}
+	return true;
+}
+
+}
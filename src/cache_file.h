@@ -0,0 +1,47 @@
+#ifndef PAW_PRINT_CACHE_FILE
+#define PAW_PRINT_CACHE_FILE
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::string;
+using std::vector;
+
+
+// layout of the files of ParsingTableCache and ParseTreeCache.
+// a file is magic, version and field_count 8 byte fields, then its data.
+// numbers are little endian
+class CacheFileFormat {
+public:
+	CacheFileFormat (const char (&magic)[5], uint32_t version, int field_count);
+
+	inline size_t headerSize () const { return 4 + 4 + 8 * field_count_; }
+
+	// header with fields, then data
+	vector<unsigned char> make (const vector<uint64_t> &fields, const unsigned char *data, size_t size) const;
+
+	// fields of the header of file, empty if it is too short
+	// or has another magic or version
+	vector<uint64_t> readFields (const unsigned char *file, size_t size) const;
+
+	// written to a unique temp name and renamed, so processes storing the
+	// same file don't mix writes and a reader never sees half of one.
+	// kind names the file in errors
+	static bool write (const string &path, const vector<unsigned char> &file, const string &kind);
+
+private:
+	char magic_[4];
+	uint32_t version_;
+	int field_count_;
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
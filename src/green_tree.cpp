@@ -0,0 +1,201 @@
+#include "green_tree.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "./defines.h"
+
+
+namespace parse_table {
+
+static inline void _combine (size_t &hash, size_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+}
+
+GreenNode::GreenNode (
+        const shared_ptr<TerminalBase> &termnon,
+        int reduced_rule_idx,
+        string_view text,
+        int leading,
+        vector<const GreenNode*> &&children)
+:termnon_(termnon),
+ reduced_rule_idx_(reduced_rule_idx),
+ text_(text),
+ leading_(leading),
+ width_(leading + text.size()),
+ children_(std::move(children)),
+ hash_(hashOf(termnon, reduced_rule_idx, text, leading, children_)) {
+
+    for (auto child : children_)
+        width_ += child->width_;
+}
+
+size_t GreenNode::hashOf (
+        const shared_ptr<TerminalBase> &termnon,
+        int reduced_rule_idx,
+        string_view text,
+        int leading,
+        span<const GreenNode* const> children) {
+    size_t hash = 0;
+    _combine(hash, std::hash<const void*>()(termnon.get()));
+    _combine(hash, reduced_rule_idx);
+    _combine(hash, std::hash<string_view>()(text));
+    _combine(hash, leading);
+    for (auto child : children)
+        _combine(hash, std::hash<const void*>()(child));
+    return hash;
+}
+
+bool GreenNode::isSame (const GreenNode &other) const {
+    return hash_ == other.hash_
+            && termnon_ == other.termnon_
+            && reduced_rule_idx_ == other.reduced_rule_idx_
+            && leading_ == other.leading_
+            && text_ == other.text_
+            && children_ == other.children_;
+}
+
+
+bool GreenInterner::Key::isSame (const GreenNode &node) const {
+    return hash == node.hash()
+            && termnon == node.termnon()
+            && reduced_rule_idx == node.reduced_rule_idx()
+            && leading == node.leading()
+            && text == node.text()
+            && std::equal(children.begin(), children.end(), node.children().begin(), node.children().end());
+}
+
+GreenInterner::GreenInterner ()
+:request_count_(0) {
+}
+
+const GreenNode* GreenInterner::intern (
+        const shared_ptr<TerminalBase> &termnon,
+        int reduced_rule_idx,
+        string_view text,
+        int leading,
+        vector<const GreenNode*> &&children) {
+    auto hash = GreenNode::hashOf(termnon, reduced_rule_idx, text, leading, children);
+    return _intern(Key{ termnon, reduced_rule_idx, text, leading, children, hash }, &children);
+}
+
+const GreenNode* GreenInterner::_intern (const Key &key, vector<const GreenNode*> *owned_children) {
+    ++request_count_;
+
+    auto itr = table_.find(key);
+    if (itr != table_.end())
+        return *itr;
+
+    auto children = (owned_children != null)?
+            std::move(*owned_children):
+            vector<const GreenNode*>(key.children.begin(), key.children.end());
+    nodes_.emplace_back(key.termnon, key.reduced_rule_idx, key.text, key.leading, std::move(children));
+    table_.insert(&nodes_.back());
+    return &nodes_.back();
+}
+
+const GreenNode* GreenInterner::intern (const Node &root, const char *text) {
+    // post order, children of a node are the top of results
+    vector<const GreenNode*> results;
+    vector<int> begins;
+    int prev_end = 0;
+
+    NodeWalker walker;
+    walker.walk(root,
+        [&](const Node&, int) {
+            begins.push_back(results.size());
+            return true;
+        },
+        [&](const Node &node, int) {
+            auto begin = begins.back();
+            begins.pop_back();
+
+            auto token = node.token();
+            if (node.termnon() == null || node.termnon()->isTerminal() == true) {
+                string_view leaf_text;
+                int leading = 0;
+                if (token != null) {
+                    if (text != null && token->last_idx >= token->first_idx)
+                        leaf_text = string_view(text + token->first_idx, token->last_idx + 1 - token->first_idx);
+                    leading = token->first_idx - prev_end;
+                    prev_end = token->last_idx + 1;
+                }
+                auto hash = GreenNode::hashOf(node.termnon(), -1, leaf_text, leading, {});
+                results.push_back(_intern(Key{ node.termnon(), -1, leaf_text, leading, {}, hash }, null));
+                return;
+            }
+
+            // children stay in results until the node is found or made
+            span<const GreenNode* const> children(results.data() + begin, results.size() - begin);
+            auto hash = GreenNode::hashOf(node.termnon(), node.reduced_rule_idx(), "", 0, children);
+            auto green = _intern(Key{ node.termnon(), node.reduced_rule_idx(), "", 0, children, hash }, null);
+            results.resize(begin);
+            results.push_back(green);
+        });
+
+    return results.back();
+}
+
+
+GreenCursor::GreenCursor (const GreenNode *root) {
+    path_.push_back(Frame{ root, 0, 0 });
+}
+
+int GreenCursor::textOffset () const {
+    auto node = path_.back().node;
+    int offset = path_.back().offset;
+    while (node->isLeaf() == false) {
+        // children without width, like epsilon nonterminals, have no text
+        // and don't move the offset
+        const GreenNode *next = null;
+        for (auto child : node->children()) {
+            if (child->width() > 0) {
+                next = child;
+                break;
+            }
+        }
+        if (next == null)
+            return offset;
+        node = next;
+    }
+    return offset + node->leading();
+}
+
+bool GreenCursor::gotoFirstChild () {
+    auto &frame = path_.back();
+    if (frame.node->children().empty() == true)
+        return false;
+    path_.push_back(Frame{ frame.node->children()[0], frame.offset, 0 });
+    return true;
+}
+
+bool GreenCursor::gotoNextSibling () {
+    if (path_.size() < 2)
+        return false;
+    auto &frame = path_.back();
+    auto &siblings = path_[path_.size() - 2].node->children();
+    if (frame.child_idx + 1 >= siblings.size())
+        return false;
+    frame.offset += frame.node->width();
+    frame.node = siblings[++frame.child_idx];
+    return true;
+}
+
+bool GreenCursor::gotoParent () {
+    if (path_.size() < 2)
+        return false;
+    path_.pop_back();
+    return true;
+}
+
+bool GreenCursor::gotoNext () {
+    if (gotoFirstChild() == true)
+        return true;
+    while (gotoNextSibling() == false) {
+        if (gotoParent() == false)
+            return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,168 @@
+#ifndef PAW_PRINT_GREEN_TREE
+#define PAW_PRINT_GREEN_TREE
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "./node.h"
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::deque;
+using std::shared_ptr;
+using std::span;
+using std::string;
+using std::string_view;
+using std::unordered_set;
+using std::vector;
+
+
+// immutable parse tree node without parent and token pointers.
+// a leaf keeps its text and leading, the chars from the end of the previous
+// token, so positions are relative and same subtrees are the same node.
+// made only by GreenInterner, which owns it
+class PAW_PRINT_API GreenNode {
+public:
+    PAW_GETTER(const shared_ptr<TerminalBase>&, termnon)
+    PAW_GETTER(int, reduced_rule_idx)   // -1 for leaves
+    PAW_GETTER(const string&, text)     // empty for nonterminals
+    PAW_GETTER(int, leading)
+    PAW_GETTER(int, width)              // leading and text of every leaf under it
+    PAW_GETTER(const vector<const GreenNode*>&, children)
+    PAW_GETTER(size_t, hash)
+
+    inline bool isLeaf () const { return termnon_ == null || termnon_->isTerminal(); }
+
+    GreenNode (
+            const shared_ptr<TerminalBase> &termnon,
+            int reduced_rule_idx,
+            string_view text,
+            int leading,
+            vector<const GreenNode*> &&children);
+
+    // children are compared by pointer, they are interned already
+    bool isSame (const GreenNode &other) const;
+
+    // hash of a node of these fields, so it can be looked up before it is made
+    static size_t hashOf (
+            const shared_ptr<TerminalBase> &termnon,
+            int reduced_rule_idx,
+            string_view text,
+            int leading,
+            span<const GreenNode* const> children);
+
+private:
+    shared_ptr<TerminalBase> termnon_;
+    int reduced_rule_idx_;
+    string text_;
+    int leading_;
+    int width_;
+    vector<const GreenNode*> children_;
+    size_t hash_;
+};
+
+// hash table of green nodes. a subtree that is structurally the same as one
+// interned before, from the same or another parse, is that node,
+// so trees of one interner are equal if and only if the roots are equal
+class PAW_PRINT_API GreenInterner {
+public:
+    PAW_GETTER(long long, request_count)    // nodes asked for, shared or not
+
+    GreenInterner ();
+
+    GreenInterner (const GreenInterner&) = delete;
+    GreenInterner& operator= (const GreenInterner&) = delete;
+
+    inline int size () const { return nodes_.size(); }
+
+    // text is the text the tokens of root point to
+    const GreenNode* intern (const Node &root, const char *text);
+
+    const GreenNode* intern (
+            const shared_ptr<TerminalBase> &termnon,
+            int reduced_rule_idx,
+            string_view text,
+            int leading,
+            vector<const GreenNode*> &&children);
+
+private:
+    // fields of a node looked up without making it, so a hit allocates nothing
+    class Key {
+    public:
+        const shared_ptr<TerminalBase> &termnon;
+        int reduced_rule_idx;
+        string_view text;
+        int leading;
+        span<const GreenNode* const> children;
+        size_t hash;
+
+        bool isSame (const GreenNode &node) const;
+    };
+    class Hash {
+    public:
+        using is_transparent = void;
+        inline size_t operator() (const GreenNode *node) const { return node->hash(); }
+        inline size_t operator() (const Key &key) const { return key.hash; }
+    };
+    class Equal {
+    public:
+        using is_transparent = void;
+        inline bool operator() (const GreenNode *a, const GreenNode *b) const { return a->isSame(*b); }
+        inline bool operator() (const Key &key, const GreenNode *node) const { return key.isSame(*node); }
+        inline bool operator() (const GreenNode *node, const Key &key) const { return key.isSame(*node); }
+    };
+
+    deque<GreenNode> nodes_;    // never moved
+    unordered_set<const GreenNode*, Hash, Equal> table_;
+    long long request_count_;
+
+    // children are moved from owned_children if given, else copied from key
+    const GreenNode* _intern (const Key &key, vector<const GreenNode*> *owned_children);
+};
+
+// position in a green tree with the offsets computed on the way down,
+// like a red node made on demand. the path is kept in the cursor,
+// so green nodes need no parent
+class PAW_PRINT_API GreenCursor {
+public:
+    GreenCursor (const GreenNode *root);
+
+    inline const GreenNode* node () const { return path_.back().node; }
+    inline int depth () const { return path_.size() - 1; }
+
+    // start of the node, leading included
+    inline int offset () const { return path_.back().offset; }
+    // start of the first text under the node
+    int textOffset () const;
+
+    bool gotoFirstChild ();
+    bool gotoNextSibling ();
+    bool gotoParent ();
+
+    // next node in preorder, false at the end
+    bool gotoNext ();
+
+private:
+    class Frame {
+    public:
+        const GreenNode *node;
+        int offset;
+        int child_idx;  // in the parent
+    };
+
+    vector<Frame> path_;
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
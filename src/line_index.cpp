@@ -0,0 +1,61 @@
+#include "line_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "./defines.h"
+
+
+namespace parse_table {
+
+LineIndex::LineIndex (const char *text)
+:text_(text),
+ length_((text == null)? 0: strlen(text)) {
+    _build();
+}
+
+LineIndex::LineIndex (const char *text, size_t length)
+:text_(text),
+ length_(length) {
+    _build();
+}
+
+void LineIndex::_build () {
+    line_starts_.push_back(0);
+    if (text_ == null)
+        return;
+
+    // memchr is vectorized by the c library, much faster than a char loop
+    auto begin = text_;
+    auto end = text_ + length_;
+    for (auto p = begin; p < end; ) {
+        auto newline = (const char*)memchr(p, '\n', end - p);
+        if (newline == null)
+            break;
+        line_starts_.push_back(newline + 1 - begin);
+        p = newline + 1;
+    }
+}
+
+unsigned int LineIndex::lineOf (size_t offset) const {
+    offset = std::min(offset, length_);
+    auto itr = std::upper_bound(line_starts_.begin(), line_starts_.end(), (uint32_t)offset);
+    return (itr - line_starts_.begin()) - 1;
+}
+
+TextPosition LineIndex::position (size_t offset) const {
+    offset = std::min(offset, length_);
+    auto line = lineOf(offset);
+    auto line_start = line_starts_[line];
+
+    unsigned short indent = 0;
+    for (auto i = line_start; i < length_ && (text_[i] == ' ' || text_[i] == '\t'); ++i) {
+        if (indent == UINT16_MAX)
+            break;
+        ++indent;
+    }
+
+    return TextPosition{ line, (unsigned int)(offset - line_start), indent };
+}
+
+}
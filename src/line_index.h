@@ -0,0 +1,52 @@
+#ifndef PAW_PRINT_LINE_INDEX
+#define PAW_PRINT_LINE_INDEX
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::vector;
+
+
+class TextPosition {
+public:
+    unsigned int line;      // 0 based
+    unsigned int column;    // 0 based, in chars from line start
+    unsigned short indent;  // leading spaces and tabs of the line
+};
+
+// line starts of a text, so tokens can keep offsets only and
+// positions are found when asked, by binary search.
+// '\n' ends a line, a '\r' before it counts as part of the line
+class PAW_PRINT_API LineIndex {
+public:
+    PAW_GETTER(size_t, length)
+
+    // text ends with 0
+    LineIndex (const char *text);
+    LineIndex (const char *text, size_t length);
+
+    inline int line_count () const { return line_starts_.size(); }
+    inline uint32_t lineStart (int line) const { return line_starts_[line]; }
+
+    // offset past the end is clamped to the end
+    unsigned int lineOf (size_t offset) const;
+    TextPosition position (size_t offset) const;
+
+private:
+    const char *text_;
+    size_t length_;
+    vector<uint32_t> line_starts_;
+
+    void _build ();
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
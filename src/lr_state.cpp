@@ -0,0 +1,396 @@
+#include "./lr_state.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+
+namespace parse_table {
+
+using std::cout;
+using std::endl;
+using std::sort;
+using std::stringstream;
+
+
+GrammarIndex::GrammarIndex (
+		const vector<shared_ptr<Nonterminal>> &symbols,
+		const shared_ptr<Nonterminal> &start_symbol)
+:is_valid_(true),
+ start_symbol_(-1) {
+
+	// symbols ordered by pointer, end($) is null so it comes first
+	vector<shared_ptr<TerminalBase>> elems;
+	elems.push_back(null);
+	for (auto &non : symbols) {
+		elems.push_back(non);
+		for (auto &rule : non->rules) {
+			for (auto &termnon : rule.right_side)
+				elems.push_back(termnon);
+		}
+	}
+	sort(elems.begin(), elems.end(), [](auto &a, auto &b) { return a.get() < b.get(); });
+	elems.erase(std::unique(elems.begin(), elems.end()), elems.end());
+	elems.push_back(start_symbol);
+
+	symbols_ = elems;
+	for (int si=0; si<symbols_.size(); ++si) {
+		symbol_ids_[symbols_[si].get()] = si;
+		is_terminal_list_.push_back(si == END_SYMBOL || symbols_[si]->isTerminal());
+	}
+	start_symbol_ = symbols_.size() - 1;
+
+	// rules
+	unordered_map<const Rule*, int> rule_ids;
+	auto add_rules = [&](const shared_ptr<Nonterminal> &non) {
+		for (auto &r : non->rules) {
+			rule_ids[&r] = rules_.size();
+			rules_.push_back(&r);
+		}
+	};
+	add_rules(start_symbol);
+	for (auto &non : symbols)
+		add_rules(non);
+
+	rule_rhs_offsets_.push_back(0);
+	for (auto rule : rules_) {
+		rule_lefts_.push_back(findSymbol(rule->left_side.get()));
+		for (auto &termnon : rule->right_side)
+			rule_rhs_.push_back(findSymbol(termnon.get()));
+		rule_rhs_offsets_.push_back(rule_rhs_.size());
+	}
+
+	rules_of_offsets_.push_back(0);
+	for (int si=0; si<symbols_.size(); ++si) {
+		if (is_terminal_list_[si] == false) {
+			auto non = std::static_pointer_cast<Nonterminal>(symbols_[si]);
+			for (auto &r : non->rules) {
+				auto itr = rule_ids.find(&r);
+				if (itr == rule_ids.end()) {
+					// TODO err: nonterminal {non->name} is not added
+					cout << "err: nonterminal \'" << non->name << "\' is not added to generator" << endl;
+					is_valid_ = false;
+					break;
+				}
+				rules_of_.push_back(itr->second);
+			}
+		}
+		rules_of_offsets_.push_back(rules_of_.size());
+	}
+}
+
+int GrammarIndex::findSymbol (const TerminalBase *symbol) const {
+	auto itr = symbol_ids_.find(symbol);
+	if (itr == symbol_ids_.end())
+		return -1;
+	return itr->second;
+}
+
+
+static uint64_t _hashTerms (span<const int> terms) {
+	uint64_t hash = 14695981039346656037ull;
+	for (auto t : terms) {
+		hash ^= (uint32_t)t;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+LookaheadStore::LookaheadStore () {
+	offsets_.push_back(0);
+}
+
+int LookaheadStore::_find (uint64_t hash, span<const int> terms) const {
+	auto itr = ids_by_hash_.find(hash);
+	if (itr == ids_by_hash_.end())
+		return -1;
+
+	for (auto id = itr->second; id >= 0; id = next_same_hash_[id]) {
+		auto set = get(id);
+		if (std::equal(set.begin(), set.end(), terms.begin(), terms.end()))
+			return id;
+	}
+	return -1;
+}
+
+int LookaheadStore::intern (vector<int> &terms) {
+	sort(terms.begin(), terms.end());
+	terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+	auto hash = _hashTerms(terms);
+	auto id = _find(hash, terms);
+	if (id >= 0)
+		return id;
+
+	id = size();
+	elems_.insert(elems_.end(), terms.begin(), terms.end());
+	offsets_.push_back(elems_.size());
+
+	auto itr = ids_by_hash_.find(hash);
+	if (itr == ids_by_hash_.end()) {
+		next_same_hash_.push_back(-1);
+		ids_by_hash_[hash] = id;
+	}else {
+		next_same_hash_.push_back(itr->second);
+		itr->second = id;
+	}
+	return id;
+}
+
+int LookaheadStore::single (int term) {
+	scratch_.assign(1, term);
+	return intern(scratch_);
+}
+
+int LookaheadStore::unite (int id, int other) {
+	if (id == other || offsets_[other] == offsets_[other + 1])
+		return id;
+	if (offsets_[id] == offsets_[id + 1])
+		return other;
+	if (id > other)
+		std::swap(id, other);
+
+	uint64_t key = ((uint64_t)id << 32) | (uint32_t)other;
+	auto itr = unite_cache_.find(key);
+	if (itr != unite_cache_.end())
+		return itr->second;
+
+	auto a = get(id);
+	auto b = get(other);
+	scratch_.resize(a.size() + b.size());
+	scratch_.resize(std::set_union(a.begin(), a.end(), b.begin(), b.end(), scratch_.begin())
+			- scratch_.begin());
+
+	auto result = intern(scratch_);
+	unite_cache_[key] = result;
+	return result;
+}
+
+
+ClosureTemplates::ClosureTemplates (
+		const GrammarIndex &grammar,
+		const vector<int> &first_ids,
+		LookaheadStore &lookaheads)
+:order_offsets_(grammar.symbol_count(), -1),
+ order_sizes_(grammar.symbol_count(), 0),
+ is_added_(grammar.symbol_count(), false) {
+
+	vector<int> empty;
+	empty_id_ = lookaheads.intern(empty);
+
+	// edges in rule order without repeats, so walking them adds nons
+	// in the same order as walking rules
+	edge_offsets_.push_back(0);
+	for (int si=0; si<grammar.symbol_count(); ++si) {
+		int begin = edges_.size();
+		if (grammar.isTerminal(si) == false) {
+			for (auto rule_id : grammar.rulesOf(si)) {
+				auto rule_size = grammar.ruleSize(rule_id);
+				if (rule_size == 0 || grammar.isTerminal(grammar.ruleSymbol(rule_id, 0)) == true)
+					continue;
+
+				ClosureEdge edge{ grammar.ruleSymbol(rule_id, 0),
+						(rule_size == 1)? -1: first_ids[grammar.ruleSymbol(rule_id, 1)] };
+				auto is_repeated = std::any_of(edges_.begin() + begin, edges_.end(), [&](auto &e) {
+					return e.to == edge.to && e.first_id == edge.first_id;
+				});
+				if (is_repeated == false)
+					edges_.push_back(edge);
+			}
+
+			// left recursion first, so the lookahead of si is complete
+			// before it's given to others. nons are still added in same order
+			std::stable_partition(edges_.begin() + begin, edges_.end(), [si](auto &e) {
+				return e.to == si;
+			});
+		}
+		edge_offsets_.push_back(edges_.size());
+	}
+}
+
+span<const int> ClosureTemplates::order (int non) {
+	if (order_offsets_[non] < 0) {
+		int begin = orders_.size();
+		orders_.push_back(non);
+		is_added_[non] = true;
+		for (int oi=begin; oi<orders_.size(); ++oi) {
+			for (auto &edge : edges(orders_[oi])) {
+				if (is_added_[edge.to] == true)
+					continue;
+				is_added_[edge.to] = true;
+				orders_.push_back(edge.to);
+			}
+		}
+
+		for (int oi=begin; oi<orders_.size(); ++oi)
+			is_added_[orders_[oi]] = false;
+		order_offsets_[non] = begin;
+		order_sizes_[non] = orders_.size() - begin;
+	}
+	return span<const int>(orders_.data() + order_offsets_[non], order_sizes_[non]);
+}
+
+const int* ClosureTemplates::findLookaheads (int non, int lookahead_id) const {
+	auto itr = lookaheads_offsets_.find(((uint64_t)non << 32) | (uint32_t)lookahead_id);
+	if (itr == lookaheads_offsets_.end())
+		return null;
+	return lookaheads_.data() + itr->second;
+}
+
+void ClosureTemplates::addLookaheads (int non, int lookahead_id, const vector<int> &lookahead_ids) {
+	lookaheads_offsets_[((uint64_t)non << 32) | (uint32_t)lookahead_id] = lookaheads_.size();
+	lookaheads_.insert(lookaheads_.end(), lookahead_ids.begin(), lookahead_ids.end());
+}
+
+
+void State::close (
+		const GrammarIndex &grammar,
+		const vector<int> &first_ids,
+		LookaheadStore &lookaheads,
+		ClosureTemplates &templates,
+		ClosureScratch &scratch,
+		long long *lookahead_union_count) {
+
+	if (scratch.lookahead_ids.size() < grammar.symbol_count()) {
+		scratch.lookahead_ids.resize(grammar.symbol_count(), -1);
+		scratch.is_queued.resize(grammar.symbol_count(), false);
+	}
+	auto &lookahead_ids = scratch.lookahead_ids;
+
+	// lookaheads given by kernel. if next isn't exist, use lookahead. else first(next)
+	auto &order = scratch.order;
+	order.clear();
+	int kernel_non_count = 0;
+	int kernel_lookahead_id = -1;
+	for (int ci=0; ci<kernel_size; ++ci) {
+		auto &c = configs[ci];
+		auto rule_size = grammar.ruleSize(c.rule_id);
+		if (c.idx_after_cursor >= rule_size)
+			continue;
+		auto non = grammar.ruleSymbol(c.rule_id, c.idx_after_cursor);
+		if (grammar.isTerminal(non) == true)
+			continue;
+
+		auto lookahead_id = (c.idx_after_cursor + 1 >= rule_size)
+				? c.lookahead_id
+				: first_ids[grammar.ruleSymbol(c.rule_id, c.idx_after_cursor + 1)];
+		if (lookahead_ids[non] < 0) {
+			lookahead_ids[non] = lookahead_id;
+			order.push_back(non);
+			++kernel_non_count;
+		}else {
+			lookahead_ids[non] = lookaheads.unite(lookahead_ids[non], lookahead_id);
+		}
+	}
+
+	// lr(0) part. one non is the template as is, and same lookahead
+	// gives same closure as before. more are walked like adding closures of closures
+	if (kernel_non_count == 1) {
+		auto non = order[0];
+		auto template_order = templates.order(non);
+		kernel_lookahead_id = lookahead_ids[non];
+		auto cached = templates.findLookaheads(non, kernel_lookahead_id);
+		if (cached != null) {
+			lookahead_ids[non] = -1;
+			for (int oi=0; oi<template_order.size(); ++oi) {
+				for (auto rule_id : grammar.rulesOf(template_order[oi]))
+					configs.push_back(Configuration(rule_id, 0, cached[oi]));
+			}
+			return;
+		}
+
+		for (auto next : template_order.subspan(1)) {
+			lookahead_ids[next] = templates.empty_id();
+			order.push_back(next);
+		}
+	}else {
+		for (int oi=0; oi<order.size(); ++oi) {
+			for (auto &edge : templates.edges(order[oi])) {
+				if (lookahead_ids[edge.to] >= 0)
+					continue;
+				lookahead_ids[edge.to] = templates.empty_id();
+				order.push_back(edge.to);
+			}
+		}
+	}
+
+	// lookaheads along edges until nothing changes.
+	// a non merged after it was walked is walked again
+	auto &queue = scratch.queue;
+	queue.assign(order.begin(), order.end());
+	for (auto non : order)
+		scratch.is_queued[non] = true;
+	for (int qi=0; qi<queue.size(); ++qi) {
+		auto non = queue[qi];
+		scratch.is_queued[non] = false;
+		for (auto &edge : templates.edges(non)) {
+			auto lookahead_id = (edge.first_id < 0)? lookahead_ids[non]: edge.first_id;
+			auto &to_id = lookahead_ids[edge.to];
+			auto united = lookaheads.unite(to_id, lookahead_id);
+			if (united == to_id)
+				continue;
+
+			if (lookahead_union_count != null && to_id != templates.empty_id())
+				++*lookahead_union_count;
+			to_id = united;
+			if (edge.to != non && scratch.is_queued[edge.to] == false) {
+				scratch.is_queued[edge.to] = true;
+				queue.push_back(edge.to);
+			}
+		}
+	}
+
+	if (kernel_non_count == 1) {
+		scratch.result.clear();
+		for (auto non : order)
+			scratch.result.push_back(lookahead_ids[non]);
+		templates.addLookaheads(order[0], kernel_lookahead_id, scratch.result);
+	}
+
+	for (auto non : order) {
+		for (auto rule_id : grammar.rulesOf(non))
+			configs.push_back(Configuration(rule_id, 0, lookahead_ids[non]));
+		lookahead_ids[non] = -1;
+	}
+}
+
+string State::toString (const GrammarIndex &grammar, const LookaheadStore &lookaheads) const {
+	auto name = [&grammar](int id) {
+		return (id == GrammarIndex::END_SYMBOL)? string("$"): grammar.symbol(id)->name;
+	};
+
+	stringstream ss;
+	for (int ci=0; ci<configs.size(); ++ci) {
+		if (ci == 0)
+			ss << "transited:" << endl;
+		else if (ci == kernel_size)
+			ss << "closures:" << endl;
+
+		auto &c = configs[ci];
+		ss << name(grammar.ruleLeft(c.rule_id)) << " -> ";
+		auto rule_size = grammar.ruleSize(c.rule_id);
+		for (int ri=0; ri<rule_size; ++ri) {
+			if (ri == c.idx_after_cursor)
+				ss << ".";
+			ss << name(grammar.ruleSymbol(c.rule_id, ri));
+			if (ri < rule_size - 1)
+				ss << " ";
+		}
+		if (c.idx_after_cursor >= rule_size)
+			ss << ".";
+
+		ss << "  , ";
+		auto lookahead = lookaheads.get(c.lookahead_id);
+		for (int li=0; li<lookahead.size(); ++li)
+			ss << ((li == 0)? "": " / ") << name(lookahead[li]);
+		ss << endl;
+	}
+
+	ss << "transition:" << endl;
+	for (auto &t : transitions)
+		ss << name(t.first) << " ==> " << t.second << endl;
+
+	return ss.str();
+}
+
+}
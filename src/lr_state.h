@@ -0,0 +1,229 @@
+#ifndef PAW_PRINT_LR_STATE
+#define PAW_PRINT_LR_STATE
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./node.h"
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::pair;
+using std::shared_ptr;
+using std::span;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+
+// grammar by ids for the generator.
+// symbol 0 is end($), the others are ordered like shared_ptr<TerminalBase>
+// so iterating ids visits symbols in the same order as a map keyed by them.
+// rule ids are the rule idxs of ParsingTable: start symbol rules first,
+// then rules of symbols in order
+class PAW_PRINT_API GrammarIndex {
+public:
+	static const int END_SYMBOL = 0;
+
+	PAW_GETTER(bool, is_valid)
+	PAW_GETTER(int, start_symbol)
+
+	GrammarIndex (
+			const vector<shared_ptr<Nonterminal>> &symbols,
+			const shared_ptr<Nonterminal> &start_symbol);
+
+	inline int symbol_count () const { return symbols_.size(); }
+	inline int rule_count () const { return rules_.size(); }
+
+	inline const shared_ptr<TerminalBase>& symbol (int id) const { return symbols_[id]; }
+	inline bool isTerminal (int id) const { return is_terminal_list_[id]; }
+
+	inline const Rule* rule (int rule_id) const { return rules_[rule_id]; }
+	inline int ruleLeft (int rule_id) const { return rule_lefts_[rule_id]; }
+
+	inline int ruleSize (int rule_id) const {
+		return rule_rhs_offsets_[rule_id + 1] - rule_rhs_offsets_[rule_id];
+	}
+
+	inline int ruleSymbol (int rule_id, int pos) const {
+		return rule_rhs_[rule_rhs_offsets_[rule_id] + pos];
+	}
+
+	inline span<const int> rulesOf (int non_id) const {
+		return span<const int>(&rules_of_[rules_of_offsets_[non_id]],
+				rules_of_offsets_[non_id + 1] - rules_of_offsets_[non_id]);
+	}
+
+	// -1 if symbol is not in the grammar
+	int findSymbol (const TerminalBase *symbol) const;
+
+private:
+	bool is_valid_;
+	int start_symbol_;
+	vector<shared_ptr<TerminalBase>> symbols_;
+	vector<bool> is_terminal_list_;
+	unordered_map<const TerminalBase*, int> symbol_ids_;
+
+	vector<const Rule*> rules_;
+	vector<int> rule_lefts_;
+	vector<int> rule_rhs_offsets_;	// rule_count + 1
+	vector<int> rule_rhs_;
+
+	vector<int> rules_of_offsets_;	// symbol_count + 1
+	vector<int> rules_of_;
+};
+
+// pooled sorted sets of terminal ids. equal sets share one id,
+// so lookaheads are compared and stored as ints
+class PAW_PRINT_API LookaheadStore {
+public:
+	LookaheadStore ();
+
+	inline int size () const { return offsets_.size() - 1; }
+
+	inline span<const int> get (int id) const {
+		return span<const int>(elems_.data() + offsets_[id], offsets_[id + 1] - offsets_[id]);
+	}
+
+	// terms are sorted and made unique in place
+	int intern (vector<int> &terms);
+	int single (int term);
+	int unite (int id, int other);
+
+private:
+	vector<int> elems_;
+	vector<int> offsets_;	// size + 1
+	unordered_map<uint64_t, int> ids_by_hash_;
+	vector<int> next_same_hash_;	// chain of ids with same hash
+	unordered_map<uint64_t, int> unite_cache_;
+	vector<int> scratch_;
+
+	int _find (uint64_t hash, span<const int> terms) const;
+};
+
+// lr(1) item. 12 bytes instead of a heap node with a std::set
+class Configuration {
+public:
+	int rule_id;
+	unsigned short idx_after_cursor;
+	int lookahead_id;
+
+	Configuration ()
+	:rule_id(-1),
+	 idx_after_cursor(0),
+	 lookahead_id(-1) {
+	}
+
+	Configuration (int rule_id, int idx_after_cursor, int lookahead_id)
+	:rule_id(rule_id),
+	 idx_after_cursor(idx_after_cursor),
+	 lookahead_id(lookahead_id) {
+	}
+
+	inline bool operator== (const Configuration &other) const {
+		return rule_id == other.rule_id
+				&& idx_after_cursor == other.idx_after_cursor
+				&& lookahead_id == other.lookahead_id;
+	}
+
+	inline bool isCoreEqual (const Configuration &other) const {
+		return rule_id == other.rule_id && idx_after_cursor == other.idx_after_cursor;
+	}
+};
+
+// B -> .C x of a nonterminal B. C gets first(x) as lookahead,
+// or lookahead of B if x doesn't exist (first_id is -1)
+class ClosureEdge {
+public:
+	int to;
+	int first_id;
+};
+
+// closure structure of every nonterminal, made once and used by every state.
+// edges are made for all nonterminals at first, and the lr(0) closure
+// (nons whose rules are added, in walking order) when first asked.
+// only lookaheads given by the kernel differ between states
+class PAW_PRINT_API ClosureTemplates {
+public:
+	PAW_GETTER(int, empty_id)
+
+	ClosureTemplates (
+			const GrammarIndex &grammar,
+			const vector<int> &first_ids,
+			LookaheadStore &lookaheads);
+
+	inline span<const ClosureEdge> edges (int non) const {
+		return span<const ClosureEdge>(edges_.data() + edge_offsets_[non],
+				edge_offsets_[non + 1] - edge_offsets_[non]);
+	}
+
+	// non itself first
+	span<const int> order (int non);
+
+	// lookaheads of order(non) when closing non with lookahead_id.
+	// null if not added yet
+	const int* findLookaheads (int non, int lookahead_id) const;
+	void addLookaheads (int non, int lookahead_id, const vector<int> &lookahead_ids);
+
+private:
+	int empty_id_;
+
+	vector<int> edge_offsets_;	// symbol_count + 1
+	vector<ClosureEdge> edges_;
+
+	vector<int> order_offsets_;	// non -> first idx in orders_, -1 if not made
+	vector<int> order_sizes_;
+	vector<int> orders_;
+	vector<char> is_added_;
+
+	unordered_map<uint64_t, int> lookaheads_offsets_;	// (non, lookahead_id) -> first idx
+	vector<int> lookaheads_;
+};
+
+// scratch of State::close. reused so closures don't allocate per state
+class ClosureScratch {
+public:
+	vector<int> lookahead_ids;	// non id -> lookahead of its rules, -1 if not added
+	vector<int> order;			// added nons in order
+	vector<int> queue;
+	vector<char> is_queued;
+	vector<int> result;
+};
+
+class PAW_PRINT_API State {
+public:
+	vector<Configuration> configs;	// kernel (transited) first, then closures
+	int kernel_size;
+	vector<pair<int, int>> transitions;	// symbol id -> state idx, ascending symbol id
+
+	State ()
+	:kernel_size(0) {
+	}
+
+	inline span<const Configuration> kernel () const {
+		return span<const Configuration>(configs.data(), kernel_size);
+	}
+
+	// adds closures of kernel. lookahead_union_count counts lookahead merges if not null
+	void close (
+			const GrammarIndex &grammar,
+			const vector<int> &first_ids,
+			LookaheadStore &lookaheads,
+			ClosureTemplates &templates,
+			ClosureScratch &scratch,
+			long long *lookahead_union_count=null);
+
+	string toString (const GrammarIndex &grammar, const LookaheadStore &lookaheads) const;
+};
+
+}
+
+#include "./undefines.h"
+#endif
@@ -62,36 +62,120 @@ Node::Node (const shared_ptr<TerminalBase> &termnon, const Token *token)
 
 }
 
+void Node::reset (const shared_ptr<TerminalBase> &termnon, const Token *token) {
+    parent_ = null;
+    termnon_ = termnon;
+    token_ = token;
+    reduced_rule_idx_ = -1;
+    children_.clear();
+    alternatives_.clear();
+}
+
 void Node::addChild (const shared_ptr<Node> &child) {
     children_.push_back(child);
     child->parent_ = this;
 }
 
-string Node::toString (const char *text, int indent, bool with_children, int indent_inc) {
-    if (indent_inc < 2)
-        indent_inc = 2;
+void Node::addAlternative (const shared_ptr<Node> &alternative) {
+    alternatives_.push_back(alternative);
+}
 
-    stringstream ss;
+// tokens go through one scratch string, reused for every leaf
+class StreamSink {
+public:
+    std::ostream &os;
+    string scratch;
+
+    inline void put (char c) { os.put(c); }
+    inline void write (const string &str) { os << str; }
+    inline void write (const char *str) { os << str; }
+    inline void writeToken (const Token &token, const char *text) {
+        scratch.clear();
+        token.appendTo(scratch, text);
+        os << scratch;
+    }
+};
+
+class BufferSink {
+public:
+    string &buffer;
+
+    inline void put (char c) { buffer.push_back(c); }
+    inline void write (const string &str) { buffer.append(str); }
+    inline void write (const char *str) { buffer.append(str); }
+    inline void writeToken (const Token &token, const char *text) { token.appendTo(buffer, text); }
+};
 
+template <class Sink>
+static void _printNode (Sink &sink, const Node &node, const char *text, int indent, int indent_inc) {
     // print indent
-    if (indent > 0) {
-        for (int i=0; i<indent; ++i)
-            ss << (((i%indent_inc) == 0)? "|": "-");
-    }
+    for (int i=0; i<indent; ++i)
+        sink.put(((i%indent_inc) == 0)? '|': '-');
 
     // print self
-    if (termnon_->isTerminal() == true)
-        ss << "Terminal(\"" << termnon_->name << "\", " << token_->toString(text) << ")";
-    else
-        ss << "Nonterminal(\"" << termnon_->name << "\")";
-
-    // print children
-    if (with_children == true) {
-        for (auto &c : children_)
-            ss << endl << c->toString(text, indent + indent_inc, indent_inc);
+    if (node.termnon()->isTerminal() == true) {
+        sink.write("Terminal(\"");
+        sink.write(node.termnon()->name);
+        sink.write("\", ");
+        sink.writeToken(*node.token(), text);
+        sink.put(')');
+    }else {
+        sink.write("Nonterminal(\"");
+        sink.write(node.termnon()->name);
+        sink.write("\")");
     }
+}
 
-    return ss.str();
+template <class Sink>
+static void _printTree (
+        Sink &sink,
+        const Node &root,
+        const char *text,
+        int indent,
+        bool with_children,
+        int indent_inc) {
+    // see Node::print
+    if (indent_inc < 2)
+        indent_inc = 2;
+
+    if (with_children == false) {
+        _printNode(sink, root, text, indent, indent_inc);
+        return;
+    }
+
+    NodeWalker walker;
+    walker.walk(root, [&](const Node &node, int depth) {
+        if (&node != &root)
+            sink.put('\n');
+        _printNode(sink, node, text, indent + depth * indent_inc, indent_inc);
+        return true;
+    });
+}
+
+string Node::toString (const char *text, int indent, bool with_children, int indent_inc) {
+    string result;
+    appendTo(result, text, indent, with_children, indent_inc);
+    return result;
+}
+
+void Node::print (
+        std::ostream &os,
+        const char *text,
+        int indent,
+        bool with_children,
+        int indent_inc) const {
+    StreamSink sink{ os };
+    _printTree(sink, *this, text, indent, with_children, indent_inc);
+}
+
+void Node::appendTo (
+        string &buffer,
+        const char *text,
+        int indent,
+        bool with_children,
+        int indent_inc) const {
+    BufferSink sink{ buffer };
+    _printTree(sink, *this, text, indent, with_children, indent_inc);
 }
 
 }
@@ -2,6 +2,7 @@
 #define PAW_PRINT_NODE
 
 #include <memory>
+#include <ostream>
 #include <unordered_map>
 #include <vector>
 
@@ -76,22 +77,98 @@ class PAW_PRINT_API Node {
 public:
     PAW_GETTER(Node*, parent)
     PAW_GETTER(const shared_ptr<TerminalBase>&, termnon)
-    PAW_GETTER(const Token*, token)
+    PAW_GETTER_SETTER(const Token*, token)
     PAW_GETTER_SETTER(int, reduced_rule_idx)
     PAW_GETTER(const vector<shared_ptr<Node>>&, children)
+    PAW_GETTER(const vector<shared_ptr<Node>>&, alternatives)
 
     Node (const shared_ptr<TerminalBase>& termnon, const Token *token);
 
+    // same as a new node, children keep their capacity
+    void reset (const shared_ptr<TerminalBase>& termnon, const Token *token);
+
     void addChild (const shared_ptr<Node> &child);
+    inline void reserveChildren (int count) { children_.reserve(count); }
+
+    // other derivations of same symbol over same tokens, made by glr parsing.
+    // children can be shared between alternatives, so parent is the last one
+    void addAlternative (const shared_ptr<Node> &alternative);
+    inline bool isAmbiguous () const { return alternatives_.empty() == false; }
 
     string toString (const char *text, int indent=0, bool with_children=false, int indent_inc=2);
 
+    // same as toString, written in one pass without strings per node.
+    // tokens are written by Token::append_func if set, else by to_string_func.
+    // indent_inc below 2 is taken as 2, so each level keeps its '|' mark
+    void print (
+            std::ostream &os,
+            const char *text,
+            int indent=0,
+            bool with_children=false,
+            int indent_inc=2) const;
+
+    void appendTo (
+            string &buffer,
+            const char *text,
+            int indent=0,
+            bool with_children=false,
+            int indent_inc=2) const;
+
 private:
     Node *parent_;
     shared_ptr<TerminalBase> termnon_;
     const Token *token_;
     int reduced_rule_idx_;
     vector<shared_ptr<Node>> children_;
+    vector<shared_ptr<Node>> alternatives_;
+};
+
+// iterative depth-first walk, so deep trees don't overflow the call stack.
+// pre(node, depth) is called before children and returns false to skip them,
+// post(node, depth) is called after them. the stack is kept between walks
+class NodeWalker {
+public:
+    template <class Pre, class Post>
+    void walk (const Node &root, Pre &&pre, Post &&post) {
+        stack_.clear();
+        if (pre(root, 0) == false) {
+            post(root, 0);
+            return;
+        }
+        stack_.push_back(Frame{ &root, 0 });
+
+        while (stack_.empty() == false) {
+            auto &frame = stack_.back();
+            auto &children = frame.node->children();
+            if (frame.child_idx >= children.size()) {
+                auto node = frame.node;
+                stack_.pop_back();
+                post(*node, stack_.size());
+                continue;
+            }
+
+            auto &child = *children[frame.child_idx++];
+            int depth = stack_.size();
+            if (pre(child, depth) == true)
+                stack_.push_back(Frame{ &child, 0 });
+            else
+                post(child, depth);
+        }
+    }
+
+    template <class Pre>
+    void walk (const Node &root, Pre &&pre) {
+        walk(root, pre, [](const Node&, int) {});
+    }
+
+private:
+    class Frame {
+    public:
+        const Node *node;
+        int child_idx;
+    };
+
+    vector<Frame> stack_;
 };
 
 }
@@ -0,0 +1,54 @@
+#include "parse_context.h"
+
+#include "./defines.h"
+
+
+namespace parse_table {
+
+ParseContext::ParseContext ()
+:node_count_(0),
+ prints_errors_(true),
+ use_arena_(true) {
+}
+
+void ParseContext::reset () {
+    node_stack_.clear();
+    node_count_ = 0;
+    error_.clear();
+}
+
+void ParseContext::reserve (int stack_size, int node_count) {
+    node_stack_.reserve(stack_size);
+    while (node_chunks_.size() * NODE_CHUNK_SIZE < node_count) {
+        node_chunks_.emplace_back();
+        node_chunks_.back().reserve(NODE_CHUNK_SIZE);
+    }
+}
+
+shared_ptr<Node> ParseContext::makeNode (const shared_ptr<TerminalBase> &termnon, const Token *token) {
+    if (use_arena_ == false)
+        return make_shared<Node>(termnon, token);
+
+    int chunk_idx = node_count_ / NODE_CHUNK_SIZE;
+    if (chunk_idx == node_chunks_.size()) {
+        node_chunks_.emplace_back();
+        node_chunks_.back().reserve(NODE_CHUNK_SIZE);
+    }
+
+    auto &chunk = node_chunks_[chunk_idx];
+    int idx = node_count_ % NODE_CHUNK_SIZE;
+    Node *node;
+    if (idx < chunk.size()) {
+        node = &chunk[idx];
+        node->reset(termnon, token);
+    }else {
+        chunk.emplace_back(termnon, token);
+        node = &chunk.back();
+    }
+    ++node_count_;
+
+    // aliasing an empty owner, no control block and no ref counting
+    return shared_ptr<Node>(shared_ptr<Node>(), node);
+}
+
+}
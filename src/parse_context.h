@@ -0,0 +1,72 @@
+#ifndef PAW_PRINT_PARSE_CONTEXT
+#define PAW_PRINT_PARSE_CONTEXT
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./node.h"
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+
+class NodeStackInfo {
+public:
+    shared_ptr<Node> node;
+    int state_idx;
+
+    NodeStackInfo ()
+    :node(null),
+     state_idx(-1) {
+    }
+
+    NodeStackInfo (const shared_ptr<Node> &node, int state_idx)
+    :node(node),
+     state_idx(state_idx) {
+    }
+};
+
+// stack, nodes and error of ParsingTable::generateParseTree, kept between
+// parses so a warm context parses without heap allocations.
+// nodes live in the context and are reused, so a tree made with it is valid
+// until the next parse with it, reset() or its destruction
+class PAW_PRINT_API ParseContext {
+public:
+    PAW_GETTER(const vector<NodeStackInfo>&, node_stack)
+    PAW_GETTER(int, node_count)
+    PAW_GETTER(const string&, error)   // last error, empty if the parse succeeded
+    PAW_GETTER_SETTER(bool, prints_errors)
+
+    ParseContext ();
+
+    // forgets the last tree, keeps capacity
+    void reset ();
+    void reserve (int stack_size, int node_count);
+
+    // node from the arena, pointed to without ownership
+    shared_ptr<Node> makeNode (const shared_ptr<TerminalBase> &termnon, const Token *token);
+
+private:
+    static constexpr int NODE_CHUNK_SIZE = 1024;
+
+    friend class ParsingTable;
+
+    vector<NodeStackInfo> node_stack_;
+    vector<vector<Node>> node_chunks_;   // reserved once, so nodes never move
+    int node_count_;
+    string error_;
+    bool prints_errors_;
+    bool use_arena_;    // false for parses without a context, whose trees are owned
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
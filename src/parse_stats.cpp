@@ -0,0 +1,122 @@
+#include "parse_stats.h"
+
+#include <algorithm>
+#include <sstream>
+
+
+namespace parse_table {
+
+using std::endl;
+using std::stringstream;
+
+
+ParseStats::ParseStats ()
+:shift_count_(0),
+ reduce_count_(0),
+ goto_count_(0),
+ max_stack_depth_(0),
+ last_state_idx_(-1) {
+}
+
+void ParseStats::clear () {
+    shift_count_ = 0;
+    reduce_count_ = 0;
+    goto_count_ = 0;
+    max_stack_depth_ = 0;
+    visit_counts_.clear();
+    reduce_counts_.clear();
+    transition_counts_.clear();
+    last_state_idx_ = -1;
+}
+
+static vector<int> _orderByCount (const vector<long long> &counts) {
+    vector<int> idxs;
+    for (int i=0; i<counts.size(); ++i) {
+        if (counts[i] > 0)
+            idxs.push_back(i);
+    }
+    std::stable_sort(idxs.begin(), idxs.end(), [&counts](int l, int r) {
+        return counts[l] > counts[r];
+    });
+    return idxs;
+}
+
+vector<int> ParseStats::hotStates () const {
+    return _orderByCount(visit_counts_);
+}
+
+vector<int> ParseStats::layoutOrder (int state_count) const {
+    vector<int> order;
+    if (state_count <= 0)
+        return order;
+
+    vector<bool> is_placed(state_count, false);
+    auto place = [&](int si) {
+        order.push_back(si);
+        is_placed[si] = true;
+    };
+
+    auto hot_states = hotStates();
+    int hot_idx = 0;
+
+    place(0);
+    while (order.size() < state_count) {
+        // most frequent unplaced successor
+        int next = -1;
+        long long next_count = 0;
+        auto last = order.back();
+        if (last < transition_counts_.size()) {
+            for (auto &itr : transition_counts_[last]) {
+                if (itr.first < state_count && is_placed[itr.first] == false
+                        && itr.second > next_count) {
+                    next = itr.first;
+                    next_count = itr.second;
+                }
+            }
+        }
+
+        // else hottest unplaced
+        while (next < 0 && hot_idx < hot_states.size()) {
+            auto si = hot_states[hot_idx++];
+            if (si < state_count && is_placed[si] == false)
+                next = si;
+        }
+
+        // else unvisited ones in order
+        if (next < 0) {
+            for (int si=0; si<state_count; ++si) {
+                if (is_placed[si] == false)
+                    place(si);
+            }
+            break;
+        }
+
+        place(next);
+    }
+
+    return order;
+}
+
+string ParseStats::toString (int top_n) const {
+    stringstream ss;
+    ss << "shift: " << shift_count_
+            << ", reduce: " << reduce_count_
+            << ", goto: " << goto_count_
+            << ", max stack depth: " << max_stack_depth_ << endl;
+
+    auto states = hotStates();
+    ss << "hot states:";
+    for (int i=0; i<states.size() && i<top_n; ++i)
+        ss << " " << states[i] << "(" << visit_counts_[states[i]] << ")";
+    ss << endl;
+
+    auto rules = _orderByCount(reduce_counts_);
+    ss << "hot rules:";
+    for (int i=0; i<rules.size() && i<top_n; ++i)
+        ss << " " << rules[i] << "(" << reduce_counts_[rules[i]] << ")";
+    ss << endl;
+
+    return ss.str();
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef PAW_PRINT_PARSE_STATS
+#define PAW_PRINT_PARSE_STATS
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::map;
+using std::string;
+using std::vector;
+
+
+// instrumentation policies for ParsingTable::generateParseTree.
+// every hook of NoParseStats is empty, so a parse without stats compiles
+// to the same code as before.
+class NoParseStats {
+public:
+    inline void begin () {}
+    inline void visit (int state_idx) {}
+    inline void shift (int state_idx) {}
+    inline void reduce (int rule_idx) {}
+    inline void goTo (int state_idx) {}
+    inline void stackDepth (int depth) {}
+};
+
+// counts of one or more parses. vectors grow to the largest idx seen
+class PAW_PRINT_API ParseStats {
+public:
+    PAW_GETTER(long long, shift_count)
+    PAW_GETTER(long long, reduce_count)
+    PAW_GETTER(long long, goto_count)
+    PAW_GETTER(int, max_stack_depth)
+    PAW_GETTER(const vector<long long>&, visit_counts)
+    PAW_GETTER(const vector<long long>&, reduce_counts)
+    inline const vector<map<int, long long>>& transition_counts () const { return transition_counts_; }
+
+    ParseStats ();
+
+    // called at the start of each parse, so transitions don't join parses
+    inline void begin () { last_state_idx_ = -1; }
+
+    inline void visit (int state_idx) {
+        _inc(visit_counts_, state_idx);
+        if (last_state_idx_ >= 0) {
+            if (last_state_idx_ >= transition_counts_.size())
+                transition_counts_.resize(last_state_idx_ + 1);
+            ++transition_counts_[last_state_idx_][state_idx];
+        }
+        last_state_idx_ = state_idx;
+    }
+
+    inline void shift (int state_idx) { ++shift_count_; }
+    inline void reduce (int rule_idx) { ++reduce_count_; _inc(reduce_counts_, rule_idx); }
+    inline void goTo (int state_idx) { ++goto_count_; }
+
+    inline void stackDepth (int depth) {
+        if (depth > max_stack_depth_)
+            max_stack_depth_ = depth;
+    }
+
+    void clear ();
+
+    // state idxs ordered by visit count, most visited first
+    vector<int> hotStates () const;
+
+    // new order of states for ParsingTable::renumberStates. state 0 stays first,
+    // then each next state is the most frequent unplaced successor of the last
+    // placed one, so states visited one after another get neighbouring numbers.
+    // unvisited states keep their order at the end. empty for no states
+    vector<int> layoutOrder (int state_count) const;
+
+    // totals and top_n states and rules
+    string toString (int top_n=10) const;
+
+private:
+    long long shift_count_;
+    long long reduce_count_;
+    long long goto_count_;
+    int max_stack_depth_;
+    vector<long long> visit_counts_;    // state idx -> count
+    vector<long long> reduce_counts_;   // rule idx -> count
+    vector<map<int, long long>> transition_counts_;  // from state idx -> to state idx -> count
+    int last_state_idx_;
+
+    static inline void _inc (vector<long long> &counts, int idx) {
+        if (idx >= counts.size())
+            counts.resize(idx + 1, 0);
+        ++counts[idx];
+    }
+};
+
+}
+
+#include "./undefines.h"
+#endif
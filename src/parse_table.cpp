@@ -1,9 +1,13 @@
 #include "parse_table.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 #include "../external/paw_print/paw_print.h"
 
@@ -14,6 +18,7 @@ namespace parse_table {
 using std::cout;
 using std::dynamic_pointer_cast;
 using std::endl;
+using std::function;
 using std::make_shared;
 using std::setfill;
 using std::setw;
@@ -24,149 +29,6 @@ using std::to_string;
 using namespace paw_print;
 
 
-Configuration::Configuration (
-    const shared_ptr<Nonterminal> &left_side,
-    const Rule &rule,
-    int idx_after_cursor,
-    const set<shared_ptr<TerminalBase>> &lookahead)
-:left_side_(left_side),
- rule_(rule),
- idx_after_cursor_(idx_after_cursor),
- lookahead_(lookahead) {
-
-}
-
-string Configuration::toString () {
-    stringstream ss;
-  ss << left_side_->name << " -> ";
-  for (int ri = 0; ri < rule_.right_side.size(); ++ri) {
-    auto &termnon = rule_.right_side[ri];
-    if (ri == idx_after_cursor_)
-      ss << ".";
-    ss << termnon->name;
-    if (ri < rule_.right_side.size() - 1)
-      ss << " ";
-  }
-
-  if (idx_after_cursor_ >= rule_.right_side.size())
-    ss << ".";
-
-  ss << "  , ";
-  int li = 0;
-  for (auto &termnon : lookahead_) {
-    if (li != 0)
-      ss << " / ";
-    if (termnon == null)
-      ss << "$";
-    else
-      ss << termnon->name;
-    ++li;
-  }
-
-  ss << endl;
-
-    return ss.str();
-}
-
-State::State (
-    const vector<shared_ptr<Configuration>> &transited_configs,
-    const vector<shared_ptr<Configuration>> &closures)
-:transited_configs_(transited_configs),
- closures_(closures) {
-
-}
-
-static void _addClosures (
-    const FirstMap &first_map,
-    const shared_ptr<Configuration> &c,
-    set<shared_ptr<Nonterminal>> &non_set,
-    vector<shared_ptr<Configuration>> &closures) {
-  auto &rule = c->rule();
-  auto idx_after_cursor = c->idx_after_cursor();
-  if (idx_after_cursor >= rule.right_side.size())
-    return;
-
-  // find non after cursor
-  auto &termnon = rule.right_side[idx_after_cursor];
-  if (termnon->isTerminal() == true)
-    return;
-  auto non = dynamic_pointer_cast<Nonterminal>(termnon);
-  
-
-  // make lookahead
-  set<shared_ptr<TerminalBase>> lookahead;
-  if (idx_after_cursor + 1 >= rule.right_side.size()) {
-    // if next isn't exist, use lookahead
-    lookahead = c->lookahead();
-  }else {
-    // use first(next)
-    auto &next = rule.right_side[idx_after_cursor + 1];
-    if (next->isTerminal() == true)
-      lookahead.insert(next);
-    else
-      lookahead = first_map.at(next);
-  }
-
-
-  // add closures
-  if (non_set.find(non) == non_set.end()) {
-    // add configs to closures
-    non_set.insert(non);
-    for (auto &rule : non->rules) {
-      closures.push_back(make_shared<Configuration>(non, rule, 0, lookahead));
-    }
-  }else {
-    // merge lookahead
-    for (auto &c : closures) {
-      if (c->left_side() != non)
-        continue;
-
-      c->lookahead().insert(lookahead.begin(), lookahead.end());
-    }
-  }
-}
-
-shared_ptr<State> State::makeState(
-    const vector<shared_ptr<Nonterminal>> &all_symbols,
-    const FirstMap &first_map,
-    const vector<shared_ptr<Configuration>> &transited_configs) {
-
-  // make nonterminal set to prevent Configuration duplicated
-  set<shared_ptr<Nonterminal>> non_set;
-
-  // make closures
-  vector<shared_ptr<Configuration>> closures;
-  for (auto &c : transited_configs)
-    _addClosures(first_map, c, non_set, closures);
-
-  // add closures from closures
-  for (int ci = 0; ci < closures.size(); ++ci) {
-    auto &c = closures[ci];
-
-    _addClosures(first_map, c, non_set, closures);
-  }
-
-  return make_shared<State>(transited_configs, closures);
-}
-
-void State::print () {
-  cout << "## state " << name_ << endl;
-  cout << "transited:" << endl;
-  for (auto &c : transited_configs_)
-    cout << c->toString();
-
-  cout << "closures:" << endl;
-  for (auto &c : closures_)
-    cout << c->toString();
-
-  cout << "transition:" << endl;
-  for (auto &itr : transition_map_) {
-        auto name = (itr.first == null)? "$" : itr.first->name;
-    cout << name << " ==> " << itr.second->name() << endl;
-  }
-}
-
-
 ParsingTable::ActionInfo::ActionInfo ()
 :action(ActionInfo::NONE),
  idx(-1) {
@@ -178,74 +40,25 @@ ParsingTable::ActionInfo::ActionInfo (Action action, int idx)
 
 }
 
-static void _makeReduceTable (
-    const map<const Rule*, int> &rule_idx_map,
-    const shared_ptr<Nonterminal> &start_symbol,
-    const vector<shared_ptr<Configuration>> &configs,
-    map<shared_ptr<TerminalBase>, ParsingTable::ActionInfo> &action_info_map) {
-
-  for (auto &c : configs) {
-    auto &rule = c->rule();
-    if (c->idx_after_cursor() < rule.right_side.size())
-      continue;
-
-    int rule_idx = rule_idx_map.at(&rule);
-    for (auto &termnon : c->lookahead()) {
-      if (c->left_side() == start_symbol && termnon == null) {
-        action_info_map[termnon] = ParsingTable::ActionInfo(
-            ParsingTable::ActionInfo::ACCEPT, rule_idx);
-      }else {
-        action_info_map[termnon] = ParsingTable::ActionInfo(
-            ParsingTable::ActionInfo::REDUCE, rule_idx);
-      }
-    }
-  }
-}
-
-static void _makeTransitionTable(
-    const map<shared_ptr<TerminalBase>, shared_ptr<State>> &transition_map,
-    const map<shared_ptr<State>, int> &state_idx_map,
-    map<shared_ptr<TerminalBase>, ParsingTable::ActionInfo> &action_info_map) {
-
-  for (auto &itr : transition_map) {
-    auto &termnon = itr.first;
-    auto &state   = itr.second;
-
-    if (termnon->isTerminal() == true) {
-      action_info_map[termnon] =
-        ParsingTable::ActionInfo(
-          ParsingTable::ActionInfo::SHIFT, state_idx_map.at(state));
-    }else {
-      action_info_map[termnon] =
-        ParsingTable::ActionInfo(
-          ParsingTable::ActionInfo::GOTO, state_idx_map.at(state));
-    }
-  }
-}
-
 ParsingTable::ParsingTable(
     const vector<shared_ptr<Nonterminal>> &symbols,
     const shared_ptr<Nonterminal> &start_symbol,
-    const vector<shared_ptr<State>> &states) {
+    vector<map<shared_ptr<TerminalBase>, ActionInfo>> &&action_info_map_list,
+    vector<map<shared_ptr<TerminalBase>, vector<ActionInfo>>> &&conflict_action_map_list,
+    vector<int> &&entry_states) {
 
     symbols_ = symbols;
     start_symbol_ = start_symbol;
-
-  map<shared_ptr<State>, int> state_idx_map;
-  for (int si = 0; si < states.size(); ++si)
-    state_idx_map[states[si]] = si;
+    entry_states_ = std::move(entry_states);
+    if (entry_states_.empty() == true)
+        entry_states_.push_back(0);
 
   // rules
-  map<const Rule*, int> rule_idx_map;
-  for (auto &r : start_symbol->rules) {
-    rule_idx_map[&r] = rules_.size();
+  for (auto &r : start_symbol->rules)
     rules_.push_back(&r);
-  }
   for (auto &non : symbols) {
-    for (auto &r : non->rules) {
-      rule_idx_map[&r] = rules_.size();
+    for (auto &r : non->rules)
       rules_.push_back(&r);
-    }
   }
 
     // terminals
@@ -259,19 +72,8 @@ ParsingTable::ParsingTable(
   }
     terminal_map_[0] = null;
 
-  // make table
-  action_info_map_list_.resize(states.size());
-  for (int si = 0; si < states.size(); ++si) {
-    auto &s = states[si];
-    auto &action_info_map = action_info_map_list_[si];
-
-    // make about reduce
-    _makeReduceTable(rule_idx_map, start_symbol, s->transited_configs(), action_info_map);
-    _makeReduceTable(rule_idx_map, start_symbol, s->closures()         , action_info_map);
-
-    // transition
-    _makeTransitionTable(s->transition_map(), state_idx_map, action_info_map);
-  }
+  action_info_map_list_ = std::move(action_info_map_list);
+  conflict_action_map_list_ = std::move(conflict_action_map_list);
 }
 
 static string _actionInfoToString (ParsingTable::ActionInfo info) {
@@ -387,22 +189,6 @@ string ParsingTable::toString () const {
     return ss.str();
 }
 
-class NodeStackInfo {
-public:
-    shared_ptr<Node> node;
-    int state_idx;
-
-    NodeStackInfo ()
-    :node(null),
-     state_idx(-1) {
-    }
-
-    NodeStackInfo (const shared_ptr<Node> &node, int state_idx)
-    :node(node),
-     state_idx(state_idx) {
-    }
-};
-
 static string _makeErrStringForReduce (
         const Token *t,
         const Rule *rule,
@@ -418,12 +204,15 @@ static string _makeErrStringForReduce (
     return ss.str();
 }
 
+template <class Stats>
 static bool _reduceStack (
         const vector<map<shared_ptr<TerminalBase>, ParsingTable::ActionInfo>> &action_info_map_list,
         const Token *t,
         const vector<const Rule *> &rules,
         int rule_idx,
-        vector<NodeStackInfo> &node_stack) {
+        vector<NodeStackInfo> &node_stack,
+        ParseContext &context,
+        Stats &stats) {
 
     auto rule = rules[rule_idx];
 
@@ -437,7 +226,7 @@ static bool _reduceStack (
 
 
     // make reduced node
-    auto reduced_node = make_shared<Node>(rule->left_side, t);
+    auto reduced_node = context.makeNode(rule->left_side, t);
     reduced_node->reduced_rule_idx(rule_idx);
 
     for (int ri=0; ri<rule->right_side.size(); ++ri) {
@@ -475,11 +264,35 @@ static bool _reduceStack (
         return null;
     }
     node_stack.push_back(NodeStackInfo(reduced_node, action_info.idx));
+    stats.goTo(action_info.idx);
 
 
     return true;
 }
 
+// positions are found only for errors, so tokens don't need them.
+// only text before idx is scanned, errors of a long text stay cheap
+static string _makePositionString (const char *text, int idx) {
+    if (text == null || idx < 0 || memchr(text, '\0', idx + 1) != null)
+        return "";
+
+    unsigned int line = 0;
+    int line_start = 0;
+    auto end = text + idx;
+    for (auto p = text; p < end; ) {
+        auto newline = (const char*)memchr(p, '\n', end - p);
+        if (newline == null)
+            break;
+        ++line;
+        line_start = newline + 1 - text;
+        p = newline + 1;
+    }
+
+    stringstream ss;
+    ss << " line:" << line << " column:" << idx - line_start;
+    return ss.str();
+}
+
 static void _printNodeStack (const vector<NodeStackInfo> &node_stack, const char *text) {
     for (auto &nsi : node_stack) {
         if (nsi.node != null)
@@ -493,56 +306,400 @@ shared_ptr<Node> ParsingTable::generateParseTree (
         const char *text,
         const vector<Token> &tokens,
         bool need_print) {
-    vector<NodeStackInfo> node_stack;
-    node_stack.push_back(NodeStackInfo(null, 0));
+    NoParseStats stats;
+    return generateParseTree(text, tokens, stats, need_print);
+}
 
-    for (int ti=0; ti<tokens.size(); ) {
-        auto &t = tokens[ti];
+// vector<Token> as a token source of _generateParseTree, like TokenBuffer
+class TokenVectorSource {
+public:
+    const vector<Token> &tokens;
+
+    inline bool has (int idx) const { return idx < tokens.size(); }
+    inline int type (int idx) const { return tokens[idx].type; }
+    inline const Token* token (int idx) const { return &tokens[idx]; }
+};
+
+class TokenBufferSource {
+public:
+    const TokenBuffer &tokens;
+
+    inline bool has (int idx) const { return idx < tokens.size(); }
+    inline int type (int idx) const { return tokens.type(idx); }
+    inline const Token* token (int idx) const { return tokens.token(idx); }
+};
+
+// has() waits for the lexer
+class TokenStreamSource {
+public:
+    TokenStream &tokens;
+
+    inline bool has (int idx) const { return tokens.has(idx); }
+    inline int type (int idx) const { return tokens.type(idx); }
+    inline const Token* token (int idx) const { return tokens.token(idx); }
+};
+
+template <class Stats>
+shared_ptr<Node> ParsingTable::generateParseTree (
+        const char *text,
+        const vector<Token> &tokens,
+        Stats &stats,
+        bool need_print) {
+    ParseContext context;
+    context.use_arena_ = false;
+    return _generateParseTree(text, TokenVectorSource{ tokens }, context, stats, need_print);
+}
+
+shared_ptr<Node> ParsingTable::generateParseTree (
+        const char *text,
+        const vector<Token> &tokens,
+        ParseContext &context,
+        bool need_print) {
+    NoParseStats stats;
+    return _generateParseTree(text, TokenVectorSource{ tokens }, context, stats, need_print);
+}
+
+shared_ptr<Node> ParsingTable::generateParseTree (
+        const char *text,
+        const TokenBuffer &tokens,
+        bool need_print) {
+    NoParseStats stats;
+    return generateParseTree(text, tokens, stats, need_print);
+}
+
+template <class Stats>
+shared_ptr<Node> ParsingTable::generateParseTree (
+        const char *text,
+        const TokenBuffer &tokens,
+        Stats &stats,
+        bool need_print) {
+    ParseContext context;
+    context.use_arena_ = false;
+    return _generateParseTree(text, TokenBufferSource{ tokens }, context, stats, need_print);
+}
+
+shared_ptr<Node> ParsingTable::generateParseTree (
+        const char *text,
+        const TokenBuffer &tokens,
+        ParseContext &context,
+        bool need_print) {
+    NoParseStats stats;
+    return _generateParseTree(text, TokenBufferSource{ tokens }, context, stats, need_print);
+}
+
+int ParsingTable::entryState (const string &name) const {
+    for (int ri=0; ri<entry_states_.size(); ++ri) {
+        if (rules_[ri]->right_side.empty() == false && rules_[ri]->right_side[0]->name == name)
+            return entry_states_[ri];
+    }
+    return -1;
+}
+
+shared_ptr<Node> ParsingTable::generateEntryParseTree (
+        const string &entry,
+        const char *text,
+        const vector<Token> &tokens,
+        bool need_print) {
+    ParseContext context;
+    context.use_arena_ = false;
+    return generateEntryParseTree(entry, text, tokens, context, need_print);
+}
+
+shared_ptr<Node> ParsingTable::generateEntryParseTree (
+        const string &entry,
+        const char *text,
+        const vector<Token> &tokens,
+        ParseContext &context,
+        bool need_print) {
+    auto state = entryState(entry);
+    if (state < 0) {
+        // TODO err: {entry} is not an entry symbol
+        context.error_ = "err: \'" + entry + "\' is not an entry symbol";
+        if (context.prints_errors_ == true)
+            cout << context.error_ << endl;
+        return null;
+    }
+    NoParseStats stats;
+    return _generateParseTree(text, TokenVectorSource{ tokens }, context, stats, need_print, state);
+}
+
+shared_ptr<Node> ParsingTable::generateParseTree (
+        const char *text,
+        TokenStream &tokens,
+        bool need_print) {
+    NoParseStats stats;
+    ParseContext context;
+    context.use_arena_ = false;
+    return _generateParseTree(text, TokenStreamSource{ tokens }, context, stats, need_print);
+}
+
+shared_ptr<Node> ParsingTable::generateParseTree (
+        const char *text,
+        TokenStream &tokens,
+        ParseContext &context,
+        bool need_print) {
+    NoParseStats stats;
+    return _generateParseTree(text, TokenStreamSource{ tokens }, context, stats, need_print);
+}
+
+shared_ptr<Node> ParsingTable::generateParseTreePipelined (
+        const char *text,
+        const function<void(TokenStream&)> &lexer,
+        TokenStream &tokens,
+        ParseContext &context,
+        bool need_print) {
+    // a stream of an earlier call is closed or cancelled
+    tokens.reset();
+    std::thread lexer_thread([&lexer, &tokens]() {
+        lexer(tokens);
+        tokens.close();
+    });
+
+    auto tree = generateParseTree(text, tokens, context, need_print);
+
+    // lexer may wait on a full ring if the parse ended early
+    tokens.cancel();
+    lexer_thread.join();
+    return tree;
+}
+
+// tokens in [begin, end) then the end token, parsed as a document of its own.
+// the end token has type 0 but is tokens[end], the first token of the next
+// chunk, so nodes reduced on it get the lookahead of a sequential parse
+class TokenChunkSource {
+public:
+    const vector<Token> &tokens;
+    int begin;
+    int end;
+
+    inline bool has (int idx) const { return begin + idx <= end; }
+    inline int type (int idx) const { return (begin + idx < end)? tokens[begin + idx].type: 0; }
+    inline const Token* token (int idx) const { return &tokens[begin + idx]; }
+};
+
+vector<int> ParsingTable::findChunkBegins (
+        const vector<Token> &tokens,
+        int chunk_count,
+        const function<bool(const vector<Token>&, int)> &is_top_level) {
+    vector<int> begins;
+    for (int ci=1; ci<chunk_count; ++ci) {
+        int ti = std::max((long long)tokens.size() * ci / chunk_count, (begins.empty()? 1: begins.back() + 1LL));
+        for (; ti<(int)tokens.size() - 1; ++ti) {
+            auto is_begin = (is_top_level != null)?
+                    is_top_level(tokens, ti):
+                    tokens[ti].column == 0 && tokens[ti].type != 0;
+            if (is_begin == true)
+                break;
+        }
+        if (ti >= (int)tokens.size() - 1)
+            break;
+        begins.push_back(ti);
+    }
+    return begins;
+}
+
+// first node of the list under root, through nodes with one child
+static shared_ptr<Node> _findTopList (const shared_ptr<Node> &root, const shared_ptr<Nonterminal> &list) {
+    auto node = root;
+    while (node->termnon() != list) {
+        if (node->children().size() != 1)
+            return null;
+        node = node->children()[0];
+    }
+    return node;
+}
+
+shared_ptr<Node> ParsingTable::generateParseTreeParallel (
+        const char *text,
+        const vector<Token> &tokens,
+        const string &list_name,
+        const vector<int> &chunk_begins,
+        int thread_count,
+        bool *is_parallel) {
+    if (is_parallel != null)
+        *is_parallel = false;
+
+    auto parse_sequentially = [&]() {
+        return generateParseTree(text, tokens);
+    };
+    if (chunk_begins.empty() == true || tokens.empty() == true || tokens.back().type != 0)
+        return parse_sequentially();
+
+    // list -> item... list and list -> item...
+    int cons_rule_idx = -1;
+    int last_rule_idx = -1;
+    for (int ri=0; ri<rules_.size(); ++ri) {
+        auto rule = rules_[ri];
+        if (rule->left_side->name != list_name)
+            continue;
+        auto &right = rule->right_side;
+        if (right.empty() == false && right.back() == rule->left_side)
+            cons_rule_idx = ri;
+        else
+            last_rule_idx = ri;
+    }
+    if (cons_rule_idx < 0 || last_rule_idx < 0) {
+        // TODO err: {list_name} is not a right recursive list
+        cout << "err: '" << list_name << "' is not a right recursive list" << endl;
+        return parse_sequentially();
+    }
+    auto &cons_right = rules_[cons_rule_idx]->right_side;
+    auto &last_right = rules_[last_rule_idx]->right_side;
+    if (std::equal(last_right.begin(), last_right.end(), cons_right.begin(), cons_right.end() - 1) == false) {
+        cout << "err: '" << list_name << "' is not a right recursive list" << endl;
+        return parse_sequentially();
+    }
+    auto list = rules_[cons_rule_idx]->left_side;
+
+    // chunks on threads, taken in order by a shared counter
+    vector<int> bounds = { 0 };
+    for (auto begin : chunk_begins) {
+        if (begin <= bounds.back() || begin >= (int)tokens.size() - 1)
+            return parse_sequentially();
+        bounds.push_back(begin);
+    }
+    bounds.push_back(tokens.size() - 1);
+
+    int chunk_count = bounds.size() - 1;
+    vector<shared_ptr<Node>> trees(chunk_count);
+    std::atomic<int> next_chunk(0);
+    std::atomic<bool> has_failed(false);
+    auto work = [&]() {
+        ParseContext context;
+        context.use_arena_ = false;
+        context.prints_errors_ = false;
+        NoParseStats stats;
+        for (int ci; (ci = next_chunk++) < chunk_count && has_failed == false; ) {
+            trees[ci] = _generateParseTree(text, TokenChunkSource{ tokens, bounds[ci], bounds[ci + 1] }, context, stats, false);
+            if (trees[ci] == null)
+                has_failed = true;
+        }
+    };
+
+    if (thread_count <= 0)
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::min(thread_count, chunk_count);
+    vector<std::thread> threads;
+    for (int thi=1; thi<thread_count; ++thi)
+        threads.emplace_back(work);
+    work();
+    for (auto &thread : threads)
+        thread.join();
+
+    // every chunk must be a document ending its list with list -> item
+    vector<shared_ptr<Node>> heads(chunk_count);
+    vector<Node*> lasts(chunk_count);
+    for (int ci=0; ci<chunk_count && has_failed == false; ++ci) {
+        heads[ci] = _findTopList(trees[ci], list);
+        auto node = heads[ci].get();
+        while (node != null && node->reduced_rule_idx() == cons_rule_idx)
+            node = node->children().back().get();
+        if (node == null || node->reduced_rule_idx() != last_rule_idx)
+            has_failed = true;
+        lasts[ci] = node;
+    }
+    if (has_failed == true)
+        return parse_sequentially();
+
+    // last node of each list becomes list -> item... list with the next list.
+    // a sequential parse reduces the list nodes and the nodes above them on
+    // the end token
+    for (auto node = trees[0].get(); node != heads[0].get(); node = node->children()[0].get())
+        node->token(&tokens.back());
+    for (int ci=0; ci+1<chunk_count; ++ci) {
+        for (auto node = heads[ci].get(); node != lasts[ci]; node = node->children().back().get())
+            node->token(&tokens.back());
+        lasts[ci]->token(&tokens.back());
+        lasts[ci]->reduced_rule_idx(cons_rule_idx);
+        lasts[ci]->addChild(heads[ci + 1]);
+    }
+
+    if (is_parallel != null)
+        *is_parallel = true;
+    return trees[0];
+}
+
+// tokens has has(idx), type(idx) and token(idx). token() is only called
+// for nodes, prints and errors, so the loop reads types only
+template <class Tokens, class Stats>
+shared_ptr<Node> ParsingTable::_generateParseTree (
+        const char *text,
+        const Tokens &tokens,
+        ParseContext &context,
+        Stats &stats,
+        bool need_print,
+        int start_state) {
+    context.reset();
+    stats.begin();
+    auto &node_stack = context.node_stack_;
+    node_stack.push_back(NodeStackInfo(null, start_state));
+
+    for (int ti=0; tokens.has(ti); ) {
+        auto type = tokens.type(ti);
 
         // get terminal for token
-        if (terminal_map_.find(t.type) == terminal_map_.end()) {
-            // TODO err: token {t.type} cannot be parsed
-            cout << "err: token " << t.type << " cannot be parsed" << endl;
+        auto term_itr = terminal_map_.find(type);
+        if (term_itr == terminal_map_.end()) {
+            // TODO err: token {type} cannot be parsed
+            context.error_ = "err: token " + to_string(type) + " cannot be parsed";
+            if (context.prints_errors_ == true)
+                cout << context.error_ << endl;
             return null;
         }
-        auto &term = terminal_map_[t.type];
+        auto &term = term_itr->second;
 
 
         // check stack and action map
         auto &nsi = node_stack.back();
         auto &action_info_map = action_info_map_list_[nsi.state_idx];
+        stats.visit(nsi.state_idx);
 
-        if (action_info_map.find(term) == action_info_map.end()) {
+        auto action_itr = action_info_map.find(term);
+        if (action_itr == action_info_map.end()) {
             // TODO err: cannot be parsed on {t.first_idx~t.last_idx}
-            cout << "err: cannot be parsed \""
-                    << t.toString(text)
-                    << "\" State " << nsi.state_idx << " idx:" << t.first_idx << endl;
+            auto t = tokens.token(ti);
+            stringstream ss;
+            ss << "err: cannot be parsed \""
+                    << t->toString(text)
+                    << "\" State " << nsi.state_idx << " idx:" << t->first_idx
+                    << _makePositionString(text, t->first_idx);
+            context.error_ = ss.str();
+            if (context.prints_errors_ == true)
+                cout << context.error_ << endl;
             return null;
         }
 
-        auto &action_info = action_info_map[term];
+        auto &action_info = action_itr->second;
         switch (action_info.action) {
             case ActionInfo::Action::SHIFT:
                 if (need_print == true)
-                    cout << "shift " << action_info.idx << " with " << t.toString(text) << endl;
-                node_stack.push_back(NodeStackInfo(make_shared<Node>(term, &t), action_info.idx));
+                    cout << "shift " << action_info.idx << " with " << tokens.token(ti)->toString(text) << endl;
+                node_stack.push_back(NodeStackInfo(context.makeNode(term, tokens.token(ti)), action_info.idx));
+                stats.shift(action_info.idx);
+                stats.stackDepth(node_stack.size());
                 ++ti;
                 break;
             case ActionInfo::Action::REDUCE:
                 if (need_print == true) {
                     cout << "reduce " << action_info.idx
-                            << " with " << t.toString(text)
+                            << " with " << tokens.token(ti)->toString(text)
                             << " #Rule : " << rules_[action_info.idx]->toString() << endl;
                 }
-                _reduceStack(action_info_map_list_, &t, rules_, action_info.idx, node_stack);
+                stats.reduce(action_info.idx);
+                if (_reduceStack(action_info_map_list_, tokens.token(ti), rules_, action_info.idx, node_stack, context, stats) == false) {
+                    context.error_ = "err: cannot reduce with rule " + to_string(action_info.idx);
+                    return null;
+                }
                 break;
             case ActionInfo::Action::ACCEPT:
                 if (need_print == true)
-                    cout << "accept" << " with " << t.toString(text) << endl;
+                    cout << "accept" << " with " << tokens.token(ti)->toString(text) << endl;
                 return node_stack.back().node;
             default:
                 // TODO err: unknown action \'{action_info.action}\'
-                cout << "unknown action \'" << action_info.action << "\'" << endl;
+                context.error_ = "unknown action \'" + to_string(action_info.action) + "\'";
+                if (context.prints_errors_ == true)
+                    cout << context.error_ << endl;
                 return null;
         }
 
@@ -551,16 +708,633 @@ shared_ptr<Node> ParsingTable::generateParseTree (
     }
 
     // TODO err: cannot reduce. syntax error.
-    cout << "err: cannot reduce. syntax error." << endl;
-    _printNodeStack(node_stack, text);
+    context.error_ = "err: cannot reduce. syntax error.";
+    if (context.prints_errors_ == true) {
+        cout << context.error_ << endl;
+        _printNodeStack(node_stack, text);
+    }
 
     return null;
 }
 
+template shared_ptr<Node> ParsingTable::generateParseTree<NoParseStats> (
+        const char *text,
+        const vector<Token> &tokens,
+        NoParseStats &stats,
+        bool need_print);
+
+template shared_ptr<Node> ParsingTable::generateParseTree<ParseStats> (
+        const char *text,
+        const vector<Token> &tokens,
+        ParseStats &stats,
+        bool need_print);
+
+template shared_ptr<Node> ParsingTable::generateParseTree<NoParseStats> (
+        const char *text,
+        const TokenBuffer &tokens,
+        NoParseStats &stats,
+        bool need_print);
+
+template shared_ptr<Node> ParsingTable::generateParseTree<ParseStats> (
+        const char *text,
+        const TokenBuffer &tokens,
+        ParseStats &stats,
+        bool need_print);
+
+shared_ptr<ParsingTable> ParsingTable::renumberStates (const vector<int> &order) const {
+    if (order.size() != action_info_map_list_.size() || order.empty() || order[0] != 0) {
+        cout << "err: state order must have every state and begin with 0" << endl;
+        return null;
+    }
+
+    vector<int> new_idxs(order.size(), -1);
+    for (int si=0; si<order.size(); ++si) {
+        if (order[si] < 0 || order[si] >= order.size() || new_idxs[order[si]] >= 0) {
+            cout << "err: state order is not a permutation" << endl;
+            return null;
+        }
+        new_idxs[order[si]] = si;
+    }
+
+    auto remap = [&new_idxs](ActionInfo &info) {
+        if (info.action == ActionInfo::SHIFT || info.action == ActionInfo::GOTO)
+            info.idx = new_idxs[info.idx];
+    };
+
+    auto table = make_shared<ParsingTable>(*this);
+    for (int si=0; si<order.size(); ++si) {
+        auto &action_info_map = table->action_info_map_list_[si];
+        action_info_map = action_info_map_list_[order[si]];
+        for (auto &itr : action_info_map)
+            remap(itr.second);
+
+        if (hasConflicts() == false)
+            continue;
+
+        auto &conflict_action_map = table->conflict_action_map_list_[si];
+        conflict_action_map = conflict_action_map_list_[order[si]];
+        for (auto &itr : conflict_action_map) {
+            for (auto &info : itr.second)
+                remap(info);
+        }
+    }
+
+    for (auto &state : table->entry_states_)
+        state = new_idxs[state];
+    return table;
+}
+
+TableSize::TableSize ()
+:state_count(0),
+ unique_row_count(0),
+ cell_count(0) {
+}
+
+string TableSize::toString () const {
+    stringstream ss;
+    ss << "states: " << state_count
+            << ", unique rows: " << unique_row_count
+            << ", cells: " << cell_count;
+    return ss.str();
+}
+
+// one cell as ints. target is idx of shift and goto, or class of the target
+static void _pushCell (
+        vector<long long> &key,
+        const TerminalBase *termnon,
+        const ParsingTable::ActionInfo &info,
+        const vector<int> *class_of) {
+    key.push_back((long long)(intptr_t)termnon);
+    key.push_back(info.action);
+    bool is_target = info.action == ParsingTable::ActionInfo::SHIFT
+            || info.action == ParsingTable::ActionInfo::GOTO;
+    key.push_back((is_target == true && class_of != null)? (*class_of)[info.idx]: info.idx);
+}
+
+// every cell of a state, conflicts after a separator
+static void _makeRowKey (
+        const map<shared_ptr<TerminalBase>, ParsingTable::ActionInfo> &action_info_map,
+        const map<shared_ptr<TerminalBase>, vector<ParsingTable::ActionInfo>> *conflict_action_map,
+        const vector<int> *class_of,
+        vector<long long> &key) {
+    key.clear();
+    for (auto &itr : action_info_map)
+        _pushCell(key, itr.first.get(), itr.second, class_of);
+
+    if (conflict_action_map == null)
+        return;
+    key.push_back(-1);
+    for (auto &itr : *conflict_action_map) {
+        for (auto &info : itr.second)
+            _pushCell(key, itr.first.get(), info, class_of);
+    }
+}
+
+TableSize ParsingTable::size () const {
+    TableSize result;
+    result.state_count = action_info_map_list_.size();
+
+    set<vector<long long>> rows;
+    vector<long long> key;
+    for (int si=0; si<action_info_map_list_.size(); ++si) {
+        auto conflict_action_map = hasConflicts()? &conflict_action_map_list_[si]: null;
+        _makeRowKey(action_info_map_list_[si], conflict_action_map, null, key);
+        rows.insert(key);
+
+        result.cell_count += action_info_map_list_[si].size();
+        if (conflict_action_map != null) {
+            for (auto &itr : *conflict_action_map)
+                result.cell_count += itr.second.size();
+        }
+    }
+    result.unique_row_count = rows.size();
+    return result;
+}
+
+shared_ptr<ParsingTable> ParsingTable::minimizeStates (TableSize *before, TableSize *after) const {
+    if (before != null)
+        *before = size();
+
+    // all states are one class at first, so targets don't count.
+    // classes split by classes of targets until none splits.
+    // classes are numbered by their first state, so state 0 stays 0
+    int state_count = action_info_map_list_.size();
+    vector<int> class_of(state_count, 0), next_class_of(state_count);
+    int class_count = 1;
+    vector<long long> key;
+    while (true) {
+        map<vector<long long>, int> class_by_key;
+        for (int si=0; si<state_count; ++si) {
+            auto conflict_action_map = hasConflicts()? &conflict_action_map_list_[si]: null;
+            _makeRowKey(action_info_map_list_[si], conflict_action_map, &class_of, key);
+            key.push_back(class_of[si]);
+
+            auto itr = class_by_key.find(key);
+            if (itr == class_by_key.end())
+                itr = class_by_key.emplace(key, class_by_key.size()).first;
+            next_class_of[si] = itr->second;
+        }
+
+        class_of.swap(next_class_of);
+        if (class_by_key.size() == class_count)
+            break;
+        class_count = class_by_key.size();
+    }
+
+    // first state of each class is kept
+    vector<int> states_of_class(class_count, -1);
+    for (int si=0; si<state_count; ++si) {
+        if (states_of_class[class_of[si]] < 0)
+            states_of_class[class_of[si]] = si;
+    }
+
+    auto remap = [&class_of](ActionInfo &info) {
+        if (info.action == ActionInfo::SHIFT || info.action == ActionInfo::GOTO)
+            info.idx = class_of[info.idx];
+    };
+
+    auto table = make_shared<ParsingTable>(*this);
+    table->action_info_map_list_.resize(class_count);
+    if (hasConflicts() == true)
+        table->conflict_action_map_list_.resize(class_count);
+    for (int ci=0; ci<class_count; ++ci) {
+        auto si = states_of_class[ci];
+        auto &action_info_map = table->action_info_map_list_[ci];
+        action_info_map = action_info_map_list_[si];
+        for (auto &itr : action_info_map)
+            remap(itr.second);
+
+        if (hasConflicts() == false)
+            continue;
+
+        auto &conflict_action_map = table->conflict_action_map_list_[ci];
+        conflict_action_map = conflict_action_map_list_[si];
+        for (auto &itr : conflict_action_map) {
+            for (auto &info : itr.second)
+                remap(info);
+        }
+    }
+
+    for (auto &state : table->entry_states_)
+        state = class_of[state];
+
+    if (after != null)
+        *after = table->size();
+    return table;
+}
+
+static map<string, ParsingTable::ActionInfo> _actionsByName (
+        const map<shared_ptr<TerminalBase>, ParsingTable::ActionInfo> &action_info_map) {
+    map<string, ParsingTable::ActionInfo> result;
+    for (auto &itr : action_info_map)
+        result[(itr.first == null)? "$": itr.first->name] = itr.second;
+    return result;
+}
+
+bool ParsingTable::isEquivalent (const ParsingTable &other) const {
+    if (rules_.size() != other.rules_.size()
+            || action_info_map_list_.size() != other.action_info_map_list_.size())
+        return false;
+
+    for (int ri=0; ri<rules_.size(); ++ri) {
+        if (rules_[ri]->toString() != other.rules_[ri]->toString())
+            return false;
+    }
+
+    // walk both tables from entry states and keep state idx pairs consistent
+    if (entry_states_.size() != other.entry_states_.size())
+        return false;
+    vector<int> other_idxs(action_info_map_list_.size(), -1);
+    vector<int> this_idxs (action_info_map_list_.size(), -1);
+    vector<int> queue;
+    for (int ei=0; ei<entry_states_.size(); ++ei) {
+        auto si = entry_states_[ei];
+        auto other_si = other.entry_states_[ei];
+        if (other_idxs[si] < 0 && this_idxs[other_si] < 0) {
+            other_idxs[si] = other_si;
+            this_idxs[other_si] = si;
+            queue.push_back(si);
+        }else if (other_idxs[si] != other_si) {
+            return false;
+        }
+    }
+
+    for (int qi=0; qi<queue.size(); ++qi) {
+        auto si = queue[qi];
+        auto actions       = _actionsByName(action_info_map_list_[si]);
+        auto other_actions = _actionsByName(other.action_info_map_list_[other_idxs[si]]);
+        if (actions.size() != other_actions.size())
+            return false;
+
+        for (auto &itr : actions) {
+            auto other_itr = other_actions.find(itr.first);
+            if (other_itr == other_actions.end())
+                return false;
+
+            auto &info       = itr.second;
+            auto &other_info = other_itr->second;
+            if (info.action != other_info.action)
+                return false;
+
+            if (info.action != ActionInfo::SHIFT && info.action != ActionInfo::GOTO) {
+                if (info.idx != other_info.idx)
+                    return false;
+                continue;
+            }
+
+            if (other_idxs[info.idx] < 0 && this_idxs[other_info.idx] < 0) {
+                other_idxs[info.idx] = other_info.idx;
+                this_idxs[other_info.idx] = info.idx;
+                queue.push_back(info.idx);
+            }else if (other_idxs[info.idx] != other_info.idx) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void ParsingTable::_getActions (
+        int state_idx,
+        const shared_ptr<TerminalBase> &term,
+        vector<ActionInfo> &result) {
+    result.clear();
+
+    auto &action_info_map = action_info_map_list_[state_idx];
+    auto itr = action_info_map.find(term);
+    if (itr == action_info_map.end())
+        return;
+    result.push_back(itr->second);
+
+    if (hasConflicts() == false)
+        return;
+
+    auto &conflict_action_map = conflict_action_map_list_[state_idx];
+    auto conflict_itr = conflict_action_map.find(term);
+    if (conflict_itr != conflict_action_map.end())
+        result.insert(result.end(), conflict_itr->second.begin(), conflict_itr->second.end());
+}
+
+// graph-structured stack. a node is a state at a token position and links
+// go down to previous nodes with the parse node between them.
+// old nodes are freed when no head reaches them
+class GssNode;
+
+class GssLink {
+public:
+    shared_ptr<GssNode> pred;
+    shared_ptr<Node> node;
+};
+
+class GssNode {
+public:
+    int state_idx;
+    vector<GssLink> links;
+
+    GssNode (int state_idx)
+    :state_idx(state_idx) {
+    }
+};
+
+class GssPath {
+public:
+    shared_ptr<GssNode> base;
+    vector<shared_ptr<Node>> nodes;   // reversed
+};
+
+// paths of length from node. first link must be required_link if it isn't null
+static void _collectGssPaths (
+        const shared_ptr<GssNode> &node,
+        int length,
+        const GssLink *required_link,
+        vector<shared_ptr<Node>> &nodes,
+        vector<GssPath> &result) {
+    if (length == 0) {
+        result.push_back(GssPath{ node, nodes });
+        return;
+    }
+
+    for (auto &link : node->links) {
+        if (required_link != null && &link != required_link)
+            continue;
+
+        nodes.push_back(link.node);
+        _collectGssPaths(link.pred, length - 1, null, nodes, result);
+        nodes.pop_back();
+    }
+}
+
+class GlrContext {
+public:
+    const Token *token;
+    shared_ptr<TerminalBase> term;
+    vector<shared_ptr<GssNode>> heads;
+    int processed_count;   // heads whose reductions are done
+    vector<ParsingTable::ActionInfo> actions;
+};
+
+shared_ptr<Node> ParsingTable::generateParseForest (
+        const char *text,
+        const vector<Token> &tokens,
+        int max_head_count) {
+
+    vector<NodeStackInfo> node_stack;
+    node_stack.push_back(NodeStackInfo(null, 0));
+    NoParseStats stats;
+    ParseContext owned_nodes;
+    owned_nodes.use_arena_ = false;
+
+    GlrContext glr;
+    vector<ParsingTable::ActionInfo> actions;
+    vector<GssPath> paths;
+    vector<shared_ptr<Node>> path_nodes;
+
+    // reduces on head. reached heads are added to glr.heads
+    std::function<bool(const shared_ptr<GssNode>&, const GssLink*)> reduce_head =
+            [&](const shared_ptr<GssNode> &head, const GssLink *required_link) {
+        vector<ActionInfo> head_actions;
+        _getActions(head->state_idx, glr.term, head_actions);
+        for (auto &action_info : head_actions) {
+            if (action_info.action != ActionInfo::REDUCE)
+                continue;
+
+            auto rule = rules_[action_info.idx];
+            paths.clear();
+            _collectGssPaths(head, rule->right_side.size(), required_link, path_nodes, paths);
+            auto head_paths = paths;
+
+            for (auto &path : head_paths) {
+                auto &goto_map = action_info_map_list_[path.base->state_idx];
+                auto goto_itr = goto_map.find(rule->left_side);
+                if (goto_itr == goto_map.end() || goto_itr->second.action != ActionInfo::GOTO)
+                    continue;
+
+                auto reduced_node = make_shared<Node>(rule->left_side, glr.token);
+                reduced_node->reduced_rule_idx(action_info.idx);
+                for (auto ni = path.nodes.rbegin(); ni != path.nodes.rend(); ++ni)
+                    reduced_node->addChild(*ni);
+
+                // same state on this token is one head
+                auto goto_state = goto_itr->second.idx;
+                int hi = 0;
+                for (; hi < glr.heads.size(); ++hi) {
+                    if (glr.heads[hi]->state_idx == goto_state)
+                        break;
+                }
+
+                if (hi == glr.heads.size()) {
+                    if (glr.heads.size() >= max_head_count) {
+                        cout << "err: glr heads exceed " << max_head_count << endl;
+                        return false;
+                    }
+                    auto new_head = make_shared<GssNode>(goto_state);
+                    new_head->links.push_back(GssLink{ path.base, reduced_node });
+                    glr.heads.push_back(new_head);
+                    continue;
+                }
+
+                // same span is packed into one node
+                auto &goto_head = glr.heads[hi];
+                bool is_packed = false;
+                for (auto &link : goto_head->links) {
+                    if (link.pred == path.base) {
+                        link.node->addAlternative(reduced_node);
+                        is_packed = true;
+                        break;
+                    }
+                }
+                if (is_packed == true)
+                    continue;
+
+                goto_head->links.push_back(GssLink{ path.base, reduced_node });
+
+                // processed heads have to reduce through the new link too
+                if (hi < glr.processed_count) {
+                    auto head_copy = goto_head;
+                    if (reduce_head(head_copy, &head_copy->links.back()) == false)
+                        return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    bool is_glr = false;
+    for (int ti=0; ti<tokens.size(); ) {
+        auto &t = tokens[ti];
+
+        // get terminal for token
+        if (terminal_map_.find(t.type) == terminal_map_.end()) {
+            cout << "err: token " << t.type << " cannot be parsed" << endl;
+            return null;
+        }
+        auto &term = terminal_map_[t.type];
+
+        if (is_glr == false) {
+            auto &nsi = node_stack.back();
+
+            // go glr on a conflict
+            if (hasConflicts() == true
+                    && conflict_action_map_list_[nsi.state_idx].count(term) > 0) {
+                auto gss = make_shared<GssNode>(0);
+                for (int si=1; si<node_stack.size(); ++si) {
+                    auto next = make_shared<GssNode>(node_stack[si].state_idx);
+                    next->links.push_back(GssLink{ gss, node_stack[si].node });
+                    gss = next;
+                }
+                glr.heads.assign(1, gss);
+                node_stack.clear();
+                is_glr = true;
+                continue;
+            }
+
+            auto &action_info_map = action_info_map_list_[nsi.state_idx];
+            auto itr = action_info_map.find(term);
+            if (itr == action_info_map.end()) {
+                cout << "err: cannot be parsed \""
+                        << t.toString(text)
+                        << "\" State " << nsi.state_idx << " idx:" << t.first_idx << endl;
+                return null;
+            }
+
+            auto &action_info = itr->second;
+            switch (action_info.action) {
+                case ActionInfo::Action::SHIFT:
+                    node_stack.push_back(NodeStackInfo(make_shared<Node>(term, &t), action_info.idx));
+                    ++ti;
+                    break;
+                case ActionInfo::Action::REDUCE:
+                    if (_reduceStack(action_info_map_list_, &t, rules_, action_info.idx, node_stack, owned_nodes, stats) == false)
+                        return null;
+                    break;
+                case ActionInfo::Action::ACCEPT:
+                    return node_stack.back().node;
+                default:
+                    cout << "unknown action \'" << action_info.action << "\'" << endl;
+                    return null;
+            }
+            continue;
+        }
+
+        // reduce every head until no new head or link
+        glr.token = &t;
+        glr.term  = term;
+        glr.processed_count = 0;
+        for (; glr.processed_count < glr.heads.size(); ) {
+            auto head = glr.heads[glr.processed_count++];
+            if (reduce_head(head, null) == false)
+                return null;
+        }
+
+        // accept
+        for (auto &head : glr.heads) {
+            _getActions(head->state_idx, term, actions);
+            for (auto &action_info : actions) {
+                if (action_info.action != ActionInfo::ACCEPT)
+                    continue;
+
+                auto root = head->links[0].node;
+                for (int li=1; li<head->links.size(); ++li)
+                    root->addAlternative(head->links[li].node);
+                return root;
+            }
+        }
+
+        // shift
+        auto leaf = make_shared<Node>(term, &t);
+        vector<shared_ptr<GssNode>> next_heads;
+        for (auto &head : glr.heads) {
+            _getActions(head->state_idx, term, actions);
+            for (auto &action_info : actions) {
+                if (action_info.action != ActionInfo::SHIFT)
+                    continue;
+
+                int hi = 0;
+                for (; hi < next_heads.size(); ++hi) {
+                    if (next_heads[hi]->state_idx == action_info.idx)
+                        break;
+                }
+                if (hi == next_heads.size())
+                    next_heads.push_back(make_shared<GssNode>(action_info.idx));
+                next_heads[hi]->links.push_back(GssLink{ head, leaf });
+            }
+        }
+
+        if (next_heads.empty()) {
+            cout << "err: cannot be parsed \""
+                    << t.toString(text) << "\" idx:" << t.first_idx << endl;
+            return null;
+        }
+        glr.heads.swap(next_heads);
+        ++ti;
+
+        // back to deterministic loop if stack is a single chain again
+        if (glr.heads.size() == 1) {
+            vector<NodeStackInfo> chain;
+            auto gss = glr.heads[0];
+            while (gss->links.size() == 1) {
+                chain.push_back(NodeStackInfo(gss->links[0].node, gss->state_idx));
+                gss = gss->links[0].pred;
+            }
+
+            if (gss->links.empty()) {
+                node_stack.assign(1, NodeStackInfo(null, gss->state_idx));
+                node_stack.insert(node_stack.end(), chain.rbegin(), chain.rend());
+                glr.heads.clear();
+                is_glr = false;
+            }
+        }
+    }
+
+    cout << "err: cannot reduce. syntax error." << endl;
+    return null;
+}
+
+// name -> termnon. interned names are found by string id without hashing.
+// ids out of the string table and unknown names make it broken
+class TermnonMap {
+public:
+    TermnonMap (int string_count)
+    :termnon_by_string_id_(string_count),
+     is_broken_(false) {
+    }
+
+    inline bool is_broken () const { return is_broken_; }
+
+    void set (const shared_ptr<Cursor> &pp_name, const shared_ptr<TerminalBase> &termnon) {
+        auto id = pp_name->getStringId();
+        if (id >= 0 && id < termnon_by_string_id_.size())
+            termnon_by_string_id_[id] = termnon;
+        else if (id >= 0)
+            is_broken_ = true;
+        termnon_by_name_[pp_name->get("")] = termnon;
+    }
+
+    const shared_ptr<TerminalBase>& get (const shared_ptr<Cursor> &pp_name) {
+        static const shared_ptr<TerminalBase> none;
+        auto id = pp_name->getStringId();
+        if (id >= 0 && id < termnon_by_string_id_.size())
+            return termnon_by_string_id_[id];
+
+        auto itr = termnon_by_name_.find(pp_name->get(""));
+        if (id >= 0 || itr == termnon_by_name_.end()) {
+            is_broken_ = true;
+            return none;
+        }
+        return itr->second;
+    }
+
+private:
+    vector<shared_ptr<TerminalBase>> termnon_by_string_id_;
+    unordered_map<string, shared_ptr<TerminalBase>> termnon_by_name_;
+    bool is_broken_;
+};
+
 static void _loadNonterminal(
     shared_ptr<Cursor> const& pp_rules,
     shared_ptr<Nonterminal> const& non,
-    unordered_map<string, shared_ptr<TerminalBase>> termnon_map) {
+    TermnonMap &termnon_map) {
 
   non->rules.resize(pp_rules->size());
   for (int ri = 0; ri<pp_rules->size(); ++ri) {
@@ -568,78 +1342,149 @@ static void _loadNonterminal(
 
     auto &rule = non->rules[ri];
     rule.left_side = dynamic_pointer_cast<Nonterminal>(
-      termnon_map[pp_rule->getElem(0)->get("")]);
+      termnon_map.get(pp_rule->getElem(0)));
 
     rule.right_side.resize(pp_rule->size() - 1);
     for (int rri = 1; rri<pp_rule->size(); ++rri)
-      rule.right_side[rri - 1] = termnon_map[pp_rule->getElem(rri)->get("")];
+      rule.right_side[rri - 1] = termnon_map.get(pp_rule->getElem(rri));
   }
 }
 
+// bump when the layout of saveBinary changes
+static const char *TABLE_FORMAT = "parsing table 4";
+
+void ParsingTable::_clearLoaded (const string &reason) {
+    // TODO err: parsing table data is broken: {reason}
+    cout << "err: parsing table data is broken: " << reason << endl;
+    symbols_.clear();
+    start_symbol_ = null;
+    terminal_map_.clear();
+    rules_.clear();
+    action_info_map_list_.clear();
+    conflict_action_map_list_.clear();
+    entry_states_.clear();
+}
+
 ParsingTable::ParsingTable (vector<unsigned char> const& data) {
 
     auto paw = make_shared<PawPrint>("parsing table", data);
     auto root = PawPrint::root(paw);
+    if (root == null || root->isSequence() == false
+            || root->getElem(0)->get("") != TABLE_FORMAT) {
+        // TODO err: data is not a parsing table of this version
+        cout << "err: data is not a parsing table of format \'" << TABLE_FORMAT << "\'" << endl;
+        return;
+    }
 
-    unordered_map<string, shared_ptr<TerminalBase>> termnon_map;
+    TermnonMap termnon_map(paw->string_count());
 
     // load terminals
-    auto pp_terminals = root->getElem(0);
+    auto pp_terminals = root->getElem(1);
     for (int ti=0; ti<pp_terminals->size(); ++ti) {
         auto pp_term = pp_terminals->getElem(ti);
-        auto name       = pp_term->getElem(0)->get("");
+        auto pp_name    = pp_term->getElem(0);
+        auto name       = pp_name->get("");
         auto token_type = pp_term->getElem(1)->get(-1);
 
         auto term = make_shared<Terminal>(name, token_type);
     if (name == "$")
       term = null;
         terminal_map_[token_type] = term;
-        termnon_map[name] = term;
+        termnon_map.set(pp_name, term);
     }
 
     // load nonterminals
-    auto pp_nonterminals = root->getElem(1);
+    auto pp_nonterminals = root->getElem(2);
     for (int ni=0; ni<pp_nonterminals->size(); ni+=2) {
-        auto name = pp_nonterminals->getElem(ni)->get("");
+        auto pp_name = pp_nonterminals->getElem(ni);
 
-        auto non = make_shared<Nonterminal>(name);
-        termnon_map[name] = non;
+        auto non = make_shared<Nonterminal>(pp_name->get(""));
+        termnon_map.set(pp_name, non);
     symbols_.push_back(non);
     }
     for (int ni=0; ni<pp_nonterminals->size(); ni+=2) {
-        auto name     = pp_nonterminals->getElem(ni  )->get("");
+        auto pp_name  = pp_nonterminals->getElem(ni  );
         auto pp_rules = pp_nonterminals->getElem(ni+1);
 
-        auto non = dynamic_pointer_cast<Nonterminal>(termnon_map[name]);
+        auto non = dynamic_pointer_cast<Nonterminal>(termnon_map.get(pp_name));
+        if (non == null) {
+            _clearLoaded("nonterminal names are broken");
+            return;
+        }
     _loadNonterminal(pp_rules, non, termnon_map);
     }
 
     // start symbol
-  auto start_symbol_name     = root->getElem(2)->get("");
-  auto pp_start_symbol_rules = root->getElem(3);
+  auto start_symbol_name     = root->getElem(3)->get("");
+  auto pp_start_symbol_rules = root->getElem(4);
   start_symbol_ = make_shared<Nonterminal>(start_symbol_name);
   _loadNonterminal(pp_start_symbol_rules, start_symbol_, termnon_map);
   for (auto &r : start_symbol_->rules)
     r.left_side = start_symbol_;
 
     // action_info_map_list_
-    auto pp_action_info_map_list = root->getElem(4);
+    auto pp_action_info_map_list = root->getElem(5);
     action_info_map_list_.resize(pp_action_info_map_list->size());
     for (int aim_idx=0; aim_idx<pp_action_info_map_list->size(); ++aim_idx) {
         auto pp_action_info_map = pp_action_info_map_list->getElem(aim_idx);
         auto &action_info_map   = action_info_map_list_           [aim_idx];
-        for (int ai_idx=0; ai_idx<pp_action_info_map->size(); ++ai_idx) {
-      auto pair = pp_action_info_map->getKeyValuePair(ai_idx);
-            auto name           = pair->getKey  ();
-            auto pp_action_info = pair->getValue();
 
-            auto &termnon = termnon_map[name];
+        auto pp_names = pp_action_info_map->getElem(0);
+        auto actions  = pp_action_info_map->getElem(1)->getArray<byte>();
+        auto idxs     = pp_action_info_map->getElem(2)->getArray<int >();
+        if (actions.size() != pp_names->size() || idxs.size() != pp_names->size()) {
+            _clearLoaded("state " + to_string(aim_idx) + " has broken actions");
+            return;
+        }
+        for (int ai_idx=0; ai_idx<pp_names->size(); ++ai_idx) {
+            auto &termnon = termnon_map.get(pp_names->getElem(ai_idx));
             action_info_map[termnon] = ActionInfo(
-                    (ParsingTable::ActionInfo::Action)pp_action_info->getElem(0)->get(-1),
-                    pp_action_info->getElem(1)->get(-1));
+                    (ParsingTable::ActionInfo::Action)actions[ai_idx],
+                    idxs[ai_idx]);
         }
     }
 
+    // conflict_action_map_list_
+    if (root->size() > 6) {
+        auto pp_conflict_action_map_list = root->getElem(6);
+        conflict_action_map_list_.resize(pp_conflict_action_map_list->size());
+        for (int cam_idx=0; cam_idx<pp_conflict_action_map_list->size(); ++cam_idx) {
+            auto pp_conflict_action_map = pp_conflict_action_map_list->getElem(cam_idx);
+            auto &conflict_action_map   = conflict_action_map_list_        [cam_idx];
+
+            auto pp_names = pp_conflict_action_map->getElem(0);
+            auto actions  = pp_conflict_action_map->getElem(1)->getArray<byte>();
+            auto idxs     = pp_conflict_action_map->getElem(2)->getArray<int >();
+            if (actions.size() != pp_names->size() || idxs.size() != pp_names->size()) {
+                _clearLoaded("state " + to_string(cam_idx) + " has broken conflicts");
+                return;
+            }
+            for (int ai_idx=0; ai_idx<pp_names->size(); ++ai_idx) {
+                auto &termnon = termnon_map.get(pp_names->getElem(ai_idx));
+                conflict_action_map[termnon].push_back(ActionInfo(
+                        (ParsingTable::ActionInfo::Action)actions[ai_idx],
+                        idxs[ai_idx]));
+            }
+        }
+    }
+
+    if (termnon_map.is_broken() == true) {
+        _clearLoaded("symbol names are broken");
+        return;
+    }
+
+    // entry_states_
+    if (root->size() > 7) {
+        auto states = root->getElem(7)->getArray<int>();
+        if (states.size() != start_symbol_->rules.size()) {
+            _clearLoaded("entry states are broken");
+            return;
+        }
+        entry_states_.assign(states.begin(), states.end());
+    }else {
+        entry_states_.assign(1, 0);
+    }
+
   // rules
   map<const Rule*, int> rule_idx_map;
   for (auto &r : start_symbol_->rules) {
@@ -652,16 +1497,55 @@ ParsingTable::ParsingTable (vector<unsigned char> const& data) {
       rules_.push_back(&r);
     }
   }
+
+    // targets are indexed without checks while parsing
+    int state_count = action_info_map_list_.size();
+    auto is_valid = [this, state_count](const ActionInfo &action_info) {
+        switch (action_info.action) {
+            case ActionInfo::SHIFT:
+            case ActionInfo::GOTO:
+                return action_info.idx >= 0 && action_info.idx < state_count;
+            case ActionInfo::REDUCE:
+            case ActionInfo::ACCEPT:
+                return action_info.idx >= 0 && action_info.idx < rules_.size();
+            default:
+                return false;
+        }
+    };
+    for (int si=0; si<state_count; ++si) {
+        for (auto &[termnon, action_info] : action_info_map_list_[si]) {
+            if (is_valid(action_info) == false) {
+                _clearLoaded("state " + to_string(si) + " has an action out of range");
+                return;
+            }
+        }
+    }
+    for (int si=0; si<conflict_action_map_list_.size(); ++si) {
+        for (auto &[termnon, action_infos] : conflict_action_map_list_[si]) {
+            for (auto &action_info : action_infos) {
+                if (is_valid(action_info) == false) {
+                    _clearLoaded("state " + to_string(si) + " has a conflict out of range");
+                    return;
+                }
+            }
+        }
+    }
+    for (auto state : entry_states_) {
+        if (state < 0 || state >= state_count) {
+            _clearLoaded("entry state " + to_string(state) + " is out of range");
+            return;
+        }
+    }
 }
 
 static void _pushNonterminal (const shared_ptr<Nonterminal> &non, PawPrint &paw) {
-  paw.pushString(non->name);
+  paw.pushInternedString(non->name);
   paw.beginSequence(); // rules
   for (auto &r : non->rules) {
     paw.beginSequence();
-            paw.pushString(r.left_side->name);
+            paw.pushInternedString(r.left_side->name);
             for (auto &rn : r.right_side) {
-                paw.pushString(rn->name);
+                paw.pushInternedString(rn->name);
             }
     paw.endSequence();
   }
@@ -671,18 +1555,29 @@ static void _pushNonterminal (const shared_ptr<Nonterminal> &non, PawPrint &paw)
 bool ParsingTable::saveBinary (vector<unsigned char> &result) {
     PawPrint paw("parsing table");
 
+    // rough size: (name ref + action + idx) per cell, name ref per rule element
+    size_t reserve_size = 0;
+    for (auto &action_info_map : action_info_map_list_)
+        reserve_size += action_info_map.size() * 10 + 32;
+    for (auto &r : rules_)
+        reserve_size += (r->right_side.size() + 1) * 5 + 2;
+    paw.reserve(reserve_size);
+
     paw.beginSequence();
-    
+
+        // loaders of other layouts reject it
+        paw.pushString(TABLE_FORMAT);
+
         // terminals
         paw.beginSequence();
             for (auto &itr : terminal_map_) {
                 auto &term = itr.second;
         paw.beginSequence();
         if (term != null) {
-          paw.pushString(term->name);
+          paw.pushInternedString(term->name);
           paw.pushUint2B(term->token_type);
         }else {
-          paw.pushString("$");
+          paw.pushInternedString("$");
           paw.pushUint2B(0);
         }
         paw.endSequence();
@@ -698,30 +1593,65 @@ bool ParsingTable::saveBinary (vector<unsigned char> &result) {
         // start symbol
     _pushNonterminal(start_symbol_, paw);
 
-        // action_info_map_list_
+        // action_info_map_list_ : [names, actions, idxs] per state
+        vector<byte> actions;
+        vector<int > idxs;
         paw.beginSequence();
             for (auto &action_info_map : action_info_map_list_) {
-                paw.beginMap();
-                    for (auto &itr : action_info_map) {
-                        auto &termnon = itr.first;
-                        auto &info    = itr.second;
-
-            if (termnon != null)
-              paw.pushKey(termnon->name);
-            else
-              paw.pushKey("$");
-                        paw.beginSequence(); // ActionInfo
-                            paw.pushUint1B(info.action);
-                            paw.pushSint4B(info.idx   );
-                        paw.endSequence();
-                    }
-                paw.endMap();
+                actions.clear();
+                idxs   .clear();
+                paw.beginSequence();
+                    paw.beginSequence();
+                        for (auto &itr : action_info_map) {
+                            auto &termnon = itr.first;
+                            auto &info    = itr.second;
+
+                            paw.pushInternedString((termnon != null)? termnon->name: "$");
+                            actions.push_back(info.action);
+                            idxs   .push_back(info.idx   );
+                        }
+                    paw.endSequence();
+                    paw.pushArray(span<const byte>(actions));
+                    paw.pushArray(span<const int >(idxs   ));
+                paw.endSequence();
             }
         paw.endSequence();
 
+        // conflict_action_map_list_ : same as above, only if there are conflicts
+        if (hasConflicts() == true) {
+            paw.beginSequence();
+                for (auto &conflict_action_map : conflict_action_map_list_) {
+                    actions.clear();
+                    idxs   .clear();
+                    paw.beginSequence();
+                        paw.beginSequence();
+                            for (auto &itr : conflict_action_map) {
+                                for (auto &info : itr.second) {
+                                    paw.pushInternedString((itr.first != null)? itr.first->name: "$");
+                                    actions.push_back(info.action);
+                                    idxs   .push_back(info.idx   );
+                                }
+                            }
+                        paw.endSequence();
+                        paw.pushArray(span<const byte>(actions));
+                        paw.pushArray(span<const int >(idxs   ));
+                    paw.endSequence();
+                }
+            paw.endSequence();
+        }else if (entry_states_.size() > 1) {
+            paw.beginSequence();
+            paw.endSequence();
+        }
+
+        // entry_states_ : only if there are entry symbols
+        if (entry_states_.size() > 1)
+            paw.pushArray(span<const int>(entry_states_));
+
     paw.endSequence();
 
-    result = paw.raw_data();
+    paw.pushStringTable();
+
+    result.swap(paw.raw_data());
 
     return true;
 }
@@ -1,13 +1,19 @@
 #ifndef PAW_PRINT_PARSE_TABLE
 #define PAW_PRINT_PARSE_TABLE
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <set>
+#include <string>
 #include <vector>
 
 #include "token.h"
+#include "token_buffer.h"
+#include "token_stream.h"
 #include "node.h"
+#include "parse_context.h"
+#include "parse_stats.h"
 
 #include "defines.h"
 
@@ -16,62 +22,29 @@ namespace parse_table {
 using std::map;
 using std::set;
 using std::shared_ptr;
+using std::string;
 using std::vector;
 
-using FirstMap = map<shared_ptr<TerminalBase>, set<shared_ptr<TerminalBase>>>;
 
-
-class PAW_PRINT_API Configuration {
+// sizes of a table, reported by ParsingTable::minimizeStates
+class PAW_PRINT_API TableSize {
 public:
-	PAW_GETTER(const shared_ptr<Nonterminal>&, left_side)
-	PAW_GETTER(const Rule&, rule)
-	PAW_GETTER(int, idx_after_cursor)
-
-	inline set<shared_ptr<TerminalBase>>& lookahead () { return lookahead_; }
-
-
-	Configuration (
-			const shared_ptr<Nonterminal> &left_side,
-			const Rule &rule,
-			int idx_after_cursor,
-			const set<shared_ptr<TerminalBase>> &lookahead);
-
-	string toString ();
+	int state_count;
+	int unique_row_count;	// states with different action maps, targets as they are
+	long long cell_count;	// actions of all states, conflicts included
 
+	TableSize ();
 
-private:
-	shared_ptr<Nonterminal> left_side_;
-	const Rule &rule_;
-	int idx_after_cursor_;
-	set<shared_ptr<TerminalBase>> lookahead_; // null means end($)
+	string toString () const;
 };
 
-class PAW_PRINT_API State {
+// tree rebuilt by ParsingTable::loadTree, with the tokens its nodes point to.
+// loaded nodes are owned by nodes, root and children don't own them
+class PAW_PRINT_API LoadedTree {
 public:
-	static shared_ptr<State> makeState(
-			const vector<shared_ptr<Nonterminal>> &all_terminals,
-			const FirstMap &first_map,
-			const vector<shared_ptr<Configuration>> &transited_configs);
-
-	PAW_GETTER_SETTER(const string &, name)
-	PAW_GETTER(const vector<shared_ptr<Configuration>>&, transited_configs)
-	PAW_GETTER(const vector<shared_ptr<Configuration>>&, closures)
-	inline map<shared_ptr<TerminalBase>, shared_ptr<State>>& transition_map () {
-        return transition_map_;
-    }
-
-	State (
-			const vector<shared_ptr<Configuration>> &transited_configs,
-			const vector<shared_ptr<Configuration>> &closures);
-
-	void print ();
-
-
-private:
-	string name_;
-	vector<shared_ptr<Configuration>> transited_configs_;
-	vector<shared_ptr<Configuration>> closures_;
-	map<shared_ptr<TerminalBase>, shared_ptr<State>> transition_map_;
+	vector<Token> tokens;
+	vector<Node> nodes;
+	shared_ptr<Node> root;
 };
 
 class PAW_PRINT_API ParsingTable {
@@ -95,12 +68,20 @@ public:
 
 	ParsingTable() {}
 
+	// table of saveBinary. empty, state_count() 0, if data is broken
+	// or was saved in another layout
 	ParsingTable (const vector<unsigned char> &data);
 
+	// action_info_map_list is indexed by state and uses rule idxs of
+	// start_symbol rules first, then rules of symbols in order.
+	// conflict_action_map_list keeps actions which lost the cell, for glr.
+	// entry_states[i] is the start state of start_symbol rule i, {0} if empty
 	ParsingTable (
 			const vector<shared_ptr<Nonterminal>> &symbols,
 			const shared_ptr<Nonterminal> &start_symbol,
-			const vector<shared_ptr<State>> &states);
+			vector<map<shared_ptr<TerminalBase>, ActionInfo>> &&action_info_map_list,
+			vector<map<shared_ptr<TerminalBase>, vector<ActionInfo>>> &&conflict_action_map_list = {},
+			vector<int> &&entry_states = {});
 
     string toString () const;
 
@@ -109,14 +90,176 @@ public:
             const vector<Token> &tokens,
             bool need_print=false);
 
+    // instrumented parse. instantiated for NoParseStats and ParseStats
+    template <class Stats>
+    shared_ptr<Node> generateParseTree (
+            const char *text,
+            const vector<Token> &tokens,
+            Stats &stats,
+            bool need_print=false);
+
+    // parse with the stack and nodes of context, so a warm context doesn't
+    // allocate. the tree is valid until context is used again
+    shared_ptr<Node> generateParseTree (
+            const char *text,
+            const vector<Token> &tokens,
+            ParseContext &context,
+            bool need_print=false);
+
+    // same parse reading only the type array in the loop.
+    // nodes point to tokens made by tokens.token()
+    shared_ptr<Node> generateParseTree (
+            const char *text,
+            const TokenBuffer &tokens,
+            bool need_print=false);
+
+    template <class Stats>
+    shared_ptr<Node> generateParseTree (
+            const char *text,
+            const TokenBuffer &tokens,
+            Stats &stats,
+            bool need_print=false);
+
+    shared_ptr<Node> generateParseTree (
+            const char *text,
+            const TokenBuffer &tokens,
+            ParseContext &context,
+            bool need_print=false);
+
+    // start state of a parse of the symbol named name, 0 for the start symbol.
+    // -1 if it is not an entry symbol of the table
+    int entryState (const string &name) const;
+
+    // parse of tokens as the entry symbol named entry, which is the top node.
+    // null if the table has no such entry
+    shared_ptr<Node> generateEntryParseTree (
+            const string &entry,
+            const char *text,
+            const vector<Token> &tokens,
+            bool need_print=false);
+
+    shared_ptr<Node> generateEntryParseTree (
+            const string &entry,
+            const char *text,
+            const vector<Token> &tokens,
+            ParseContext &context,
+            bool need_print=false);
+
+    // parse of tokens read as they are written to the stream by another thread
+    shared_ptr<Node> generateParseTree (
+            const char *text,
+            TokenStream &tokens,
+            bool need_print=false);
+
+    shared_ptr<Node> generateParseTree (
+            const char *text,
+            TokenStream &tokens,
+            ParseContext &context,
+            bool need_print=false);
+
+    // lexer pushes tokens on its own thread while they are parsed.
+    // it should stop when push is false, the stream is closed after it returns.
+    // tokens is reset first, so a stream can be reused, and trees of an
+    // earlier call on it are invalid then
+    shared_ptr<Node> generateParseTreePipelined (
+            const char *text,
+            const std::function<void(TokenStream&)> &lexer,
+            TokenStream &tokens,
+            ParseContext &context,
+            bool need_print=false);
+
+    // parse of a document whose top symbol leads through nodes with one child
+    // to a right recursive list, list -> items list | items. tokens are split
+    // before chunk_begins, each chunk is parsed as a document of its own on up
+    // to thread_count threads (0 for all cores), and the lists are joined into
+    // the tree of a sequential parse, lookahead tokens of nodes included.
+    // if a chunk fails, tokens are parsed again sequentially.
+    // is_parallel is set to false then, if not null
+    shared_ptr<Node> generateParseTreeParallel (
+            const char *text,
+            const vector<Token> &tokens,
+            const string &list_name,
+            const vector<int> &chunk_begins,
+            int thread_count=0,
+            bool *is_parallel=null);
+
+    // up to chunk_count-1 begins, spread evenly, at tokens where is_top_level
+    // is true. default is tokens at column 0, like top-level keys of an
+    // indentation-structured document
+    static vector<int> findChunkBegins (
+            const vector<Token> &tokens,
+            int chunk_count,
+            const std::function<bool(const vector<Token>&, int)> &is_top_level=null);
+
+    // glr parse which follows every conflicting action on a graph-structured stack.
+    // runs like generateParseTree while only one stack head is active.
+    // ambiguous nodes have alternatives. fails if heads exceed max_head_count
+    shared_ptr<Node> generateParseForest (
+            const char *text,
+            const vector<Token> &tokens,
+            int max_head_count=1024);
+
+    // self-contained c++ header of a parser class named class_name, one labeled
+    // block per state and a switch on token type in each. empty on error
+    string toCppSource (const string &class_name) const;
+
+    inline bool hasConflicts () const { return conflict_action_map_list_.empty() == false; }
+
     bool saveBinary (vector<unsigned char> &result);
 
+    // tree as post-order records of rule idx or token idx, after the tokens
+    // it points into. nodes must point into tokens. false if the tree is
+    // ambiguous or was not made by this table
+    bool saveTree (const Node &root, const vector<Token> &tokens, vector<unsigned char> &result) const;
+
+    // tree of saveTree, rebuilt in one pass over data.
+    // null if data is broken or was saved with other rules
+    shared_ptr<LoadedTree> loadTree (const unsigned char *data, size_t size) const;
+
+    // hash of rules and terminals, same for tables whose saved trees are interchangeable
+    uint64_t treeKey () const;
+
+    inline int state_count () const { return action_info_map_list_.size(); }
+    inline int rule_count () const { return rules_.size(); }
+
+    // copy whose state order[i] becomes state i. order[0] must be 0.
+    // rows are maps of their own, so only numbering changes, and the order
+    // of state blocks in toCppSource. the rows don't move closer in memory
+    shared_ptr<ParsingTable> renumberStates (const vector<int> &order) const;
+
+    // copy where states that act the same on every symbol, and go to states
+    // that act the same, are one state. parses are unchanged, state 0 stays 0.
+    // before and after are filled if not null
+    shared_ptr<ParsingTable> minimizeStates (TableSize *before=null, TableSize *after=null) const;
+
+    TableSize size () const;
+
+    // same rules and same actions for every state reachable from entry states,
+    // regardless of state numbering. symbols are matched by name
+    bool isEquivalent (const ParsingTable &other) const;
+
 private:
     vector<shared_ptr<Nonterminal>> symbols_;
     shared_ptr<Nonterminal> start_symbol_;
     map<int, shared_ptr<Terminal>> terminal_map_; // token_type -> terminal
 	vector<const Rule*> rules_;
 	vector<map<shared_ptr<TerminalBase>, ActionInfo>> action_info_map_list_;
+	vector<map<shared_ptr<TerminalBase>, vector<ActionInfo>>> conflict_action_map_list_; // empty if no conflicts
+	vector<int> entry_states_;	// start state by start_symbol rule idx
+
+	template <class Tokens, class Stats>
+	shared_ptr<Node> _generateParseTree (
+			const char *text,
+			const Tokens &tokens,
+			ParseContext &context,
+			Stats &stats,
+			bool need_print,
+			int start_state=0);
+
+	// empty table after a failed load
+	void _clearLoaded (const string &reason);
+
+	void _getActions (int state_idx, const shared_ptr<TerminalBase> &term, vector<ActionInfo> &result);
 
 };
 
@@ -0,0 +1,284 @@
+#include "parse_table.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <sstream>
+
+#include "defines.h"
+
+
+namespace parse_table {
+
+using std::cout;
+using std::endl;
+using std::dynamic_pointer_cast;
+using std::stringstream;
+
+
+static string _cppString (const string &value) {
+    string result = "\"";
+    for (auto c : value) {
+        if (c == '\"' || c == '\\')
+            result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+static bool _isIdentifier (const string &name) {
+    if (name.empty() == true || isdigit((unsigned char)name[0]))
+        return false;
+    return std::all_of(name.begin(), name.end(), [](char c) {
+        return isalnum((unsigned char)c) || c == '_';
+    });
+}
+
+// token type of an action key. the end terminal is kept as null
+static int _tokenType (const shared_ptr<TerminalBase> &term) {
+    if (term == null)
+        return 0;
+    return dynamic_pointer_cast<Terminal>(term)->token_type;
+}
+
+string ParsingTable::toCppSource (const string &class_name) const {
+    if (_isIdentifier(class_name) == false) {
+        // TODO err: {class_name} is not an identifier
+        cout << "err: \'" << class_name << "\' is not an identifier" << endl;
+        return "";
+    }
+    if (action_info_map_list_.empty() == true) {
+        cout << "err: table has no states" << endl;
+        return "";
+    }
+
+    // nonterminal idxs, in rule order
+    vector<shared_ptr<Nonterminal>> nons;
+    map<const TerminalBase*, int> non_idx_map;
+    auto add_non = [&](const shared_ptr<Nonterminal> &non) {
+        if (non == null || non_idx_map.count(non.get()) > 0)
+            return;
+        non_idx_map[non.get()] = nons.size();
+        nons.push_back(non);
+    };
+    add_non(start_symbol_);
+    for (auto &non : symbols_)
+        add_non(non);
+    for (auto &rule : rules_)
+        add_non(rule->left_side);
+
+    // actions per state by token type, gotos per nonterminal by state
+    int state_count = action_info_map_list_.size();
+    vector<map<int, ActionInfo>> term_actions(state_count);
+    vector<map<int, int>> gotos(nons.size());
+    set<int> reduced_rules;
+    for (int si=0; si<state_count; ++si) {
+        for (auto &[termnon, info] : action_info_map_list_[si]) {
+            if (info.action == ActionInfo::GOTO) {
+                auto itr = non_idx_map.find(termnon.get());
+                if (itr == non_idx_map.end()) {
+                    cout << "err: goto on unknown symbol \'" << termnon->name << "\'" << endl;
+                    return "";
+                }
+                gotos[itr->second][si] = info.idx;
+                continue;
+            }
+            if (info.action == ActionInfo::NONE)
+                continue;
+            if (info.action == ActionInfo::REDUCE)
+                reduced_rules.insert(info.idx);
+            term_actions[si][_tokenType(termnon)] = info;
+        }
+    }
+
+    int terminal_size = 1;
+    if (terminal_map_.empty() == false)
+        terminal_size = std::max(1, terminal_map_.rbegin()->first + 1);
+
+    string upper_name = class_name;
+    for (auto &c : upper_name)
+        c = toupper((unsigned char)c);
+
+    stringstream ss;
+    ss << "// generated by parse_table::ParsingTable::toCppSource, do not edit.\n"
+       << "// " << state_count << " states, " << rules_.size() << " rules\n"
+       << "#ifndef " << upper_name << "_GENERATED_PARSER\n"
+       << "#define " << upper_name << "_GENERATED_PARSER\n"
+       << "\n"
+       << "#include <iostream>\n"
+       << "#include <memory>\n"
+       << "#include <vector>\n"
+       << "\n"
+       << "#include \"node.h\"\n"
+       << "#include \"token.h\"\n"
+       << "\n"
+       << "\n"
+       << "// same trees as ParsingTable::generateParseTree, with own symbols.\n"
+       << "// conflicting actions are not followed\n"
+       << "class " << class_name << " {\n"
+       << "public:\n"
+       << "    static constexpr int STATE_COUNT = " << state_count << ";\n"
+       << "    static constexpr int RULE_COUNT = " << rules_.size() << ";\n"
+       << "\n"
+       << "    " << class_name << " () {\n"
+       << "        terminals_.resize(" << terminal_size << ");\n";
+    for (auto &[token_type, term] : terminal_map_) {
+        if (term == null)
+            continue;
+        ss << "        terminals_[" << token_type << "] = std::make_shared<parse_table::Terminal>("
+           << _cppString(term->name) << ", " << token_type << ");\n";
+    }
+    for (auto &non : nons)
+        ss << "        nonterminals_.push_back(std::make_shared<parse_table::Nonterminal>(" << _cppString(non->name) << "));\n";
+    ss << "    }\n"
+       << "\n"
+       << "    inline const std::shared_ptr<parse_table::TerminalBase>& terminal (int token_type) const { return terminals_[token_type]; }\n"
+       << "    inline const std::shared_ptr<parse_table::TerminalBase>& nonterminal (int idx) const { return nonterminals_[idx]; }\n"
+       << "\n"
+       << "    // null if tokens cannot be parsed\n"
+       << "    std::shared_ptr<parse_table::Node> parse (const std::vector<parse_table::Token> &tokens) {\n"
+       << "        int token_count = tokens.size();\n"
+       << "        int ti = 0;\n"
+       << "        int state = 0;\n"
+       << "        int type = 0;\n"
+       << "        stack_.clear();\n"
+       << "        stack_.push_back(StackItem{ 0, nullptr });\n"
+       << "\n"
+       << "#if defined(__GNUC__) || defined(__clang__)\n"
+       << "        // computed goto, one indirect jump per state\n"
+       << "        static void *const state_labels[] = {";
+    for (int si=0; si<state_count; ++si)
+        ss << ((si % 8 == 0)? "\n            ": " ") << "&&state_" << si << ",";
+    ss << "\n        };\n"
+       << "#define " << upper_name << "_DISPATCH() goto *state_labels[state]\n"
+       << "#else\n"
+       << "#define " << upper_name << "_DISPATCH() goto dispatch\n"
+       << "    dispatch:\n"
+       << "        switch (state) {\n";
+    for (int si=0; si<state_count; ++si)
+        ss << "            case " << si << ": goto state_" << si << ";\n";
+    ss << "            default: goto error;\n"
+       << "        }\n"
+       << "#endif\n"
+       << "        goto state_0;\n";
+
+    // states
+    for (int si=0; si<state_count; ++si) {
+        ss << "\n"
+           << "    state_" << si << ":\n"
+           << "        if (ti >= token_count) {\n"
+           << "            state = " << si << ";\n"
+           << "            goto error;\n"
+           << "        }\n"
+           << "        type = tokens[ti].type;\n"
+           << "        switch (type) {\n";
+
+        // cases with the same action share one body
+        vector<std::pair<ActionInfo, vector<int>>> groups;
+        for (auto &[token_type, info] : term_actions[si]) {
+            auto itr = std::find_if(groups.begin(), groups.end(), [&info](auto &g) {
+                return g.first.action == info.action && g.first.idx == info.idx;
+            });
+            if (itr == groups.end())
+                groups.push_back({ info, { token_type } });
+            else
+                itr->second.push_back(token_type);
+        }
+
+        for (auto &[info, token_types] : groups) {
+            for (auto token_type : token_types)
+                ss << "            case " << token_type << ":\n";
+            switch (info.action) {
+                case ActionInfo::SHIFT:
+                    ss << "                stack_.push_back(StackItem{ " << info.idx
+                       << ", std::make_shared<parse_table::Node>(terminals_[type], &tokens[ti]) });\n"
+                       << "                ++ti;\n"
+                       << "                goto state_" << info.idx << ";\n";
+                    break;
+                case ActionInfo::REDUCE:
+                    ss << "                goto reduce_" << info.idx << ";\n";
+                    break;
+                case ActionInfo::ACCEPT:
+                    ss << "                goto accept;\n";
+                    break;
+                default:
+                    break;
+            }
+        }
+        ss << "            default:\n"
+           << "                state = " << si << ";\n"
+           << "                goto error;\n"
+           << "        }\n";
+    }
+
+    // reduces, with rule lengths known
+    for (auto ri : reduced_rules) {
+        auto rule = rules_[ri];
+        int length = rule->right_side.size();
+        ss << "\n"
+           << "    reduce_" << ri << ":    // " << rule->toString() << "\n"
+           << "        {\n"
+           << "            auto node = std::make_shared<parse_table::Node>(nonterminals_["
+           << non_idx_map[rule->left_side.get()] << "], &tokens[ti]);\n"
+           << "            node->reduced_rule_idx(" << ri << ");\n";
+        if (length > 0) {
+            ss << "            auto base = stack_.size() - " << length << ";\n";
+            for (int i=0; i<length; ++i)
+                ss << "            node->addChild(stack_[base + " << i << "].node);\n";
+            ss << "            stack_.resize(base);\n";
+        }
+        ss << "            state = _goto" << non_idx_map[rule->left_side.get()] << "(stack_.back().state);\n"
+           << "            if (state < 0)\n"
+           << "                goto error;\n"
+           << "            stack_.push_back(StackItem{ state, std::move(node) });\n"
+           << "        }\n"
+           << "        " << upper_name << "_DISPATCH();\n";
+    }
+
+    ss << "\n"
+       << "    accept:\n"
+       << "        {\n"
+       << "            auto result = stack_.back().node;\n"
+       << "            stack_.clear();\n"
+       << "            return result;\n"
+       << "        }\n"
+       << "\n"
+       << "    error:\n"
+       << "        // TODO err: cannot be parsed on {ti}\n"
+       << "        std::cout << \"err: cannot be parsed, token \" << ti << \" State \" << state << std::endl;\n"
+       << "        stack_.clear();\n"
+       << "        return nullptr;\n"
+       << "#undef " << upper_name << "_DISPATCH\n"
+       << "    }\n"
+       << "\n"
+       << "private:\n"
+       << "    class StackItem {\n"
+       << "    public:\n"
+       << "        int state;\n"
+       << "        std::shared_ptr<parse_table::Node> node;\n"
+       << "    };\n"
+       << "\n"
+       << "    std::vector<std::shared_ptr<parse_table::TerminalBase>> terminals_;   // by token type\n"
+       << "    std::vector<std::shared_ptr<parse_table::TerminalBase>> nonterminals_;\n"
+       << "    std::vector<StackItem> stack_;\n";
+
+    // gotos, -1 if state has none
+    for (int ni=0; ni<nons.size(); ++ni) {
+        ss << "\n"
+           << "    // " << nons[ni]->name << "\n"
+           << "    static int _goto" << ni << " (int state) {\n"
+           << "        switch (state) {\n";
+        for (auto &[from, to] : gotos[ni])
+            ss << "            case " << from << ": return " << to << ";\n";
+        ss << "            default: return -1;\n"
+           << "        }\n"
+           << "    }\n";
+    }
+
+    ss << "};\n"
+       << "\n"
+       << "#endif\n";
+    return ss.str();
+}
+
+}
@@ -0,0 +1,159 @@
+#include "./parse_tree_cache.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(_WINDOWS) || defined(_WIN32)
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace parse_table {
+
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::make_shared;
+
+
+// tree key, text hash, text size, tree size
+static const CacheFileFormat CACHE_FORMAT("PTRC", 2, 4);
+
+// whole file, mapped where possible, else read
+class MappedFile {
+public:
+	const unsigned char *data = null;
+	size_t size = 0;
+
+	MappedFile (const string &path) {
+#if defined(_WINDOWS) || defined(_WIN32)
+		ifstream is(path, std::ifstream::binary);
+		if (is.is_open() == false)
+			return;
+		buffer_.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+		data = buffer_.data();
+		size = buffer_.size();
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			auto mapped = mmap(null, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped != MAP_FAILED) {
+				data = (const unsigned char*)mapped;
+				size = st.st_size;
+			}
+		}
+		close(fd);
+#endif
+	}
+
+	~MappedFile () {
+#if defined(_WINDOWS) || defined(_WIN32)
+#else
+		if (data != null)
+			munmap((void*)data, size);
+#endif
+	}
+
+	MappedFile (const MappedFile&) = delete;
+	MappedFile& operator= (const MappedFile&) = delete;
+
+private:
+#if defined(_WINDOWS) || defined(_WIN32)
+	vector<unsigned char> buffer_;
+#endif
+};
+
+
+ParseTreeCache::ParseTreeCache (const shared_ptr<ParsingTable> &table)
+:table_(table),
+ tree_key_(table->treeKey()),
+ hit_count_(0),
+ miss_count_(0) {
+}
+
+string ParseTreeCache::path (const string &source_path) {
+	return source_path + ".ptree";
+}
+
+uint64_t ParseTreeCache::hashText (const char *text, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	size_t bi = 0;
+	for (; bi + 8 <= size; bi += 8) {
+		uint64_t word;
+		memcpy(&word, text + bi, 8);
+		hash = (hash ^ word) * 1099511628211ull;
+		hash ^= hash >> 29;
+	}
+	for (; bi<size; ++bi)
+		hash = (hash ^ (unsigned char)text[bi]) * 1099511628211ull;
+	return hash;
+}
+
+shared_ptr<LoadedTree> ParseTreeCache::generateParseTree (
+		const string &source_path,
+		const string &text,
+		const std::function<bool(const string&, vector<Token>&)> &lex) {
+	auto tree = load(source_path, text.c_str(), text.size());
+	if (tree != null) {
+		++hit_count_;
+		return tree;
+	}
+
+	++miss_count_;
+	tree = make_shared<LoadedTree>();
+	if (lex(text, tree->tokens) == false)
+		return null;
+	tree->root = table_->generateParseTree(text.c_str(), tree->tokens);
+	if (tree->root == null)
+		return null;
+	store(source_path, text.c_str(), text.size(), *tree->root, tree->tokens);
+	return tree;
+}
+
+shared_ptr<LoadedTree> ParseTreeCache::load (const string &source_path, const char *text, size_t size) {
+	MappedFile file(path(source_path));
+
+	// a changed source or grammar is a miss, not an error
+	auto fields = CACHE_FORMAT.readFields(file.data, file.size);
+	if (fields.empty() == true
+			|| fields[0] != tree_key_
+			|| fields[2] != size
+			|| fields[1] != hashText(text, size))
+		return null;
+
+	auto header_size = CACHE_FORMAT.headerSize();
+	if (fields[3] != file.size - header_size) {
+		// TODO err: cached tree {path} is broken
+		cout << "err: cached tree \'" << path(source_path) << "\' is broken, parsing again" << endl;
+		return null;
+	}
+	return table_->loadTree(file.data + header_size, fields[3]);
+}
+
+bool ParseTreeCache::store (
+		const string &source_path,
+		const char *text,
+		size_t size,
+		const Node &root,
+		const vector<Token> &tokens) {
+	vector<unsigned char> tree_data;
+	if (table_->saveTree(root, tokens, tree_data) == false)
+		return false;
+
+	auto data = CACHE_FORMAT.make({
+			tree_key_,
+			hashText(text, size),
+			size,
+			tree_data.size() }, tree_data.data(), tree_data.size());
+	return CacheFileFormat::write(path(source_path), data, "cached tree");
+}
+
+}
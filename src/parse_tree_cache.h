@@ -0,0 +1,66 @@
+#ifndef PAW_PRINT_PARSE_TREE_CACHE
+#define PAW_PRINT_PARSE_TREE_CACHE
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./cache_file.h"
+#include "./parse_table.h"
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+
+// saved trees next to their sources, as <source path>.ptree. a file has a
+// header with the tree key of the table and the hash and size of the source
+// text, and is used only if all match, so a hit skips lexing and parsing and
+// a changed grammar is a quiet miss. files are read through a memory map and
+// written to a temp name and renamed
+class PAW_PRINT_API ParseTreeCache {
+public:
+	PAW_GETTER(int, hit_count)
+	PAW_GETTER(int, miss_count)
+
+	ParseTreeCache (const shared_ptr<ParsingTable> &table);
+
+	// tree of text from the cache, else parsed from the tokens of lex and stored.
+	// lex returns false if text cannot be lexed
+	shared_ptr<LoadedTree> generateParseTree (
+			const string &source_path,
+			const string &text,
+			const std::function<bool(const string&, vector<Token>&)> &lex);
+
+	// null if there is no valid file for text
+	shared_ptr<LoadedTree> load (const string &source_path, const char *text, size_t size);
+	bool store (
+			const string &source_path,
+			const char *text,
+			size_t size,
+			const Node &root,
+			const vector<Token> &tokens);
+
+	static string path (const string &source_path);
+
+	// 8 bytes per step, content key rather than a checksum
+	static uint64_t hashText (const char *text, size_t size);
+
+private:
+	shared_ptr<ParsingTable> table_;
+	uint64_t tree_key_;
+	int hit_count_;
+	int miss_count_;
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
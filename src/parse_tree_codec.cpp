@@ -0,0 +1,281 @@
+#include "parse_table.h"
+
+#include <iostream>
+
+#include "defines.h"
+
+
+namespace parse_table {
+
+using std::cout;
+using std::endl;
+using std::make_shared;
+using std::to_string;
+
+
+// tree key, token count, tokens, node count, nodes in post order
+// tokens:  type, first_idx - previous last_idx - 1, length, line delta, column, indent
+// nodes:   0, token idx - next leaf idx                       for leaves
+//          rule idx + 1, token idx - next leaf idx + 1 or 0    for reduced nodes
+// signed values are zigzag encoded. all but key and node count are varints.
+// children are the rule's right side, so child counts and symbols aren't stored
+static const int TREE_KEY_SIZE = 8;
+static const int NODE_COUNT_SIZE = 4;
+
+static void _pushVarint (vector<unsigned char> &buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((unsigned char)value);
+}
+
+// small negative values stay small
+static inline uint64_t _zigzag (int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t _unzigzag (uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void _pushSigned (vector<unsigned char> &buffer, int64_t value) {
+    _pushVarint(buffer, _zigzag(value));
+}
+
+class TreeReader {
+public:
+    const unsigned char *p;
+    const unsigned char *end;
+    bool is_broken = false;
+
+    uint64_t varint () {
+        uint64_t value = 0;
+        for (int shift=0; shift<64; shift+=7) {
+            if (p >= end)
+                break;
+            auto byte = *p++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        is_broken = true;
+        return 0;
+    }
+
+    inline int64_t signedVarint () { return _unzigzag(varint()); }
+};
+
+static shared_ptr<LoadedTree> _brokenTree () {
+    // TODO err: saved tree is broken
+    cout << "err: saved tree is broken" << endl;
+    return null;
+}
+
+
+uint64_t ParsingTable::treeKey () const {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const string &str) {
+        for (auto c : str + '\0') {
+            hash ^= (unsigned char)c;
+            hash *= 1099511628211ull;
+        }
+    };
+    for (auto &[token_type, term] : terminal_map_) {
+        if (term != null)
+            add(to_string(token_type) + term->name);
+    }
+    for (auto rule : rules_)
+        add(rule->toString());
+    return hash;
+}
+
+bool ParsingTable::saveTree (const Node &root, const vector<Token> &tokens, vector<unsigned char> &result) const {
+    result.clear();
+    auto key = treeKey();
+    for (int bi=0; bi<TREE_KEY_SIZE; ++bi)
+        result.push_back((unsigned char)(key >> (bi * 8)));
+
+    _pushVarint(result, tokens.size());
+    int last_idx = -1;
+    unsigned int line = 0;
+    for (auto &t : tokens) {
+        _pushVarint(result, t.type);
+        _pushSigned(result, (int64_t)t.first_idx - last_idx - 1);
+        _pushSigned(result, (int64_t)t.last_idx + 1 - t.first_idx);
+        _pushSigned(result, (int64_t)t.line - line);
+        _pushVarint(result, t.column);
+        _pushVarint(result, t.indent);
+        last_idx = t.last_idx;
+        line = t.line;
+    }
+
+    auto token_idx = [&tokens](const Node &node) -> int64_t {
+        auto token = node.token();
+        if (token == null || token < tokens.data() || token >= tokens.data() + tokens.size())
+            return -1;
+        return token - tokens.data();
+    };
+
+    // node count, patched in after the walk
+    auto count_pos = result.size();
+    result.resize(count_pos + NODE_COUNT_SIZE);
+
+    int node_count = 0;
+    int leaf_count = 0;
+    bool is_valid = true;
+    NodeWalker walker;
+    walker.walk(root, [&](const Node &node, int) {
+        return is_valid;
+    }, [&](const Node &node, int) {
+        if (is_valid == false)
+            return;
+        ++node_count;
+        if (node.isAmbiguous() == true) {
+            // TODO err: ambiguous {node} cannot be saved
+            cout << "err: ambiguous node \'" << node.termnon()->name << "\' cannot be saved" << endl;
+            is_valid = false;
+            return;
+        }
+
+        if (node.termnon() != null && node.termnon()->isTerminal() == true) {
+            auto idx = token_idx(node);
+            if (idx < 0) {
+                // TODO err: token of {node} is not in tokens
+                cout << "err: token of \'" << node.termnon()->name << "\' is not in tokens" << endl;
+                is_valid = false;
+                return;
+            }
+            _pushVarint(result, 0);
+            _pushSigned(result, idx - leaf_count);
+            leaf_count = idx + 1;
+            return;
+        }
+
+        auto ri = node.reduced_rule_idx();
+        if (ri < 0 || ri >= rules_.size()
+                || rules_[ri]->left_side != node.termnon()
+                || rules_[ri]->right_side.size() != node.children().size()) {
+            // TODO err: {node} is not reduced by a rule of this table
+            cout << "err: node \'" << ((node.termnon() == null)? "": node.termnon()->name)
+                 << "\' is not reduced by a rule of this table" << endl;
+            is_valid = false;
+            return;
+        }
+        _pushVarint(result, ri + 1);
+        auto idx = token_idx(node);
+        _pushVarint(result, (idx < 0)? 0: _zigzag(idx - leaf_count) + 1);
+    });
+
+    if (is_valid == false) {
+        result.clear();
+        return false;
+    }
+    for (int bi=0; bi<NODE_COUNT_SIZE; ++bi)
+        result[count_pos + bi] = (unsigned char)(node_count >> (bi * 8));
+    return true;
+}
+
+shared_ptr<LoadedTree> ParsingTable::loadTree (const unsigned char *data, size_t size) const {
+    if (size < TREE_KEY_SIZE)
+        return null;
+    uint64_t key = 0;
+    for (int bi=0; bi<TREE_KEY_SIZE; ++bi)
+        key |= (uint64_t)data[bi] << (bi * 8);
+    if (key != treeKey()) {
+        // TODO err: tree was saved with other rules
+        cout << "err: tree was saved with other rules" << endl;
+        return null;
+    }
+
+    TreeReader reader{ data + TREE_KEY_SIZE, data + size };
+    auto result = make_shared<LoadedTree>();
+    auto &tokens = result->tokens;
+
+    // every token takes at least 6 bytes
+    auto token_count = reader.varint();
+    if (token_count > (size_t)(reader.end - reader.p) / 6)
+        return _brokenTree();
+    tokens.reserve(token_count);
+    int64_t last_idx = -1;
+    int64_t line = 0;
+    for (uint64_t ti=0; ti<token_count; ++ti) {
+        auto type = reader.varint();
+        auto first_idx = last_idx + 1 + reader.signedVarint();
+        last_idx = first_idx + reader.signedVarint() - 1;
+        line += reader.signedVarint();
+        auto column = reader.varint();
+        auto indent = reader.varint();
+        tokens.push_back(Token(type, first_idx, last_idx, indent, column, line));
+    }
+    if (reader.is_broken == true)
+        return _brokenTree();
+
+    if (reader.end - reader.p < NODE_COUNT_SIZE)
+        return _brokenTree();
+    uint64_t node_count = 0;
+    for (int bi=0; bi<NODE_COUNT_SIZE; ++bi)
+        node_count |= (uint64_t)*reader.p++ << (bi * 8);
+
+    // every node takes at least 2 bytes
+    if (node_count > (size_t)(reader.end - reader.p) / 2)
+        return _brokenTree();
+
+    // nodes are one block that never moves, and point to each other and
+    // into tokens without owning. the block frees them without recursion
+    auto &nodes = result->nodes;
+    nodes.reserve(node_count);
+    vector<Node*> stack;
+    int64_t leaf_count = 0;
+    auto alias = [](Node *node) { return shared_ptr<Node>(shared_ptr<Node>(), node); };
+    while (reader.p < reader.end) {
+        if (nodes.size() == node_count)
+            return _brokenTree();
+
+        auto tag = reader.varint();
+        if (tag == 0) {
+            auto idx = leaf_count + reader.signedVarint();
+            if (reader.is_broken == true || idx < 0 || idx >= tokens.size())
+                return _brokenTree();
+            auto term_itr = terminal_map_.find(tokens[idx].type);
+            if (term_itr == terminal_map_.end() || term_itr->second == null)
+                return _brokenTree();
+            nodes.emplace_back(term_itr->second, &tokens[idx]);
+            stack.push_back(&nodes.back());
+            leaf_count = idx + 1;
+            continue;
+        }
+
+        auto ri = tag - 1;
+        auto lookahead = reader.varint();
+        if (reader.is_broken == true || ri >= rules_.size())
+            return _brokenTree();
+        const Token *token = null;
+        if (lookahead > 0) {
+            auto idx = leaf_count + _unzigzag(lookahead - 1);
+            if (idx < 0 || idx >= tokens.size())
+                return _brokenTree();
+            token = &tokens[idx];
+        }
+
+        auto rule = rules_[ri];
+        auto length = rule->right_side.size();
+        if (stack.size() < length)
+            return _brokenTree();
+        auto &node = nodes.emplace_back(rule->left_side, token);
+        node.reduced_rule_idx(ri);
+        node.reserveChildren(length);
+        auto base = stack.size() - length;
+        for (auto ci=base; ci<stack.size(); ++ci)
+            node.addChild(alias(stack[ci]));
+        stack.resize(base);
+        stack.push_back(&node);
+    }
+
+    if (stack.size() != 1)
+        return _brokenTree();
+    result->root = alias(stack.back());
+    return result;
+}
+
+}
@@ -0,0 +1,104 @@
+#include "./parsing_table_cache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+namespace parse_table {
+
+namespace fs = std::filesystem;
+
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::make_shared;
+using std::stringstream;
+
+
+// fingerprint, table size, table hash
+static const CacheFileFormat CACHE_FORMAT("PTBC", 1, 3);
+
+static uint64_t _hashBytes (const unsigned char *data, size_t size) {
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t bi=0; bi<size; ++bi) {
+		hash ^= data[bi];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+
+ParsingTableCache::ParsingTableCache (const string &directory)
+:directory_(directory),
+ hit_count_(0),
+ miss_count_(0) {
+}
+
+string ParsingTableCache::path (uint64_t fingerprint) const {
+	stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << fingerprint << ".ptbl";
+	return (fs::path(directory_) / ss.str()).string();
+}
+
+shared_ptr<ParsingTable> ParsingTableCache::generateTable (ParsingTableGenerator &generator) {
+	auto fingerprint = generator.fingerprint();
+
+	auto table = load(fingerprint);
+	if (table != null && table->rule_count() == generator.rule_count()) {
+		++hit_count_;
+		return table;
+	}
+
+	++miss_count_;
+	table = generator.generateTable();
+	if (table != null)
+		store(fingerprint, *table);
+	return table;
+}
+
+shared_ptr<ParsingTable> ParsingTableCache::load (uint64_t fingerprint) {
+	ifstream is(path(fingerprint), std::ifstream::binary);
+	if (is.is_open() == false)
+		return null;
+
+	vector<unsigned char> data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	auto header_size = CACHE_FORMAT.headerSize();
+	if (data.size() < header_size)
+		return null;
+
+	auto fields = CACHE_FORMAT.readFields(data.data(), data.size());
+	if (fields.empty() == true
+			|| fields[0] != fingerprint
+			|| fields[1] != data.size() - header_size
+			|| fields[2] != _hashBytes(data.data() + header_size, fields[1])) {
+		// TODO err: cached table {path} is broken
+		cout << "err: cached table \'" << path(fingerprint) << "\' is broken, regenerating" << endl;
+		return null;
+	}
+
+	vector<unsigned char> table_data(data.begin() + header_size, data.end());
+	auto table = make_shared<ParsingTable>(table_data);
+	if (table->state_count() == 0)
+		return null;
+	return table;
+}
+
+bool ParsingTableCache::store (uint64_t fingerprint, ParsingTable &table) {
+	vector<unsigned char> table_data;
+	if (table.saveBinary(table_data) == false)
+		return false;
+
+	auto data = CACHE_FORMAT.make({
+			fingerprint,
+			table_data.size(),
+			_hashBytes(table_data.data(), table_data.size()) }, table_data.data(), table_data.size());
+
+	std::error_code ec;
+	fs::create_directories(directory_, ec);
+	return CacheFileFormat::write(path(fingerprint), data, "cached table");
+}
+
+}
@@ -0,0 +1,54 @@
+#ifndef PAW_PRINT_PARSING_TABLE_CACHE
+#define PAW_PRINT_PARSING_TABLE_CACHE
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./cache_file.h"
+#include "./parse_table.h"
+#include "./parsing_table_generator.h"
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+
+// saved tables in a directory, one file per grammar fingerprint.
+// a file has a header with the fingerprint, size and hash of the table,
+// and is used only if all of them match. files are written to a temp name
+// and renamed, so a reader never sees half of one
+class PAW_PRINT_API ParsingTableCache {
+public:
+	PAW_GETTER(const string&, directory)
+	PAW_GETTER(int, hit_count)
+	PAW_GETTER(int, miss_count)
+
+	ParsingTableCache (const string &directory);
+
+	// table of the grammar of generator from the cache,
+	// else generated by it and stored
+	shared_ptr<ParsingTable> generateTable (ParsingTableGenerator &generator);
+
+	// null if there is no valid file for fingerprint
+	shared_ptr<ParsingTable> load (uint64_t fingerprint);
+	bool store (uint64_t fingerprint, ParsingTable &table);
+
+	string path (uint64_t fingerprint) const;
+
+private:
+	string directory_;
+	int hit_count_;
+	int miss_count_;
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
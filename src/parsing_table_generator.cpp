@@ -1,10 +1,21 @@
 #include "./parsing_table_generator.h"
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 
+#if defined(_WINDOWS) || defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX	// std::min and std::max are called here
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 
 namespace parse_table {
 
@@ -19,7 +30,71 @@ using std::stringstream;
 using std::to_string;
 
 
-ParsingTableGenerator::ParsingTableGenerator () {
+using Clock = std::chrono::steady_clock;
+
+static double _ms (Clock::time_point begin, Clock::time_point end) {
+	return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+
+GenerationStats::GenerationStats ()
+:first_ms(0),
+ closure_ms(0),
+ discovery_ms(0),
+ merge_ms(0),
+ table_ms(0),
+ total_ms(0),
+ lr1_state_count(0),
+ lalr_state_count(0),
+ minimal_state_count(-1),
+ state_count(0),
+ conflict_count(0),
+ config_count(0),
+ lookahead_union_count(0),
+ peak_rss_kb(-1) {
+}
+
+string GenerationStats::toString () const {
+	stringstream ss;
+	ss << "first: " << first_ms << "ms, "
+			<< "closure: " << closure_ms << "ms, "
+			<< "discovery: " << discovery_ms << "ms, "
+			<< "merge: " << merge_ms << "ms, "
+			<< "table: " << table_ms << "ms, "
+			<< "total: " << total_ms << "ms" << endl;
+	ss << "lr1 states: " << lr1_state_count
+			<< ", lalr states: " << lalr_state_count
+			<< ", minimal lr states: " << minimal_state_count
+			<< ", states: " << state_count
+			<< ", conflicts: " << conflict_count
+			<< ", configs: " << config_count
+			<< ", lookahead unions: " << lookahead_union_count
+			<< ", peak rss: " << peak_rss_kb << "KB" << endl;
+	return ss.str();
+}
+
+long GenerationStats::peakRssKB () {
+#if defined(_WINDOWS) || defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS pmc;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) == false)
+		return -1;
+	return pmc.PeakWorkingSetSize / 1024;
+#else
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+	return usage.ru_maxrss;	// KB on linux
+#endif
+}
+
+
+ParsingTableGenerator::ParsingTableGenerator ()
+:lr_mode_(LALR) {
+}
+
+void ParsingTableGenerator::_progress (const string &phase, int done, int total) {
+	if (progress_func_)
+		progress_func_(phase, done, total);
 }
 
 void ParsingTableGenerator::addSymbol(const shared_ptr<Nonterminal> &non, bool is_start_symbol/*=false*/) {
@@ -29,202 +104,473 @@ void ParsingTableGenerator::addSymbol(const shared_ptr<Nonterminal> &non, bool i
 		start_symbol_ = non;
 }
 
-static void _makeNextTransitionInfoMap (
-		const vector<shared_ptr<Configuration>> &configs,
-		map<shared_ptr<TerminalBase>, vector<shared_ptr<Configuration>>> &result) {
+void ParsingTableGenerator::addEntrySymbol (const shared_ptr<Nonterminal> &non) {
+	if (std::find(entry_symbols_.begin(), entry_symbols_.end(), non) == entry_symbols_.end())
+		entry_symbols_.push_back(non);
+}
 
-	for (auto &c : configs) {
-		if (c->idx_after_cursor() >= c->rule().right_side.size())
-			continue;
+// fnv-1a over a canonical byte stream of the grammar
+class FingerprintHash {
+public:
+	uint64_t value = 14695981039346656037ull;
 
-		auto &termnon = c->rule().right_side[c->idx_after_cursor()];
+	void add (const void *data, size_t size) {
+		auto bytes = (const unsigned char*)data;
+		for (size_t bi=0; bi<size; ++bi) {
+			value ^= bytes[bi];
+			value *= 1099511628211ull;
+		}
+	}
+
+	// little endian, so same on every machine
+	void add (int64_t number) {
+		unsigned char bytes[8];
+		for (int bi=0; bi<8; ++bi)
+			bytes[bi] = (unsigned char)((uint64_t)number >> (bi * 8));
+		add(bytes, 8);
+	}
+
+	// length first, so names can't run into each other
+	void add (const string &str) {
+		add((int64_t)str.size());
+		add(str.data(), str.size());
+	}
+};
+
+uint64_t ParsingTableGenerator::fingerprint () const {
+	// bump when generated tables change for same grammar
+	static const int GENERATOR_VERSION = 1;
+
+	FingerprintHash hash;
+	hash.add(GENERATOR_VERSION);
+	hash.add(lr_mode_);
+	hash.add((start_symbol_ == null)? string(): start_symbol_->name);
+
+	hash.add((int64_t)symbols_.size());
+	for (auto &non : symbols_) {
+		hash.add(non->name);
+		hash.add((int64_t)non->rules.size());
+		for (auto &rule : non->rules) {
+			hash.add((int64_t)rule.right_side.size());
+			for (auto &termnon : rule.right_side) {
+				if (termnon->isTerminal() == true) {
+					hash.add('T');
+					hash.add(std::static_pointer_cast<Terminal>(termnon)->token_type);
+				}else {
+					hash.add('N');
+				}
+				hash.add(termnon->name);
+			}
+		}
+	}
 
-		result[termnon].push_back(
-				make_shared<Configuration>(
-					c->left_side(),
-					c->rule(),
-					c->idx_after_cursor() + 1,
-					c->lookahead()));
+	// grammars without entries keep their fingerprints
+	if (entry_symbols_.empty() == false) {
+		hash.add((int64_t)entry_symbols_.size());
+		for (auto &non : entry_symbols_)
+			hash.add(non->name);
 	}
+	return hash.value;
+}
+
+int ParsingTableGenerator::rule_count () const {
+	int count = 1 + entry_symbols_.size();
+	if (std::find(entry_symbols_.begin(), entry_symbols_.end(), start_symbol_) != entry_symbols_.end())
+		--count;
+	for (auto &non : symbols_)
+		count += non->rules.size();
+	return count;
 }
 
-static bool _areConfigsEqual (
-        const shared_ptr<Configuration> &config,
-        const shared_ptr<Configuration> &other,
-        bool need_check_lookahead) {
+// first(symbol) for every symbol as lookahead id
+static void _makeFirstIds (
+		const GrammarIndex &grammar,
+		LookaheadStore &lookaheads,
+		vector<int> &first_ids) {
 
-    if (config->left_side()              != other->left_side()             ||
-        config->idx_after_cursor()       != other->idx_after_cursor()      ||
-        config->rule().right_side.size() != other->rule().right_side.size())
-        return false;
+	first_ids.assign(grammar.symbol_count(), -1);
 
-    if (need_check_lookahead == true && config->lookahead() != other->lookahead())
-        return false;
+	vector<int> terms;
+	vector<char> is_visited(grammar.symbol_count());
+	vector<int> stack;
+	for (int si = 0; si < grammar.symbol_count(); ++si) {
+		if (grammar.isTerminal(si) == true) {
+			first_ids[si] = lookaheads.single(si);
+			continue;
+		}
 
-    auto &config_r = config->rule();
-    auto &other_r  = other->rule();
-    for (int ri = 0; ri < config_r.right_side.size(); ++ri) {
-        if (config_r.right_side[ri] != other_r.right_side[ri])
-            return false;
-    }
+		// walk first symbols of rules. history prevents infinity loop
+		terms.clear();
+		std::fill(is_visited.begin(), is_visited.end(), false);
+		stack.assign(1, si);
+		is_visited[si] = true;
+		while (stack.empty() == false) {
+			auto non = stack.back();
+			stack.pop_back();
+			for (auto rule_id : grammar.rulesOf(non)) {
+				if (grammar.ruleSize(rule_id) == 0)
+					continue;
 
-    return true;
+				auto first = grammar.ruleSymbol(rule_id, 0);
+				if (grammar.isTerminal(first) == true) {
+					terms.push_back(first);
+				}else if (is_visited[first] == false) {
+					is_visited[first] = true;
+					stack.push_back(first);
+				}
+			}
+		}
+		first_ids[si] = lookaheads.intern(terms);
+	}
 }
 
-static bool _areStatesEqual (
-		const shared_ptr<State> &state,
-		const shared_ptr<State> &other,
-        bool need_check_lookahead) {
+static uint64_t _hashConfigs (span<const Configuration> configs, bool need_lookahead) {
+	uint64_t hash = 14695981039346656037ull;
+	for (auto &c : configs) {
+		hash ^= ((uint64_t)c.rule_id << 16) | c.idx_after_cursor;
+		hash *= 1099511628211ull;
+		if (need_lookahead == true) {
+			hash ^= (uint32_t)c.lookahead_id;
+			hash *= 1099511628211ull;
+		}
+	}
+	return hash;
+}
 
-	if (state->transited_configs().size() != other->transited_configs().size())
-		return false;
+// states by hash of kernel, with or without lookahead
+class StateIndex {
+public:
+	StateIndex (bool need_lookahead)
+	:need_lookahead_(need_lookahead) {
+	}
 
-	if (state->closures().size() != other->closures().size())
-		return false;
+	int find (const vector<State> &states, span<const Configuration> kernel) const {
+		auto range = idxs_by_hash_.equal_range(_hashConfigs(kernel, need_lookahead_));
+		for (auto itr = range.first; itr != range.second; ++itr) {
+			auto other = states[itr->second].kernel();
+			if (_areKernelsEqual(kernel, other) == true)
+				return itr->second;
+		}
+		return -1;
+	}
 
-	for (int ci = 0; ci < state->transited_configs().size(); ++ci) {
-		auto &state_c = state->transited_configs()[ci];
-		auto &other_c = other->transited_configs()[ci];
-        if (_areConfigsEqual(state_c, other_c, need_check_lookahead) == false)
-            return false;
+	void add (span<const Configuration> kernel, int state_idx) {
+		idxs_by_hash_.emplace(_hashConfigs(kernel, need_lookahead_), state_idx);
 	}
 
-	return true;
-}
+private:
+	bool need_lookahead_;
+	std::unordered_multimap<uint64_t, int> idxs_by_hash_;
 
-static void _mergeStates_configs(
-		const vector<shared_ptr<Configuration>> &configs,
-		const vector<shared_ptr<Configuration>> &other) {
-	for (int ci = 0; ci < configs.size(); ++ci) {
-		auto &c       = configs[ci];
-		auto &other_c = other  [ci];
-		c->lookahead().insert(other_c->lookahead().begin(), other_c->lookahead().end());
+	bool _areKernelsEqual (span<const Configuration> kernel, span<const Configuration> other) const {
+		if (kernel.size() != other.size())
+			return false;
+
+		for (int ci = 0; ci < kernel.size(); ++ci) {
+			if (need_lookahead_ == true && (kernel[ci] == other[ci]) == false)
+				return false;
+			if (need_lookahead_ == false && kernel[ci].isCoreEqual(other[ci]) == false)
+				return false;
+		}
+		return true;
 	}
-}
+};
+
+// kernels of next states. each is made of configs which move cursor over one symbol.
+// states are numbered in symbol id order, like the map keyed by symbol before
+static void _addStates (
+		const GrammarIndex &grammar,
+		const vector<int> &first_ids,
+		int base_idx,
+		vector<State> &states,
+		StateIndex &state_index,
+		LookaheadStore &lookaheads,
+		ClosureTemplates &closure_templates,
+		ClosureScratch &closure_scratch,
+		vector<pair<int, int>> &next_symbols,
+		vector<Configuration> &kernel,
+		GenerationStats &stats) {
+
+	// symbol after cursor -> config idx
+	next_symbols.clear();
+	auto &base_configs = states[base_idx].configs;
+	for (int ci = 0; ci < base_configs.size(); ++ci) {
+		auto &c = base_configs[ci];
+		if (c.idx_after_cursor >= grammar.ruleSize(c.rule_id))
+			continue;
+		next_symbols.push_back({ grammar.ruleSymbol(c.rule_id, c.idx_after_cursor), ci });
+	}
+	std::stable_sort(next_symbols.begin(), next_symbols.end(), [](auto &a, auto &b) {
+		return a.first < b.first;
+	});
+
+	vector<pair<int, int>> transitions;
+	for (int ni = 0; ni < next_symbols.size(); ) {
+		auto symbol = next_symbols[ni].first;
+		kernel.clear();
+		for (; ni < next_symbols.size() && next_symbols[ni].first == symbol; ++ni) {
+			auto c = states[base_idx].configs[next_symbols[ni].second];
+			++c.idx_after_cursor;
+			kernel.push_back(c);
+		}
 
-static void _mergeStates (
-		vector<shared_ptr<State>> &states,
-		vector<shared_ptr<State>> &result) {
+		// same items in any order are same kernel
+		std::sort(kernel.begin(), kernel.end(), [](auto &a, auto &b) {
+			return a.rule_id < b.rule_id
+					|| (a.rule_id == b.rule_id && a.idx_after_cursor < b.idx_after_cursor);
+		});
 
-	vector<shared_ptr<State>> new_states;
-	// merge states
+		auto state_idx = state_index.find(states, kernel);
+		if (state_idx < 0) {
+			state_idx = states.size();
+
+			State new_state;
+			new_state.configs.reserve(kernel.size() * 2);
+			new_state.configs = kernel;
+			new_state.kernel_size = kernel.size();
+
+			auto closure_begin = Clock::now();
+			new_state.close(grammar, first_ids, lookaheads, closure_templates, closure_scratch,
+					&stats.lookahead_union_count);
+			stats.closure_ms += _ms(closure_begin, Clock::now());
+
+			new_state.configs.shrink_to_fit();
+			stats.config_count += new_state.configs.size();
+
+			states.push_back(std::move(new_state));
+			state_index.add(states.back().kernel(), state_idx);
+		}
+		transitions.push_back({ symbol, state_idx });
+	}
+
+	states[base_idx].transitions = std::move(transitions);
+}
+
+// class of each state by core. classes are numbered in order of their first state
+static int _classifyByCore (const vector<State> &states, vector<int> &class_of) {
+	StateIndex core_index(false);
+	class_of.assign(states.size(), -1);
+	int class_count = 0;
 	for (int si = 0; si < states.size(); ++si) {
-		auto &s = states[si];
-		if (s == null)
-			continue;
+		auto rep = core_index.find(states, states[si].kernel());
+		if (rep < 0) {
+			core_index.add(states[si].kernel(), si);
+			class_of[si] = class_count++;
+		}else {
+			class_of[si] = class_of[rep];
+		}
+	}
+	return class_count;
+}
 
-		new_states.push_back(s);
+static bool _intersects (span<const int> a, span<const int> b) {
+	for (auto ai = a.begin(), bi = b.begin(); ai != a.end() && bi != b.end(); ) {
+		if (*ai == *bi)
+			return true;
+		if (*ai < *bi)
+			++ai;
+		else
+			++bi;
+	}
+	return false;
+}
 
-		for (int other_i = si + 1; other_i < states.size(); ++other_i) {
-			auto &other_s = states[other_i];
-			if (other_s == null)
+// pager's weak compatibility on complete configs. merging is fine unless
+// two reduces would share a lookahead that they didn't share before
+static bool _areLookaheadsCompatible (
+		const LookaheadStore &lookaheads,
+		const vector<int> &las,
+		const vector<int> &other_las) {
+
+	for (int i = 0; i < las.size(); ++i) {
+		for (int j = i + 1; j < las.size(); ++j) {
+			if (_intersects(lookaheads.get(las[i]), lookaheads.get(las[j])) == true ||
+				_intersects(lookaheads.get(other_las[i]), lookaheads.get(other_las[j])) == true)
 				continue;
 
-			if (_areStatesEqual(s, other_s, false) == false)
-				continue;
+			if (_intersects(lookaheads.get(las[i]), lookaheads.get(other_las[j])) == true ||
+				_intersects(lookaheads.get(other_las[i]), lookaheads.get(las[j])) == true)
+				return false;
+		}
+	}
+	return true;
+}
 
+// minimal lr(1). core classes are split into compatible classes,
+// then split again until states of a class go to same classes by every symbol
+static int _classifyMinimal (
+		const GrammarIndex &grammar,
+		LookaheadStore &lookaheads,
+		const vector<State> &states,
+		const vector<int> &core_class_of,
+		int core_class_count,
+		vector<int> &class_of) {
+
+	// compatible classes in each core class, with united lookaheads of complete configs
+	vector<vector<int>> classes_of_core(core_class_count);
+	vector<vector<int>> class_las;
+	vector<int> las;
+	class_of.assign(states.size(), -1);
+	for (int si = 0; si < states.size(); ++si) {
+		auto &s = states[si];
+		las.clear();
+		for (auto &c : s.configs) {
+			if (c.idx_after_cursor >= grammar.ruleSize(c.rule_id))
+				las.push_back(c.lookahead_id);
+		}
 
-			// merge
-			_mergeStates_configs(s->transited_configs(), other_s->transited_configs());
-			_mergeStates_configs(s->closures()         , other_s->closures()         );
+		auto &classes = classes_of_core[core_class_of[si]];
+		for (auto ci : classes) {
+			if (_areLookaheadsCompatible(lookaheads, class_las[ci], las) == false)
+				continue;
 
-			for (auto &sss : states) {
-				if (sss == null)
-					continue;
+			for (int li = 0; li < las.size(); ++li)
+				class_las[ci][li] = lookaheads.unite(class_las[ci][li], las[li]);
+			class_of[si] = ci;
+			break;
+		}
 
-				auto &transition_map = sss->transition_map();
-				for (auto &itr : transition_map) {
-					if (itr.second == other_s)
-						transition_map[itr.first] = s;
-				}
-			}
+		if (class_of[si] < 0) {
+			class_of[si] = class_las.size();
+			classes.push_back(class_las.size());
+			class_las.push_back(las);
+		}
+	}
 
-			states[other_i] = null;
+	// split by classes of next states until nothing changes
+	int class_count = class_las.size();
+	vector<int> new_class_of(states.size());
+	vector<int> key;
+	while (true) {
+		map<vector<int>, int> new_classes;
+		for (int si = 0; si < states.size(); ++si) {
+			key.assign(1, class_of[si]);
+			for (auto &t : states[si].transitions)
+				key.push_back(class_of[t.second]);
+
+			auto itr = new_classes.emplace(key, new_classes.size()).first;
+			new_class_of[si] = itr->second;
 		}
+
+		class_of.swap(new_class_of);
+		if (new_classes.size() == class_count)
+			break;
+		class_count = new_classes.size();
 	}
 
-	result = new_states;
+	return class_count;
 }
 
-static shared_ptr<State> _findState(
-		const vector<shared_ptr<State>> &states,
-		shared_ptr<State> new_state) {
-	
+// states of a class are merged into first one and lookaheads are united
+static void _mergeStates (
+		vector<State> &states,
+		const vector<int> &class_of,
+		int class_count,
+		LookaheadStore &lookaheads,
+		long long &lookahead_union_count) {
+
+	vector<int> rep_of_class(class_count, -1);
 	for (int si = 0; si < states.size(); ++si) {
-		auto &s = states[si];
-		if (s == null)
+		auto &rep = rep_of_class[class_of[si]];
+		if (rep < 0) {
+			rep = si;
 			continue;
+		}
 
-		if (_areStatesEqual(s, new_state, true) == true)
-			return s;
+		// merge
+		auto &s = states[si];
+		auto &rep_configs = states[rep].configs;
+		for (int ci = 0; ci < s.configs.size() && ci < rep_configs.size(); ++ci) {
+			rep_configs[ci].lookahead_id =
+				lookaheads.unite(rep_configs[ci].lookahead_id, s.configs[ci].lookahead_id);
+		}
+		lookahead_union_count += s.configs.size();
 	}
 
-	return null;
-}
+	vector<State> merged;
+	merged.reserve(class_count);
+	for (int si = 0; si < states.size(); ++si) {
+		if (class_of[si] != merged.size())
+			continue;
 
-static void _findFirst (
-		const shared_ptr<TerminalBase> &termnon,
-		set<shared_ptr<TerminalBase>> &result,
-		set<shared_ptr<TerminalBase>> &history) {
-	
-	if (termnon->isTerminal()) {
-		result.insert(termnon);
-		return;
+		merged.push_back(std::move(states[si]));
+		for (auto &t : merged.back().transitions)
+			t.second = class_of[t.second];
 	}
 
+	states = std::move(merged);
+}
 
-	// nonterminal part
-	auto non = dynamic_pointer_cast<Nonterminal>(termnon);
+using ActionInfoMap = map<shared_ptr<TerminalBase>, ParsingTable::ActionInfo>;
+using ConflictActionMap = map<shared_ptr<TerminalBase>, vector<ParsingTable::ActionInfo>>;
 
-	// prevent infinity loop
-	if (history.find(termnon) != history.end())
-		return;
-	history.insert(termnon);
+// later action wins the cell. the one it replaces is kept as a conflict
+static void _setAction (
+		ActionInfoMap &action_info_map,
+		ConflictActionMap &conflict_action_map,
+		const shared_ptr<TerminalBase> &termnon,
+		const ParsingTable::ActionInfo &info,
+		int &conflict_count) {
 
-	// find recursively
-	for (auto rule : non->rules) {
-		auto &first_re = rule.right_side[0];
-		_findFirst(first_re, result, history);
+	auto itr = action_info_map.find(termnon);
+	if (itr == action_info_map.end()) {
+		action_info_map.emplace(termnon, info);
+		return;
 	}
-}
 
-static void _findFirst(
-		const shared_ptr<TerminalBase> &termnon,
-		set<shared_ptr<TerminalBase>> &result) {
+	auto &old = itr->second;
+	if (old.action == info.action && old.idx == info.idx)
+		return;
 
-	set<shared_ptr<TerminalBase>> history;
-	return _findFirst(termnon, result, history);
+	++conflict_count;
+	conflict_action_map[termnon].push_back(old);
+	old = info;
 }
 
-static void _addStates(
-	const vector<shared_ptr<Nonterminal>> &symbols,
-	const FirstMap &first_map,
-	shared_ptr<State> base,
-	vector<shared_ptr<State>> &all_states,
-	set<State*> &history) {
+static void _makeActionTable (
+		const GrammarIndex &grammar,
+		const LookaheadStore &lookaheads,
+		const vector<State> &states,
+		vector<ActionInfoMap> &action_info_map_list,
+		vector<ConflictActionMap> &conflict_action_map_list,
+		int &conflict_count) {
 
-	if (history.find(base.get()) != history.end())
-		return;
-	history.insert(base.get());
+	action_info_map_list.resize(states.size());
+	conflict_action_map_list.resize(states.size());
+	for (int si = 0; si < states.size(); ++si) {
+		auto &s = states[si];
+		auto &action_info_map = action_info_map_list[si];
+		auto &conflict_action_map = conflict_action_map_list[si];
 
-	// make next_map
-	map<shared_ptr<TerminalBase>, vector<shared_ptr<Configuration>>> next_map;
-	_makeNextTransitionInfoMap(base->transited_configs(), next_map);
-	_makeNextTransitionInfoMap(base->closures(), next_map);
+		// make about reduce
+		for (auto &c : s.configs) {
+			if (c.idx_after_cursor < grammar.ruleSize(c.rule_id))
+				continue;
 
-	// make new state
-	for (auto &itr : next_map) {
-		auto new_state = State::makeState(symbols, first_map, itr.second);
+			auto is_start = grammar.ruleLeft(c.rule_id) == grammar.start_symbol();
+			for (auto term : lookaheads.get(c.lookahead_id)) {
+				if (is_start == true && term == GrammarIndex::END_SYMBOL) {
+					_setAction(action_info_map, conflict_action_map, grammar.symbol(term), ParsingTable::ActionInfo(
+							ParsingTable::ActionInfo::ACCEPT, c.rule_id), conflict_count);
+				}else {
+					_setAction(action_info_map, conflict_action_map, grammar.symbol(term), ParsingTable::ActionInfo(
+							ParsingTable::ActionInfo::REDUCE, c.rule_id), conflict_count);
+				}
+			}
+		}
 
-		auto old_one = _findState(all_states, new_state);
-		if (old_one != null) {
-			base->transition_map()[itr.first] = old_one;
-		}else {
-			base->transition_map()[itr.first] = new_state;
-			all_states.push_back(new_state);
+		// transition
+		for (auto &t : s.transitions) {
+			auto action = (grammar.isTerminal(t.first) == true)
+					? ParsingTable::ActionInfo::SHIFT
+					: ParsingTable::ActionInfo::GOTO;
+			_setAction(action_info_map, conflict_action_map, grammar.symbol(t.first),
+					ParsingTable::ActionInfo(action, t.second), conflict_count);
 		}
 	}
 
+	if (conflict_count == 0)
+		conflict_action_map_list.clear();
 }
 
 shared_ptr<ParsingTable> ParsingTableGenerator::generateTable () {
@@ -234,56 +580,125 @@ shared_ptr<ParsingTable> ParsingTableGenerator::generateTable () {
 		return null;
 	}
 
-    // make rule elements
-    rule_elements_.clear();
-    for (auto &non :  symbols_) {
-        rule_elements_.insert(non);
-        for (auto &rule : non->rules) {
-            for (auto &termnon : rule.right_side)
-                rule_elements_.insert(termnon);
-        }
-    }
+	stats_ = GenerationStats();
+	auto begin = Clock::now();
 
-	// make first map
-	FirstMap first_map;
-	for (auto &termnon : rule_elements_) {
-		auto &first = first_map[termnon];
-		_findFirst(termnon, first);
+	for (auto &non : entry_symbols_) {
+		if (std::find(symbols_.begin(), symbols_.end(), non) == symbols_.end()) {
+			// TODO err: entry symbol {non->name} is not added
+			cout << "err: entry symbol \'" << non->name << "\' is not added to generator" << endl;
+			return null;
+		}
 	}
 
-
-	// make s_prime
+	// make s_prime, one rule per entry. the start symbol is rule 0
 	auto s_prime = make_shared<Nonterminal>("S\'");
 	s_prime->rules.push_back(Rule(s_prime, { start_symbol_ }));
+	for (auto &non : entry_symbols_) {
+		if (non != start_symbol_)
+			s_prime->rules.push_back(Rule(s_prime, { non }));
+	}
 
-	// make start state
-	set<shared_ptr<TerminalBase>> start_lookahead{ null };
-	vector<shared_ptr<Configuration>> start_configs {
-		make_shared<Configuration>(s_prime, s_prime->rules[0], 0, start_lookahead)
-	};
+	GrammarIndex grammar(symbols_, s_prime);
+	if (grammar.is_valid() == false)
+		return null;
 
-	auto start_state = State::makeState(symbols_, first_map, start_configs);
-	states_.push_back(start_state);
+	// make first map
+	LookaheadStore lookaheads;
+	vector<int> first_ids;
+	_makeFirstIds(grammar, lookaheads, first_ids);
+
+	auto first_end = Clock::now();
+	stats_.first_ms = _ms(begin, first_end);
+	_progress("first", 1, 1);
+
+	// make start states, state i for rule i of s_prime
+	vector<State> states;
+	StateIndex state_index(true);
+	ClosureTemplates closure_templates(grammar, first_ids, lookaheads);
+	ClosureScratch closure_scratch;
+
+	for (auto rule_id : grammar.rulesOf(grammar.start_symbol())) {
+		State start_state;
+		start_state.configs.push_back(
+				Configuration(rule_id, 0, lookaheads.single(GrammarIndex::END_SYMBOL)));
+		start_state.kernel_size = 1;
+		start_state.close(grammar, first_ids, lookaheads, closure_templates, closure_scratch,
+				&stats_.lookahead_union_count);
+		stats_.config_count += start_state.configs.size();
+		states.push_back(std::move(start_state));
+		state_index.add(states.back().kernel(), states.size() - 1);
+	}
 
 	// add states
-	set<State*> history;
-	for (int si = 0; si < states_.size(); ++si) {
-		auto &s = states_[si];
-		s->name("State " + to_string(si));
-		_addStates(symbols_, first_map, s, states_, history);
+	vector<pair<int, int>> next_symbols;
+	vector<Configuration> kernel;
+	for (int si = 0; si < states.size(); ++si) {
+		_addStates(grammar, first_ids, si, states, state_index,
+				lookaheads, closure_templates, closure_scratch, next_symbols, kernel, stats_);
+
+		if ((si + 1) % 64 == 0)
+			_progress("states", si + 1, states.size());
 	}
+	stats_.lr1_state_count = states.size();
+	_progress("states", states.size(), states.size());
+
+	auto discovery_end = Clock::now();
+	stats_.discovery_ms = _ms(first_end, discovery_end) - stats_.closure_ms;
 
 	// merge states
-	_mergeStates(states_, states_);
+	// minimal classes refine the core ones, which most of the merge time goes to
+	vector<int> core_class_of, minimal_class_of;
+	stats_.lalr_state_count = _classifyByCore(states, core_class_of);
+	if (lr_mode_ == MINIMAL_LR) {
+		stats_.minimal_state_count = _classifyMinimal(
+				grammar, lookaheads, states, core_class_of, stats_.lalr_state_count, minimal_class_of);
+	}
+
+	// merged states are numbered by class
+	vector<int> entry_states;
+	for (int ei = 0; ei < s_prime->rules.size(); ++ei)
+		entry_states.push_back(ei);
+
+	if (lr_mode_ == LALR) {
+		_mergeStates(states, core_class_of, stats_.lalr_state_count,
+				lookaheads, stats_.lookahead_union_count);
+		for (auto &state : entry_states)
+			state = core_class_of[state];
+	}else if (lr_mode_ == MINIMAL_LR) {
+		_mergeStates(states, minimal_class_of, stats_.minimal_state_count,
+				lookaheads, stats_.lookahead_union_count);
+		for (auto &state : entry_states)
+			state = minimal_class_of[state];
+	}
+	stats_.state_count = states.size();
+
+	auto merge_end = Clock::now();
+	stats_.merge_ms = _ms(discovery_end, merge_end);
+	_progress("merge", 1, 1);
 
 	/*// print states
-	for (auto &s : states_) {
-		cout << "################################" << endl;
-		s->print();
+	for (int si = 0; si < states.size(); ++si) {
+		cout << "## state " << si << endl;
+		cout << states[si].toString(grammar, lookaheads);
 	}*/
 
 	// make parsing table
-	return make_shared<ParsingTable>(symbols_, s_prime, states_);
+	vector<ActionInfoMap> action_info_map_list;
+	vector<ConflictActionMap> conflict_action_map_list;
+	_makeActionTable(grammar, lookaheads, states,
+			action_info_map_list, conflict_action_map_list, stats_.conflict_count);
+
+	auto table = make_shared<ParsingTable>(symbols_, s_prime,
+			std::move(action_info_map_list), std::move(conflict_action_map_list), std::move(entry_states));
+
+	auto end = Clock::now();
+	stats_.table_ms = _ms(merge_end, end);
+	stats_.total_ms = _ms(begin, end);
+	stats_.peak_rss_kb = GenerationStats::peakRssKB();
+	_progress("table", 1, 1);
+
+	return table;
 }
 
 }
@@ -1,6 +1,11 @@
 #ifndef PARSING_TABLE_GENERATOR
 #define PARSING_TABLE_GENERATOR
 
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "./lr_state.h"
 #include "./parse_table.h"
 
 #include "./defines.h"
@@ -8,21 +13,85 @@
 
 namespace parse_table {
 
+using std::function;
+using std::string;
+
+// phase times and counters of the last generateTable
+class PAW_PRINT_API GenerationStats {
+public:
+	double first_ms;
+	double closure_ms;		// State::close calls
+	double discovery_ms;	// finding transitions and states, without closure
+	double merge_ms;
+	double table_ms;
+	double total_ms;
+
+	int lr1_state_count;	// canonical lr(1), before merge
+	int lalr_state_count;
+	int minimal_state_count;	// minimal lr(1), -1 unless MINIMAL_LR
+	int state_count;		// of the table, after merge
+	int conflict_count;		// table cells where an action was overwritten
+	long long config_count;	// transited configs and closures of all lr1 states
+	long long lookahead_union_count;
+	long peak_rss_kb;		// -1 if unknown
+
+	GenerationStats ();
+
+	string toString () const;
+
+	// peak resident set of the process so far, -1 if unknown
+	static long peakRssKB ();
+};
+
+// phase is one of "first", "states", "merge", "table".
+// for "states", total grows while states are found
+using GenerationProgressFunc = function<void(const string &phase, int done, int total)>;
+
 class ParsingTableGenerator {
 public:
+	// how lr(1) states with same core are merged.
+	// MINIMAL_LR merges them unless it adds reduce/reduce conflicts,
+	// so it is as small as LALR if LALR has no new conflicts
+	enum LrMode {
+		LALR,
+		MINIMAL_LR,
+		CANONICAL_LR,
+	};
+
 	PAW_GETTER(const shared_ptr<Nonterminal>&, start_symbol)
+	PAW_GETTER(const vector<shared_ptr<Nonterminal>>&, entry_symbols)
+	PAW_GETTER_SETTER(LrMode, lr_mode)
+	PAW_GETTER(const GenerationStats&, stats)
+	PAW_SETTER(const GenerationProgressFunc&, progress_func)
 
 	ParsingTableGenerator ();
 
 	void addSymbol (const shared_ptr<Nonterminal> &non, bool is_start_symbol = false);
 
+	// another symbol the table can parse from, with its own start state and
+	// accept. states after those are shared with the start symbol.
+	// non must be added with addSymbol too
+	void addEntrySymbol (const shared_ptr<Nonterminal> &non);
+
+	// stable hash of lr_mode, start symbol and added symbols in order with
+	// their rules, by names and token types. same grammar built again,
+	// even in another process, has same fingerprint
+	uint64_t fingerprint () const;
+
+	// rules of the table, with the rules of S' for the start and entry symbols
+	int rule_count () const;
+
 	shared_ptr<ParsingTable> generateTable ();
 
 private:
 	vector<shared_ptr<Nonterminal>> symbols_;
 	shared_ptr<Nonterminal> start_symbol_;
-	vector<shared_ptr<State>> states_;
-    set<shared_ptr<TerminalBase>> rule_elements_;
+	vector<shared_ptr<Nonterminal>> entry_symbols_;
+	LrMode lr_mode_;
+	GenerationStats stats_;
+	GenerationProgressFunc progress_func_;
+
+	void _progress (const string &phase, int done, int total);
 };
 
 }
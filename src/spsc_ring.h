@@ -0,0 +1,106 @@
+#ifndef PAW_PRINT_SPSC_RING
+#define PAW_PRINT_SPSC_RING
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "./defines.h"
+
+namespace parse_table {
+
+// bounded lock-free queue for one producer thread and one consumer thread.
+// each side keeps its own copy of the other side's index and reads the
+// shared one only when that copy says the ring is full or empty, so the
+// index cache lines move between cores once per batch instead of per item
+template <class T>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two
+    SpscRing (size_t capacity)
+    :capacity_(_roundUp(capacity)),
+     mask_(capacity_ - 1),
+     slots_(std::allocator<T>().allocate(capacity_)),
+     head_(0),
+     cached_tail_(0),
+     tail_(0),
+     cached_head_(0) {
+    }
+
+    ~SpscRing () {
+        clear();
+        std::allocator<T>().deallocate(slots_, capacity_);
+    }
+
+    SpscRing (const SpscRing&) = delete;
+    SpscRing& operator= (const SpscRing&) = delete;
+
+    inline size_t capacity () const { return capacity_; }
+
+    // producer. false if full
+    template <class Value>
+    bool tryPush (Value &&value) {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ == capacity_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ == capacity_)
+                return false;
+        }
+        new (&slots_[tail & mask_]) T(std::forward<Value>(value));
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer. calls func(T&&) for up to max_count items, returns the count
+    template <class Func>
+    size_t tryPop (Func &&func, size_t max_count) {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (cached_tail_ == head) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (cached_tail_ == head)
+                return 0;
+        }
+
+        size_t count = 0;
+        for (; count < max_count && head != cached_tail_; ++count, ++head) {
+            auto &slot = slots_[head & mask_];
+            func(std::move(slot));
+            slot.~T();
+        }
+        head_.store(head, std::memory_order_release);
+        return count;
+    }
+
+    // consumer, or either side while the other isn't running
+    void clear () {
+        while (tryPop([](T&&) {}, capacity_) > 0);
+    }
+
+private:
+    static size_t _roundUp (size_t capacity) {
+        size_t result = 2;
+        while (result < capacity)
+            result *= 2;
+        return result;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    T *slots_;
+
+    // consumer side
+    alignas(64) std::atomic<size_t> head_;    // next to pop
+    size_t cached_tail_;
+
+    // producer side
+    alignas(64) std::atomic<size_t> tail_;    // next to push
+    size_t cached_head_;
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
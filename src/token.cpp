@@ -8,14 +8,15 @@ namespace parse_table {
 using std::stringstream;
 
 function<string(const char *text, const Token *token)> Token::to_string_func;
+function<void(string &buffer, const char *text, const Token *token)> Token::append_func;
 
 Token::Token (
         int type,
         int first_idx,
         int last_idx,
         unsigned short indent,
-        unsigned short column,
-        unsigned short line)
+        unsigned int column,
+        unsigned int line)
 :type(type),
  first_idx(first_idx),
  last_idx(last_idx),
@@ -25,11 +26,23 @@ Token::Token (
 }
 
 string Token::toString (const char *text) const {
+    if (append_func != null) {
+        string result;
+        append_func(result, text, this);
+        return result;
+    }
     if (to_string_func == null)
         return "";
 
     return to_string_func(text, this);
 }
 
+void Token::appendTo (string &buffer, const char *text) const {
+    if (append_func != null)
+        append_func(buffer, text, this);
+    else if (to_string_func != null)
+        buffer.append(to_string_func(text, this));
+}
+
 
 }
@@ -14,13 +14,16 @@ using std::string;
 class PAW_PRINT_API Token {
 public:
     static function<string(const char *text, const Token *token)> to_string_func;
+    // same text appended to buffer, so printers need no string per token.
+    // used before to_string_func if set
+    static function<void(string &buffer, const char *text, const Token *token)> append_func;
 
     int type;
     int first_idx;
     int last_idx;
     unsigned short indent;
-    unsigned short column;
-    unsigned short line;
+    unsigned int column;
+    unsigned int line;
 
 
     Token (
@@ -28,10 +31,11 @@ public:
             int first_idx,
             int last_idx,
             unsigned short indent,
-            unsigned short column,
-            unsigned short line);
+            unsigned int column,
+            unsigned int line);
 
     string toString (const char *text) const;
+    void appendTo (string &buffer, const char *text) const;
 };
 
 }
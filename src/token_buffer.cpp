@@ -0,0 +1,189 @@
+#include "token_buffer.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "./defines.h"
+
+
+namespace parse_table {
+
+using std::cout;
+using std::endl;
+
+
+void DeltaList::push (uint32_t value) {
+    int idx = deltas_.size();
+    if (idx % CHECKPOINT_STRIDE == 0) {
+        checkpoints_.push_back(value);
+        deltas_.push_back(0);
+    }else {
+        int64_t delta = (int64_t)value - last_;
+        if (delta > INT16_MIN && delta <= INT16_MAX) {
+            deltas_.push_back((int16_t)delta);
+        }else {
+            deltas_.push_back(OVERFLOW_DELTA);
+            overflow_[idx] = value;
+        }
+    }
+    last_ = value;
+}
+
+uint32_t DeltaList::get (int idx) const {
+    int checkpoint_idx = idx / CHECKPOINT_STRIDE;
+    uint32_t value = checkpoints_[checkpoint_idx];
+    for (int di=checkpoint_idx*CHECKPOINT_STRIDE + 1; di<=idx; ++di) {
+        if (deltas_[di] == OVERFLOW_DELTA)
+            value = overflow_.at(di);
+        else
+            value += deltas_[di];
+    }
+    return value;
+}
+
+void DeltaList::get (int begin, int end, vector<uint32_t> &result) const {
+    result.clear();
+    if (begin >= end)
+        return;
+
+    uint32_t value = get(begin);
+    result.push_back(value);
+    for (int di=begin+1; di<end; ++di) {
+        if (di % CHECKPOINT_STRIDE == 0)
+            value = checkpoints_[di / CHECKPOINT_STRIDE];
+        else if (deltas_[di] == OVERFLOW_DELTA)
+            value = overflow_.at(di);
+        else
+            value += deltas_[di];
+        result.push_back(value);
+    }
+}
+
+void DeltaList::clear () {
+    deltas_.clear();
+    checkpoints_.clear();
+    overflow_.clear();
+    last_ = 0;
+}
+
+void DeltaList::reserve (int count) {
+    deltas_.reserve(count);
+    checkpoints_.reserve(count / CHECKPOINT_STRIDE + 1);
+}
+
+
+TokenBuffer::TokenBuffer (bool with_positions)
+:with_positions_(with_positions),
+ line_index_(null) {
+}
+
+bool TokenBuffer::push (
+        int type,
+        int first_idx,
+        int last_idx,
+        unsigned short indent,
+        unsigned int column,
+        unsigned int line) {
+    if (type < 0 || type > UINT16_MAX) {
+        // TODO err: token type {type} doesn't fit in TokenBuffer
+        cout << "err: token type " << type << " doesn't fit in TokenBuffer" << endl;
+        return false;
+    }
+
+    types_.push_back(type);
+    offsets_.push_back(first_idx);
+    lengths_.push_back((uint32_t)(last_idx + 1 - first_idx));
+    if (with_positions_ == true) {
+        indents_.push_back(indent);
+        columns_.push(column);
+        lines_.push(line);
+    }
+
+    // keep a materialized last chunk complete
+    int idx = types_.size() - 1;
+    if (idx / CHUNK_SIZE < chunks_.size())
+        chunks_[idx / CHUNK_SIZE].push_back(at(idx));
+    return true;
+}
+
+bool TokenBuffer::push (const Token &token) {
+    return push(token.type, token.first_idx, token.last_idx, token.indent, token.column, token.line);
+}
+
+void TokenBuffer::clear () {
+    types_.clear();
+    offsets_.clear();
+    lengths_.clear();
+    indents_.clear();
+    columns_.clear();
+    lines_.clear();
+    chunks_.clear();
+}
+
+void TokenBuffer::reserve (int count) {
+    types_.reserve(count);
+    offsets_.reserve(count);
+    lengths_.reserve(count);
+    if (with_positions_ == true) {
+        indents_.reserve(count);
+        columns_.reserve(count);
+        lines_.reserve(count);
+    }
+}
+
+unsigned short TokenBuffer::indent (int idx) const {
+    if (with_positions_ == true)
+        return indents_[idx];
+    return (line_index_ == null)? 0: line_index_->position(offsets_[idx]).indent;
+}
+
+unsigned int TokenBuffer::column (int idx) const {
+    if (with_positions_ == true)
+        return columns_.get(idx);
+    return (line_index_ == null)? 0: line_index_->position(offsets_[idx]).column;
+}
+
+unsigned int TokenBuffer::line (int idx) const {
+    if (with_positions_ == true)
+        return lines_.get(idx);
+    return (line_index_ == null)? 0: line_index_->lineOf(offsets_[idx]);
+}
+
+Token TokenBuffer::at (int idx) const {
+    if (with_positions_ == false && line_index_ != null) {
+        auto pos = line_index_->position(offsets_[idx]);
+        return Token(type(idx), first_idx(idx), last_idx(idx), pos.indent, pos.column, pos.line);
+    }
+    return Token(type(idx), first_idx(idx), last_idx(idx), indent(idx), column(idx), line(idx));
+}
+
+const Token* TokenBuffer::token (int idx) const {
+    int chunk_idx = idx / CHUNK_SIZE;
+    while (chunks_.size() <= chunk_idx) {
+        int begin = chunks_.size() * CHUNK_SIZE;
+        int end = std::min(begin + CHUNK_SIZE, size());
+
+        // positions are decoded in one pass instead of per token
+        vector<uint32_t> columns, lines;
+        if (with_positions_ == true) {
+            columns_.get(begin, end, columns);
+            lines_.get(begin, end, lines);
+        }
+
+        // reserved once, so later pushes never move it
+        vector<Token> chunk;
+        chunk.reserve(CHUNK_SIZE);
+        for (int ti=begin; ti<end; ++ti) {
+            if (with_positions_ == true) {
+                chunk.push_back(Token(type(ti), first_idx(ti), last_idx(ti),
+                        indents_[ti], columns[ti - begin], lines[ti - begin]));
+            }else {
+                chunk.push_back(at(ti));
+            }
+        }
+        chunks_.push_back(std::move(chunk));
+    }
+    return &chunks_[chunk_idx][idx % CHUNK_SIZE];
+}
+
+}
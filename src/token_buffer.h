@@ -0,0 +1,103 @@
+#ifndef PAW_PRINT_TOKEN_BUFFER
+#define PAW_PRINT_TOKEN_BUFFER
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "./line_index.h"
+#include "./token.h"
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::span;
+using std::unordered_map;
+using std::vector;
+
+
+// 32-bit values stored as 16-bit deltas from the previous value.
+// an absolute value is kept every CHECKPOINT_STRIDE values, so get() walks
+// at most that many deltas. deltas which don't fit are kept in overflow_
+class PAW_PRINT_API DeltaList {
+public:
+    static const int CHECKPOINT_STRIDE = 64;
+
+    inline int size () const { return deltas_.size(); }
+
+    void push (uint32_t value);
+    uint32_t get (int idx) const;
+    void get (int begin, int end, vector<uint32_t> &result) const;
+    void clear ();
+    void reserve (int count);
+
+private:
+    static constexpr int16_t OVERFLOW_DELTA = INT16_MIN;
+
+    vector<int16_t> deltas_;
+    vector<uint32_t> checkpoints_;
+    unordered_map<int, uint32_t> overflow_;  // idx -> value
+    uint32_t last_ = 0;
+};
+
+// tokens as separate arrays, so the parser only walks the types.
+// type is 16-bit, offsets and lengths are 32-bit. indent, line and column
+// are kept only with positions, line and column delta-encoded.
+// without positions they come from line_index if it is set, else 0.
+// token() makes a Token for nodes, in chunks which never move, so
+// pointers to it stay valid while the buffer lives, even after push
+class PAW_PRINT_API TokenBuffer {
+public:
+    static const int CHUNK_SIZE = 256;
+
+    PAW_GETTER(bool, with_positions)
+    PAW_GETTER_SETTER(const LineIndex*, line_index)
+
+    TokenBuffer (bool with_positions=true);
+
+    inline int size () const { return types_.size(); }
+    inline bool empty () const { return types_.empty(); }
+
+    // false if type doesn't fit in 16 bits
+    bool push (
+            int type,
+            int first_idx,
+            int last_idx,
+            unsigned short indent=0,
+            unsigned int column=0,
+            unsigned int line=0);
+    bool push (const Token &token);
+    void clear ();
+    void reserve (int count);
+
+    inline int type (int idx) const { return types_[idx]; }
+    inline span<const uint16_t> types () const { return span<const uint16_t>(types_); }
+    inline int first_idx (int idx) const { return offsets_[idx]; }
+    inline int last_idx (int idx) const { return (int)(offsets_[idx] + lengths_[idx]) - 1; }
+    unsigned short indent (int idx) const;
+    unsigned int column (int idx) const;
+    unsigned int line (int idx) const;
+
+    Token at (int idx) const;
+    const Token* token (int idx) const;
+
+private:
+    bool with_positions_;
+    const LineIndex *line_index_;
+    vector<uint16_t> types_;
+    vector<uint32_t> offsets_;
+    vector<uint32_t> lengths_;
+    vector<unsigned short> indents_;
+    DeltaList columns_;
+    DeltaList lines_;
+
+    mutable vector<vector<Token>> chunks_;  // reserved to CHUNK_SIZE, filled up to size()
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
@@ -0,0 +1,69 @@
+#include "token_stream.h"
+
+#include <thread>
+
+#include "./defines.h"
+
+
+namespace parse_table {
+
+TokenStream::TokenStream (int ring_capacity)
+:ring_(ring_capacity),
+ size_(0),
+ is_closed_(false),
+ is_cancelled_(false) {
+}
+
+bool TokenStream::push (const Token &token) {
+    while (ring_.tryPush(token) == false) {
+        if (is_cancelled_.load(std::memory_order_relaxed) == true)
+            return false;
+        std::this_thread::yield();
+    }
+    return is_cancelled_.load(std::memory_order_relaxed) == false;
+}
+
+void TokenStream::close () {
+    is_closed_.store(true, std::memory_order_release);
+}
+
+bool TokenStream::_wait (int idx) {
+    auto read = [this](Token &&token) {
+        int chunk_idx = size_ / CHUNK_SIZE;
+        if (chunk_idx == chunks_.size()) {
+            chunks_.emplace_back();
+            chunks_.back().reserve(CHUNK_SIZE);
+        }
+        chunks_[chunk_idx].push_back(token);
+        ++size_;
+    };
+
+    while (idx >= size_) {
+        if (ring_.tryPop(read, READ_BATCH) > 0)
+            continue;
+
+        // closed is set after the last push, so the ring is checked once more
+        if (is_closed_.load(std::memory_order_acquire) == true) {
+            if (ring_.tryPop(read, READ_BATCH) > 0)
+                continue;
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+void TokenStream::cancel () {
+    is_cancelled_.store(true, std::memory_order_relaxed);
+}
+
+void TokenStream::reset () {
+    ring_.clear();
+    for (auto &chunk : chunks_)
+        chunk.clear();
+    size_ = 0;
+    is_closed_.store(false);
+    is_cancelled_.store(false);
+}
+
+}
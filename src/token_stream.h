@@ -0,0 +1,61 @@
+#ifndef PAW_PRINT_TOKEN_STREAM
+#define PAW_PRINT_TOKEN_STREAM
+
+#include <atomic>
+#include <vector>
+
+#include "./spsc_ring.h"
+#include "./token.h"
+
+#include "./defines.h"
+
+namespace parse_table {
+
+using std::vector;
+
+
+// tokens written by a lexer thread and read by the parser thread while
+// the lexer still runs. they go through a bounded ring, so a fast lexer
+// waits for the parser instead of growing memory. read tokens are kept in
+// chunks which never move, since nodes point to them
+class PAW_PRINT_API TokenStream {
+public:
+    static const int DEFAULT_RING_CAPACITY = 4096;
+
+    TokenStream (int ring_capacity=DEFAULT_RING_CAPACITY);
+
+    // lexer side. push waits while the ring is full,
+    // and is false once the parser has cancelled, so the lexer can stop
+    bool push (const Token &token);
+    void close ();  // after the last token
+
+    // parser side. has waits until token idx is read or the stream is closed
+    inline bool has (int idx) { return idx < size_ || _wait(idx); }
+    inline int size () const { return size_; }
+    inline int type (int idx) const { return token(idx)->type; }
+    inline const Token* token (int idx) const { return &chunks_[idx / CHUNK_SIZE][idx % CHUNK_SIZE]; }
+
+    // stops a lexer waiting in push, when the parse ended early
+    void cancel ();
+
+    // for another pass, when no lexer runs. keeps capacity
+    void reset ();
+
+private:
+    static const int READ_BATCH = 256;
+    static const int CHUNK_SIZE = 4096;
+
+    SpscRing<Token> ring_;
+    vector<vector<Token>> chunks_;  // reserved once
+    int size_;
+    std::atomic<bool> is_closed_;
+    std::atomic<bool> is_cancelled_;
+
+    bool _wait (int idx);
+};
+
+}
+
+#include "./undefines.h"
+
+#endif
@@ -0,0 +1,73 @@
+#include "./alloc_counter.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+
+std::atomic<size_t> g_alloc_count(0);
+
+// malloc and free stay behind functions that aren't inlined, so gcc doesn't
+// pair a new with a free and warn
+#if defined(_MSC_VER)
+#define ALLOC_NOINLINE __declspec(noinline)
+#else
+#define ALLOC_NOINLINE __attribute__((noinline))
+#endif
+
+// aligned blocks keep the malloc pointer just before the aligned one
+ALLOC_NOINLINE static void* _allocate (size_t size, size_t align) {
+  ++g_alloc_count;
+  if (size == 0)
+    size = 1;
+  if (align <= alignof(std::max_align_t))
+    return std::malloc(size);
+
+  auto raw = std::malloc(size + align + sizeof(void*));
+  if (raw == nullptr)
+    return nullptr;
+  auto aligned = ((uintptr_t)raw + sizeof(void*) + align - 1) & ~(uintptr_t)(align - 1);
+  ((void**)aligned)[-1] = raw;
+  return (void*)aligned;
+}
+
+ALLOC_NOINLINE static void _deallocate (void *p, size_t align) {
+  if (p == nullptr)
+    return;
+  if (align <= alignof(std::max_align_t))
+    std::free(p);
+  else
+    std::free(((void**)p)[-1]);
+}
+
+static void* _allocateOrThrow (size_t size, size_t align) {
+  if (auto p = _allocate(size, align))
+    return p;
+  throw std::bad_alloc();
+}
+
+static const size_t DEFAULT_ALIGN = alignof(std::max_align_t);
+
+void* operator new (size_t size) { return _allocateOrThrow(size, DEFAULT_ALIGN); }
+void* operator new[] (size_t size) { return _allocateOrThrow(size, DEFAULT_ALIGN); }
+void* operator new (size_t size, std::align_val_t align) { return _allocateOrThrow(size, (size_t)align); }
+void* operator new[] (size_t size, std::align_val_t align) { return _allocateOrThrow(size, (size_t)align); }
+
+void* operator new (size_t size, const std::nothrow_t&) noexcept { return _allocate(size, DEFAULT_ALIGN); }
+void* operator new[] (size_t size, const std::nothrow_t&) noexcept { return _allocate(size, DEFAULT_ALIGN); }
+void* operator new (size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return _allocate(size, (size_t)align); }
+void* operator new[] (size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return _allocate(size, (size_t)align); }
+
+void operator delete (void *p) noexcept { _deallocate(p, DEFAULT_ALIGN); }
+void operator delete[] (void *p) noexcept { _deallocate(p, DEFAULT_ALIGN); }
+void operator delete (void *p, size_t) noexcept { _deallocate(p, DEFAULT_ALIGN); }
+void operator delete[] (void *p, size_t) noexcept { _deallocate(p, DEFAULT_ALIGN); }
+void operator delete (void *p, std::align_val_t align) noexcept { _deallocate(p, (size_t)align); }
+void operator delete[] (void *p, std::align_val_t align) noexcept { _deallocate(p, (size_t)align); }
+void operator delete (void *p, size_t, std::align_val_t align) noexcept { _deallocate(p, (size_t)align); }
+void operator delete[] (void *p, size_t, std::align_val_t align) noexcept { _deallocate(p, (size_t)align); }
+
+void operator delete (void *p, const std::nothrow_t&) noexcept { _deallocate(p, DEFAULT_ALIGN); }
+void operator delete[] (void *p, const std::nothrow_t&) noexcept { _deallocate(p, DEFAULT_ALIGN); }
+void operator delete (void *p, std::align_val_t align, const std::nothrow_t&) noexcept { _deallocate(p, (size_t)align); }
+void operator delete[] (void *p, std::align_val_t align, const std::nothrow_t&) noexcept { _deallocate(p, (size_t)align); }
@@ -0,0 +1,12 @@
+#ifndef TEST_ALLOC_COUNTER
+#define TEST_ALLOC_COUNTER
+
+#include <atomic>
+#include <cstddef>
+
+
+// allocations made by the whole process. alloc_counter.cpp replaces every
+// form of new and delete, so an executable linking it counts all of them
+extern std::atomic<size_t> g_alloc_count;
+
+#endif
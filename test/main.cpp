@@ -1,14 +1,23 @@
 
+#include <algorithm>
 #include <assert.h>
 #include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
+#include <stdlib.h>
+#include <thread>
 
 #include "../external/paw_print/paw_print.h"
+#include "../src/green_tree.h"
 #include "../src/parse_table.h"
+#include "../src/parse_tree_cache.h"
+#include "../src/parsing_table_cache.h"
 #include "../src/parsing_table_generator.h"
+#include "../src/spsc_ring.h"
+#include "./alloc_counter.h"
 
 
 using namespace parse_table;
@@ -128,10 +137,24 @@ static void _t_generateParseTree () {
   start->rules.push_back(Rule(start, { non_node }));
 
 
+  vector<string> phases;
+  generator.progress_func([&phases](const string &phase, int done, int total) {
+    assert(done <= total);
+    if (phases.empty() || phases.back() != phase)
+      phases.push_back(phase);
+  });
+
   auto parsing_table = generator.generateTable();
   auto table_str = parsing_table->toString();
   cout << table_str;
 
+  auto &gen_stats = generator.stats();
+  assert((phases == vector<string>{ "first", "states", "merge", "table" }));
+  assert(gen_stats.state_count == 24 && gen_stats.lr1_state_count >= gen_stats.state_count);
+  assert(gen_stats.lalr_state_count == 24 && gen_stats.minimal_state_count == -1);
+  assert(gen_stats.config_count > gen_stats.lr1_state_count);
+  assert(gen_stats.total_ms >= gen_stats.first_ms + gen_stats.merge_ms + gen_stats.table_ms);
+
   auto table_correct =
     "##### Rules\n" \
     "# Rule 0 : S' -> S \n" \
@@ -363,6 +386,90 @@ static void _t_generateParseTree () {
   //cout << rn_str << endl;
   assert(node_str == rn_str);
 
+  // instrumented parse gives same tree and counts every step
+  ParseStats stats;
+  auto stats_rn = loaded.generateParseTree(text, tokens, stats);
+  assert(stats_rn != null && stats_rn->toString(text, 0, true) == node_str);
+
+  int non_count = 0;
+  for (auto pos = node_str.find("Nonterminal("); pos != string::npos;
+      pos = node_str.find("Nonterminal(", pos + 1))
+    ++non_count;
+
+  long long visit_sum = 0;
+  for (auto count : stats.visit_counts())
+    visit_sum += count;
+
+  assert(stats.shift_count() == tokens.size() - 1);
+  assert(stats.reduce_count() == non_count);
+  assert(stats.goto_count() == non_count);
+  assert(visit_sum == stats.shift_count() + stats.reduce_count() + 1);  // + accept
+  assert(stats.max_stack_depth() > 1 && stats.max_stack_depth() <= tokens.size());
+  assert(stats.hotStates().size() > 0);
+
+  // a second parse doesn't add a transition from the last state of the first
+  long long transition_sum = 0;
+  for (auto &counts : stats.transition_counts())
+    for (auto &[to, count] : counts)
+      transition_sum += count;
+  assert(transition_sum == visit_sum - 1);
+  loaded.generateParseTree(text, tokens, stats);
+  long long second_transition_sum = 0;
+  for (auto &counts : stats.transition_counts())
+    for (auto &[to, count] : counts)
+      second_transition_sum += count;
+  assert(second_transition_sum == transition_sum * 2);
+
+  // profile-guided renumbering keeps the table equivalent
+  auto order = stats.layoutOrder(loaded.state_count());
+  assert(stats.layoutOrder(0).empty());
+  assert(order.size() == loaded.state_count() && order[0] == 0);
+  auto reordered = loaded.renumberStates(order);
+  assert(reordered != null);
+  assert(reordered->isEquivalent(loaded) && loaded.isEquivalent(*reordered));
+  assert(reordered->isEquivalent(*parsing_table));
+
+  auto reordered_rn = reordered->generateParseTree(text, tokens);
+  assert(reordered_rn != null && reordered_rn->toString(text, 0, true) == node_str);
+
+  // generated states are already distinct
+  TableSize before_min, after_min;
+  auto minimized = loaded.minimizeStates(&before_min, &after_min);
+  assert(after_min.state_count == before_min.state_count);
+  assert(minimized->generateParseTree(text, tokens)->toString(text, 0, true) == node_str);
+
+  // same tree from soa tokens
+  TokenBuffer token_buffer;
+  for (auto &t : tokens)
+    assert(token_buffer.push(t) == true);
+  auto buffer_rn = loaded.generateParseTree(text, token_buffer);
+  assert(buffer_rn != null && buffer_rn->toString(text, 0, true) == node_str);
+
+  // indents found from offsets match the lexed ones of line starting tokens
+  LineIndex line_index(text);
+  TokenBuffer offsets_only(false);
+  offsets_only.line_index(&line_index);
+  for (auto &t : tokens) {
+    offsets_only.push(t.type, t.first_idx, t.last_idx);
+    auto pos = line_index.position(t.first_idx);
+    if (t.type > 2 && pos.column == pos.indent)
+      assert(pos.indent == t.indent);
+  }
+  assert(offsets_only.indent(3) == 4 && offsets_only.line(3) == 1 && offsets_only.column(3) == 4);
+  auto offsets_rn = loaded.generateParseTree(text, offsets_only);
+  assert(offsets_rn != null);
+
+  // same shape and offsets, indents differ inside blocks
+  auto shape = [](const Node &root) {
+    string result;
+    NodeWalker().walk(root, [&](const Node &node, int depth) {
+      result += to_string(depth) + node.termnon()->name + to_string(node.token()->first_idx) + " ";
+      return true;
+    });
+    return result;
+  };
+  assert(shape(*offsets_rn) == shape(*rn));
+
   delete[] content;
   delete[] text;
 }
@@ -595,6 +702,84 @@ static void _t_generatePawPrintParsingTable () {
   //cout << loaded_str;
   assert(loaded_str == table_str);
 
+  // other layouts and states without action arrays load as empty tables
+  PawPrint old_layout("old layout");
+  old_layout.beginSequence();
+    old_layout.beginSequence();
+    old_layout.endSequence();
+  old_layout.endSequence();
+  assert(ParsingTable(old_layout.raw_data()).state_count() == 0);
+
+  PawPrint broken("broken");
+  broken.beginSequence();
+    broken.pushString("parsing table 4");
+    broken.beginSequence();
+    broken.endSequence();
+    broken.beginSequence();
+    broken.endSequence();
+    broken.pushString("S'");
+    broken.beginSequence();
+    broken.endSequence();
+    broken.beginSequence();
+      broken.beginSequence();
+        broken.beginSequence();
+          broken.pushString("$");
+        broken.endSequence();
+      broken.endSequence();
+    broken.endSequence();
+  broken.endSequence();
+  assert(ParsingTable(broken.raw_data()).state_count() == 0);
+
+  // string ids past the string table
+  PawPrint no_strings("no string table");
+  vector<byte> no_actions;
+  vector<int> no_idxs;
+  no_strings.beginSequence();
+    no_strings.pushString("parsing table 4");
+    no_strings.beginSequence();
+    no_strings.endSequence();
+    no_strings.beginSequence();
+      no_strings.pushInternedString("N");
+      no_strings.beginSequence();
+      no_strings.endSequence();
+    no_strings.endSequence();
+    no_strings.pushString("S'");
+    no_strings.beginSequence();
+    no_strings.endSequence();
+    no_strings.beginSequence();
+      no_strings.beginSequence();
+        no_strings.beginSequence();
+        no_strings.endSequence();
+        no_strings.pushArray(span<const byte>(no_actions));
+        no_strings.pushArray(span<const int >(no_idxs));
+      no_strings.endSequence();
+    no_strings.endSequence();
+  no_strings.endSequence();
+  assert(ParsingTable(no_strings.raw_data()).state_count() == 0);
+
+  // actions and entry states out of range
+  auto bad_term = make_shared<Terminal>("x", 1);
+  auto bad_start = make_shared<Nonterminal>("S'");
+  bad_start->rules.push_back(Rule(bad_start, { bad_term }));
+  bad_start->rules.push_back(Rule(bad_start, { bad_term, bad_term }));
+  auto save_one_state = [&](ParsingTable::ActionInfo action_info, vector<int> &&entry_states) {
+    vector<map<shared_ptr<TerminalBase>, ParsingTable::ActionInfo>> states(1);
+    states[0][bad_term] = action_info;
+    ParsingTable table({}, bad_start, std::move(states), {}, std::move(entry_states));
+    vector<unsigned char> data;
+    assert(table.saveBinary(data));
+    return data;
+  };
+  using Action = ParsingTable::ActionInfo::Action;
+  assert(ParsingTable(save_one_state({ Action::SHIFT, 0 }, {})).state_count() == 1);
+  assert(ParsingTable(save_one_state({ Action::SHIFT, 100000 }, {})).state_count() == 0);
+  assert(ParsingTable(save_one_state({ Action::GOTO, -1 }, {})).state_count() == 0);
+  assert(ParsingTable(save_one_state({ Action::REDUCE, 2 }, {})).state_count() == 0);
+  assert(ParsingTable(save_one_state({ Action::ACCEPT, 5 }, {})).state_count() == 0);
+  assert(ParsingTable(save_one_state({ (Action)9, 0 }, {})).state_count() == 0);
+  assert(ParsingTable(save_one_state({ Action::SHIFT, 0 }, { 0, 0 })).state_count() == 1);
+  assert(ParsingTable(save_one_state({ Action::SHIFT, 0 }, { 0, 3 })).state_count() == 0);
+
   // save
   std::ofstream f;
   f.open("paw_print.tab", std::ofstream::out | std::ofstream::binary);
@@ -602,8 +787,1172 @@ static void _t_generatePawPrintParsingTable () {
   f.close();
 }
 
+static void _t_pawPrintPushSequence () {
+  vector<int> values = { 3, -1, 4, 1, -5, 9 };
+
+  PawPrint paw("push sequence");
+  paw.reserve(64, 4);
+  paw.beginMap();
+    paw.pushKey("values", 2, 1);
+    paw.pushSequence(span<const int>(values), 10, 1);
+    paw.pushKey("doubles", 2, 2);
+    paw.pushSequence(span<const double>(vector<double>{ 0.5, 1.5 }), 11, 2);
+  paw.endMap();
+
+  auto root = PawPrint::root(make_shared<PawPrint>(paw));
+  auto pp_values = root->getElem("values");
+  assert(pp_values->isSequence() == true);
+  assert(pp_values->size() == values.size());
+  for (int vi=0; vi<values.size(); ++vi)
+    assert(pp_values->getElem(vi)->get(0) == values[vi]);
+  assert(pp_values->getColumn() == 10);
+  assert(pp_values->getLine() == 1);
+
+  auto pp_doubles = root->getElem("doubles");
+  assert(pp_doubles->size() == 2);
+  assert(pp_doubles->getElem(1)->get(0.0) == 1.5);
+  assert(pp_doubles->getLine() == 2);
+  assert(root->getColumn() == 0);
+
+  // same layout as pushing one by one
+  PawPrint each("push each");
+  each.beginSequence();
+  for (auto v : values)
+    each.pushSint4B(v);
+  each.endSequence();
+  assert(PawPrint("vector", values).raw_data() == each.raw_data());
+}
+
+static void _t_pawPrintArray () {
+  vector<int   > ints    = { 7, -8, 9 };
+  vector<double> doubles = { 0.25, 0.5, 0.75, 1.0 };
+
+  PawPrint paw("array");
+  paw.beginSequence();
+    paw.pushUint1B(1);  // shift payload off alignment
+    paw.pushArray(span<const int   >(ints   ));
+    paw.pushArray(span<const double>(doubles));
+    paw.pushArray(span<const int   >());
+  paw.endSequence();
+
+  auto root = PawPrint::root(make_shared<PawPrint>(paw));
+  assert(root->size() == 4);
+
+  auto pp_ints = root->getElem(1);
+  assert(pp_ints->isArray() == true);
+  assert(pp_ints->size() == ints.size());
+  auto int_span = pp_ints->getArray<int>();
+  assert(int_span.size() == ints.size());
+  assert(reinterpret_cast<uintptr_t>(int_span.data()) % alignof(int) == 0);
+  for (int vi=0; vi<ints.size(); ++vi)
+    assert(int_span[vi] == ints[vi]);
+  assert(pp_ints->getArray<double>().size() == 0);
+
+  auto double_span = root->getElem(2)->getArray<double>();
+  double sum = 0;
+  for (auto v : double_span)
+    sum += v;
+  assert(sum == 2.5);
+
+  assert(root->getElem(3)->size() == 0);
+  assert(root->getElem(1)->toString() == "- 7\n- -8\n- 9\n");
+
+  // copied subtree keeps its pad but not its offset, so it's read from a copy
+  auto copied = make_shared<PawPrint>("copied array", root->getElem(1));
+  assert(reinterpret_cast<uintptr_t>(copied->getArrayData(0)) % alignof(int) != 0);
+  auto copied_span = PawPrint::root(copied)->getArray<int>();
+  assert(copied_span.size() == ints.size());
+  assert(reinterpret_cast<uintptr_t>(copied_span.data()) % alignof(int) == 0);
+  assert(std::equal(copied_span.begin(), copied_span.end(), ints.begin()));
+  assert(PawPrint::root(copied)->getArray<int>().data() == copied_span.data());
+}
+
+static void _t_pawPrintStringTable () {
+  PawPrint paw("string table");
+  paw.beginMap();
+    paw.pushInternedKey("zeta");
+    paw.pushInternedString("shared");
+    paw.pushInternedKey("alpha");
+    paw.beginSequence();
+      paw.pushInternedString("shared");
+      paw.pushInternedString("alpha");
+      paw.pushString("inline");
+    paw.endSequence();
+    paw.pushKey("beta");
+    paw.pushInternedString("shared");
+  paw.endMap();
+  paw.pushStringTable();
+  assert(paw.is_closed() == true);
+  assert(paw.string_count() == 3);
+
+  auto loaded = make_shared<PawPrint>("loaded", paw.raw_data());
+  assert(loaded->string_count() == 3);
+  assert(loaded->findStringId("alpha" ) == 0);
+  assert(loaded->findStringId("shared") == 1);
+  assert(loaded->findStringId("zeta"  ) == 2);
+  assert(loaded->findStringId("beta"  ) == -1);
+
+  auto root = PawPrint::root(loaded);
+  assert(root->getElem("zeta")->get("") == "shared");
+  assert(root->getElem("zeta")->getStringId() == 1);
+  assert(root->getElem("zeta")->is<string>() == true);
+  assert(root->getElem("beta")->get("") == "shared");
+  assert(root->getElem("alpha")->getElem(1)->get("") == "alpha");
+  assert(root->getElem("alpha")->getElem(2)->getStringId() == -1);
+  assert(root->getElem("none")->isValid() == false);
+  assert(string(root->getKeyOfPair(0)) == "zeta");
+
+  // copy of sub data keeps string table
+  PawPrint sub("sub", root->getElem("alpha"));
+  assert(PawPrint::root(make_shared<PawPrint>(sub))->getElem(0)->get("") == "shared");
+}
+
+static shared_ptr<Cursor> _makeLayer (int layer, const vector<string> &keys) {
+  auto paw = make_shared<PawPrint>("layer " + to_string(layer));
+  paw->beginMap();
+  for (auto &k : keys) {
+    paw->pushKey(k);
+    paw->beginMap();
+      paw->pushKey("layer_" + to_string(layer));
+      paw->pushSint4B(layer);
+      paw->pushKey("value");
+      paw->pushSint4B(layer * 100);
+    paw->endMap();
+  }
+  paw->endMap();
+  return PawPrint::root(paw);
+}
+
+static void _t_frozenMergerCursor () {
+  vector<shared_ptr<Cursor>> layers = {
+    _makeLayer(0, { "a", "b", "c" }),
+    _makeLayer(1, { "b", "d" }),
+    _makeLayer(2, { "c" }),
+  };
+
+  MergerCursor lazy  (layers, 2);
+  MergerCursor frozen(layers, 2);
+  frozen.freeze();
+  assert(frozen.is_frozen() == true);
+
+  assert(lazy.size() == 4);
+  assert(frozen.size() == lazy.size());
+  for (auto key : { "a", "b", "c", "d" }) {
+    assert(frozen.getWinningLayer(key) == lazy.getWinningLayer(key));
+    assert(frozen.getElem(key)->getElem("value")->get(-1)
+        == lazy.getElem(key)->getElem("value")->get(-1));
+    assert(frozen.getElem(key)->size() == lazy.getElem(key)->size());
+  }
+  assert(frozen.getWinningLayer("c") == 2);
+  assert(frozen.getElem("b")->getElem("layer_0")->get(-1) == 0);
+  assert(frozen.getElem("b")->getElem("layer_1")->get(-1) == 1);
+  assert(frozen.getElem("x")->isValid() == false);
+  assert(frozen.getWinningLayer("x") == -1);
+  assert(frozen.toString() == lazy.toString());
+
+  // changing stack drops frozen index
+  frozen.popCursor();
+  assert(frozen.is_frozen() == false);
+  assert(frozen.getWinningLayer("c") == 0);
+  assert(frozen.size() == 4);
+}
+
+static void _t_mapLoader () {
+  auto paw = make_shared<PawPrint>("map loader");
+  paw->beginMap();
+    paw->pushKey("width" ); paw->pushSint4B(640);
+    paw->pushKey("height"); paw->pushSint4B(480);
+    paw->pushKey("title" ); paw->pushString("paw");
+    paw->pushKey("extra" ); paw->pushNull();
+  paw->endMap();
+  auto root = PawPrint::root(paw);
+
+  for (int mode=0; mode<3; ++mode) {
+    int width = 0, height = 0;
+    string title;
+
+    MapLoader loader;
+    loader.addCase("width" , [&](auto &v) { width  = v->get(0); }, true);
+    loader.addCase("height", [&](auto &v) { height = v->get(0); });
+    loader.addCase("title" , [&](auto &v) { title  = v->get(""); });
+    loader.addCase("depth" , [&](auto &v) { }, true);
+    if (mode > 0)
+      loader.compile(mode == 2);
+
+    vector<string> missing_keys, unknown_keys;
+    assert(loader.load(root, &missing_keys, &unknown_keys) == false);
+    assert(width == 640 && height == 480 && title == "paw");
+    assert(missing_keys == vector<string>{ "depth" });
+    assert(unknown_keys == vector<string>{ "extra" });
+  }
+
+  // same loader for a nested map keeps loaded keys of the outer map
+  auto nested = make_shared<PawPrint>("nested map loader");
+  nested->beginMap();
+    nested->pushKey("child"); nested->beginMap();
+      nested->pushKey("width"); nested->pushSint4B(1);
+    nested->endMap();
+    nested->pushKey("width"); nested->pushSint4B(2);
+  nested->endMap();
+
+  for (int mode=0; mode<3; ++mode) {
+    int width_sum = 0;
+    bool is_child_loaded = false;
+
+    MapLoader loader;
+    loader.addCase("width", [&](auto &v) { width_sum += v->get(0); }, true);
+    loader.addCase("child", [&](auto &v) { is_child_loaded = loader.load(v); });
+    if (mode > 0)
+      loader.compile(mode == 2);
+
+    assert(loader.load(PawPrint::root(nested)) == true);
+    assert(is_child_loaded == true && width_sum == 3);
+  }
+}
+
+// S -> a E c | a F d | b F c | b E d, E -> e, F -> e is lr(1) but not lalr(1)
+static void _t_lrModes () {
+  auto term_a = make_shared<Terminal>("a", 1);
+  auto term_b = make_shared<Terminal>("b", 2);
+  auto term_c = make_shared<Terminal>("c", 3);
+  auto term_d = make_shared<Terminal>("d", 4);
+  auto term_e = make_shared<Terminal>("e", 5);
+
+  auto non_e = make_shared<Nonterminal>("E");
+  auto non_f = make_shared<Nonterminal>("F");
+  auto start = make_shared<Nonterminal>("S");
+
+  start->rules.push_back(Rule(start, { term_a, non_e, term_c }));
+  start->rules.push_back(Rule(start, { term_a, non_f, term_d }));
+  start->rules.push_back(Rule(start, { term_b, non_f, term_c }));
+  start->rules.push_back(Rule(start, { term_b, non_e, term_d }));
+  non_e->rules.push_back(Rule(non_e, { term_e }));
+  non_f->rules.push_back(Rule(non_f, { term_e }));
+
+  vector<Token> tokens = {
+    Token(2, 0, 0, 0, 0, 0),
+    Token(5, 1, 1, 0, 0, 0),
+    Token(4, 2, 2, 0, 0, 0),
+    Token(0, 3, 3, 0, 0, 0),
+  };
+
+  auto generate = [&](ParsingTableGenerator::LrMode mode, GenerationStats &stats) {
+    ParsingTableGenerator generator;
+    generator.addSymbol(start, true);
+    generator.addSymbol(non_e);
+    generator.addSymbol(non_f);
+    generator.lr_mode(mode);
+    auto table = generator.generateTable();
+    stats = generator.stats();
+    return table;
+  };
+
+  GenerationStats lalr, minimal, canonical;
+  auto lalr_table      = generate(ParsingTableGenerator::LALR, lalr);
+  auto minimal_table   = generate(ParsingTableGenerator::MINIMAL_LR, minimal);
+  auto canonical_table = generate(ParsingTableGenerator::CANONICAL_LR, canonical);
+
+  assert(lalr.conflict_count > 0);
+  assert(minimal.conflict_count == 0 && canonical.conflict_count == 0);
+
+  // only the state of "E -> e." and "F -> e." is split
+  assert(minimal.lalr_state_count == lalr.state_count);
+  assert(minimal.state_count == minimal.minimal_state_count);
+  assert(minimal.state_count == lalr.state_count + 1);
+  assert(canonical.state_count == canonical.lr1_state_count);
+  assert(canonical.state_count >= minimal.state_count);
+
+  for (auto &table : { minimal_table, canonical_table }) {
+    auto root = table->generateParseTree("bed", tokens);
+    assert(root != null && root->children()[1]->termnon() == non_e);
+  }
+
+  // glr follows both reduces of the lalr conflict, also after save and load
+  assert(lalr_table->hasConflicts() && minimal_table->hasConflicts() == false);
+  vector<unsigned char> data;
+  lalr_table->saveBinary(data);
+  ParsingTable loaded(data);
+  assert(loaded.hasConflicts());
+
+  for (auto table : { lalr_table.get(), &loaded }) {
+    auto root = table->generateParseForest("bed", tokens);
+    assert(root != null && root->isAmbiguous() == false);
+    assert(root->children()[1]->termnon()->name == "E");
+  }
+}
+
+// E -> E plus E | n is ambiguous. "n + n + n" has two derivations
+// lookahead merged into a closure after its own closures were added
+// has to reach them too. B -> A x. needs x, which A gets from B -> .A x
+static void _t_closureLookaheads () {
+  auto term_a = make_shared<Terminal>("a", 1);
+  auto term_x = make_shared<Terminal>("x", 2);
+  auto non_a = make_shared<Nonterminal>("A");
+  auto non_b = make_shared<Nonterminal>("B");
+  auto start = make_shared<Nonterminal>("S");
+  start->rules.push_back(Rule(start, { non_a }));
+  non_a->rules.push_back(Rule(non_a, { non_b }));
+  non_a->rules.push_back(Rule(non_a, { term_a }));
+  non_b->rules.push_back(Rule(non_b, { non_a, term_x }));
+
+  vector<Token> tokens = {
+    Token(1, 0, 0, 0, 0, 0),
+    Token(2, 1, 1, 0, 0, 0),
+    Token(2, 2, 2, 0, 0, 0),
+    Token(0, 3, 3, 0, 0, 0),
+  };
+
+  for (auto mode : { ParsingTableGenerator::LALR, ParsingTableGenerator::MINIMAL_LR,
+      ParsingTableGenerator::CANONICAL_LR }) {
+    ParsingTableGenerator generator;
+    generator.addSymbol(start, true);
+    generator.addSymbol(non_a);
+    generator.addSymbol(non_b);
+    generator.lr_mode(mode);
+    auto table = generator.generateTable();
+    assert(table != null && generator.stats().conflict_count == 0);
+    assert(table->generateParseTree("axx", tokens) != null);
+  }
+}
+
+static void _t_minimizeStates () {
+  auto term_a = make_shared<Terminal>("a", 1);
+  auto term_b = make_shared<Terminal>("b", 2);
+  auto term_c = make_shared<Terminal>("c", 3);
+  auto non_a = make_shared<Nonterminal>("A");
+  auto start = make_shared<Nonterminal>("S");
+  auto s_prime = make_shared<Nonterminal>("S'");
+  s_prime->rules.push_back(Rule(s_prime, { start }));
+  start->rules.push_back(Rule(start, { term_a, non_a }));
+  start->rules.push_back(Rule(start, { term_b, non_a }));
+  non_a->rules.push_back(Rule(non_a, { term_c }));
+
+  // lalr table of the grammar, except "b" goes to copies of states 1 and 4
+  using Info = ParsingTable::ActionInfo;
+  vector<map<shared_ptr<TerminalBase>, Info>> actions = {
+    { { term_a, Info(Info::SHIFT, 1) }, { term_b, Info(Info::SHIFT, 2) }, { start, Info(Info::GOTO, 3) } },
+    { { term_c, Info(Info::SHIFT, 4) }, { non_a, Info(Info::GOTO, 5) } },
+    { { term_c, Info(Info::SHIFT, 7) }, { non_a, Info(Info::GOTO, 6) } },
+    { { null, Info(Info::ACCEPT, 0) } },
+    { { null, Info(Info::REDUCE, 3) } },
+    { { null, Info(Info::REDUCE, 1) } },
+    { { null, Info(Info::REDUCE, 2) } },
+    { { null, Info(Info::REDUCE, 3) } },
+  };
+  ParsingTable table({ start, non_a }, s_prime, std::move(actions));
+
+  TableSize before, after;
+  auto minimized = table.minimizeStates(&before, &after);
+  assert(minimized != null);
+  assert(before.state_count == 8 && before.unique_row_count == 7);
+  assert(after.state_count == 7 && after.unique_row_count == 7);
+  assert(after.cell_count == before.cell_count - 1);
+
+  // states 1 and 2 differ by goto, so they stay
+  vector<Token> tokens = {
+    Token(2, 0, 0, 0, 0, 0),
+    Token(3, 1, 1, 0, 0, 0),
+    Token(0, 2, 2, 0, 0, 0),
+  };
+  auto tree = table.generateParseTree("bc", tokens);
+  auto minimized_tree = minimized->generateParseTree("bc", tokens);
+  assert(tree != null && minimized_tree != null);
+  assert(tree->toString("bc", 0, true) == minimized_tree->toString("bc", 0, true));
+
+  // nothing more to merge
+  TableSize again;
+  minimized->minimizeStates(null, &again);
+  assert(again.state_count == after.state_count);
+}
+
+static void _t_cppSource () {
+  auto term_a = make_shared<Terminal>("a", 1);
+  auto term_c = make_shared<Terminal>("c", 3);
+  auto non_a = make_shared<Nonterminal>("A");
+  auto start = make_shared<Nonterminal>("S");
+  start->rules.push_back(Rule(start, { term_a, non_a }));
+  non_a->rules.push_back(Rule(non_a, { term_c, non_a }));
+  non_a->rules.push_back(Rule(non_a, { term_c }));
+
+  ParsingTableGenerator generator;
+  generator.addSymbol(start, true);
+  generator.addSymbol(non_a);
+  auto table = generator.generateTable();
+  assert(table != null);
+
+  auto source = table->toCppSource("SmallParser");
+  assert(source.find("class SmallParser {") != string::npos);
+  assert(source.find("goto *state_labels[state]") != string::npos);
+
+  // a label per state, reduces only for rules that are reduced
+  for (int si=0; si<table->state_count(); ++si)
+    assert(source.find("state_" + std::to_string(si) + ":") != string::npos);
+  assert(source.find("state_" + std::to_string(table->state_count()) + ":") == string::npos);
+  assert(source.find("reduce_0:") == string::npos);
+  assert(source.find("reduce_1:") != string::npos && source.find("reduce_2:") != string::npos);
+  assert(source.find("stack_[base + 1].node") != string::npos);
+  assert(source.find("\"c\", 3") != string::npos);
+
+  assert(table->toCppSource("Small Parser").empty());
+}
+
+static void _t_parseContext () {
+  auto term_a = make_shared<Terminal>("a", 1);
+  auto term_c = make_shared<Terminal>("c", 3);
+  auto non_a = make_shared<Nonterminal>("A");
+  auto start = make_shared<Nonterminal>("S");
+  start->rules.push_back(Rule(start, { term_a, non_a }));
+  non_a->rules.push_back(Rule(non_a, { term_c, non_a }));
+  non_a->rules.push_back(Rule(non_a, { term_c }));
+
+  ParsingTableGenerator generator;
+  generator.addSymbol(start, true);
+  generator.addSymbol(non_a);
+  auto table = generator.generateTable();
+  assert(table != null);
+
+  vector<Token> tokens = { Token(1, 0, 0, 0, 0, 0) };
+  for (int ti=1; ti<=300; ++ti)
+    tokens.push_back(Token(3, ti, ti, 0, 0, 0));
+  tokens.push_back(Token(0, 301, 301, 0, 0, 0));
+  auto text = "a" + string(300, 'c') + " ";
+
+  auto owned_tree = table->generateParseTree(text.c_str(), tokens);
+  auto expected = owned_tree->toString(text.c_str(), 0, true);
+
+  // first parse fills capacity, later ones allocate nothing
+  ParseContext context;
+  assert(table->generateParseTree(text.c_str(), tokens, context) != null);
+  size_t alloc_begin = g_alloc_count;
+  shared_ptr<Node> tree;
+  for (int ri=0; ri<3; ++ri)
+    tree = table->generateParseTree(text.c_str(), tokens, context);
+  assert(g_alloc_count == alloc_begin);
+  assert(tree != null && context.error().empty());
+  assert(context.node_count() == 2 + 300 * 2);   // a, c and A per c, S
+  assert(tree->toString(text.c_str(), 0, true) == expected);
+
+  // nodes take other roles for other input, capacities only grow
+  vector<Token> short_tokens = { tokens[0], tokens[1], tokens.back() };
+  tree = table->generateParseTree(text.c_str(), short_tokens, context);
+  assert(tree != null && tree->children().size() == 2);
+  alloc_begin = g_alloc_count;
+  table->generateParseTree(text.c_str(), tokens, context);
+  tree = table->generateParseTree(text.c_str(), short_tokens, context);
+  assert(g_alloc_count == alloc_begin);
+  assert(tree->toString(text.c_str(), 0, true) == table->generateParseTree(text.c_str(), short_tokens)->toString(text.c_str(), 0, true));
+
+  // error is kept in the context
+  vector<Token> bad_tokens = { tokens[1], tokens.back() };
+  assert(table->generateParseTree(text.c_str(), bad_tokens, context) == null);
+  assert(context.error().empty() == false);
+  assert(table->generateParseTree(text.c_str(), tokens, context) != null && context.error().empty());
+
+  // position of the error is counted from the text before it
+  vector<Token> line_tokens = { Token(1, 0, 0, 0, 0, 0), Token(1, 5, 5, 0, 1, 2), Token(0, 6, 6, 0, 2, 2) };
+  assert(table->generateParseTree("a\nc\nca ", line_tokens, context) == null);
+  assert(context.error().ends_with(" idx:5 line:2 column:1"));
+}
+
+static void _t_tokenStream () {
+  // ring keeps order across wrap around
+  SpscRing<int> ring(5);
+  assert(ring.capacity() == 8);
+  vector<int> popped;
+  auto pop = [&popped](int &&value) { popped.push_back(value); };
+  for (int round=0; round<3; ++round) {
+    for (int i=0; i<8; ++i)
+      assert(ring.tryPush(round * 8 + i));
+    assert(ring.tryPush(-1) == false);
+    assert(ring.tryPop(pop, 3) == 3);
+    assert(ring.tryPop(pop, 100) == 5);
+    assert(ring.tryPop(pop, 100) == 0);
+  }
+  for (int i=0; i<popped.size(); ++i)
+    assert(popped[i] == i);
+
+  // two threads through a small ring
+  SpscRing<int> small_ring(4);
+  const int count = 200000;
+  std::thread producer([&small_ring]() {
+    for (int i=0; i<count; )
+      i += small_ring.tryPush(i)? 1: 0;
+  });
+  int next = 0;
+  bool is_ordered = true;
+  while (next < count) {
+    small_ring.tryPop([&](int &&value) {
+      is_ordered = is_ordered && value == next;
+      ++next;
+    }, 64);
+  }
+  producer.join();
+  assert(is_ordered);
+
+  // pipelined parse matches the parse of a token vector
+  auto term_a = make_shared<Terminal>("a", 1);
+  auto term_c = make_shared<Terminal>("c", 3);
+  auto non_a = make_shared<Nonterminal>("A");
+  auto start = make_shared<Nonterminal>("S");
+  start->rules.push_back(Rule(start, { term_a, non_a }));
+  non_a->rules.push_back(Rule(non_a, { term_c, non_a }));
+  non_a->rules.push_back(Rule(non_a, { term_c }));
+
+  ParsingTableGenerator generator;
+  generator.addSymbol(start, true);
+  generator.addSymbol(non_a);
+  auto table = generator.generateTable();
+  assert(table != null);
+
+  auto text = "a" + string(1000, 'c') + " ";
+  vector<Token> tokens;
+  for (int ti=0; ti<text.size(); ++ti)
+    tokens.push_back(Token((ti == 0)? 1: (ti == text.size() - 1)? 0: 3, ti, ti, 0, 0, 0));
+  auto expected = table->generateParseTree(text.c_str(), tokens)->toString(text.c_str(), 0, true);
+
+  // tiny ring, so the lexer waits for the parser
+  TokenStream stream(8);
+  ParseContext context;
+  auto lexer = [&text](TokenStream &out) {
+    for (int ti=0; ti<text.size(); ++ti) {
+      int type = (text[ti] == 'a')? 1: (text[ti] == 'c')? 3: 0;
+      if (out.push(Token(type, ti, ti, 0, 0, 0)) == false)
+        return;
+    }
+  };
+  auto tree = table->generateParseTreePipelined(text.c_str(), lexer, stream, context);
+  assert(tree != null && tree->toString(text.c_str(), 0, true) == expected);
+  assert(stream.size() == tokens.size());
+
+  // parse that fails early stops the lexer
+  auto bad_lexer = [](TokenStream &out) {
+    for (int ti=0; ti<100000; ++ti) {
+      if (out.push(Token(3, ti, ti, 0, 0, 0)) == false)
+        return;
+    }
+  };
+  assert(table->generateParseTreePipelined(text.c_str(), bad_lexer, stream, context) == null);
+
+  // cancelled stream is reset by the next call
+  tree = table->generateParseTreePipelined(text.c_str(), lexer, stream, context);
+  assert(tree != null && tree->toString(text.c_str(), 0, true) == expected);
+}
+
+// key: value lines and key: blocks, indented
+// with_empty_values adds KV -> key colon nl, so rules differ
+static shared_ptr<ParsingTable> _makeConfigTable (bool with_empty_values = false) {
+  auto term_key    = make_shared<Terminal>("key", 1);
+  auto term_colon  = make_shared<Terminal>("colon", 2);
+  auto term_value  = make_shared<Terminal>("value", 3);
+  auto term_nl     = make_shared<Terminal>("nl", 4);
+  auto term_indent = make_shared<Terminal>("indent", 5);
+  auto term_dedent = make_shared<Terminal>("dedent", 6);
+
+  auto start = make_shared<Nonterminal>("S");
+  auto non_map = make_shared<Nonterminal>("MAP");
+  auto non_kv = make_shared<Nonterminal>("KV");
+  start->rules.push_back(Rule(start, { non_map }));
+  non_map->rules.push_back(Rule(non_map, { non_kv, non_map }));
+  non_map->rules.push_back(Rule(non_map, { non_kv }));
+  non_kv->rules.push_back(Rule(non_kv, { term_key, term_colon, term_value, term_nl }));
+  non_kv->rules.push_back(Rule(non_kv, { term_key, term_colon, term_nl, term_indent, non_map, term_dedent }));
+  if (with_empty_values == true)
+    non_kv->rules.push_back(Rule(non_kv, { term_key, term_colon, term_nl }));
+
+  ParsingTableGenerator generator;
+  generator.addSymbol(start, true);
+  generator.addSymbol(non_map);
+  generator.addSymbol(non_kv);
+  return generator.generateTable();
+}
+
+// key_count top-level keys, every third with a nested block of 3 keys.
+// values are value_of(key idx)
+static void _makeConfigTokens (
+    int key_count,
+    const std::function<string(int)> &value_of,
+    vector<Token> &tokens,
+    string &text,
+    vector<int> &nested_key_idxs) {
+  int line = 0;
+  auto push = [&](int type, const string &str, unsigned int column) {
+    tokens.push_back(Token(type, text.size(), text.size() + str.size() - 1, 0, column, line));
+    text += str;
+  };
+  for (int ki=0; ki<key_count; ++ki) {
+    push(1, "k", 0);
+    push(2, ":", 1);
+    if (ki % 3 != 0) {
+      push(3, value_of(ki), 2);
+      push(4, "\n", 3);
+      ++line;
+      continue;
+    }
+    push(4, "\n", 2);
+    ++line;
+    push(5, " ", 0);
+    for (int ni=0; ni<3; ++ni) {
+      nested_key_idxs.push_back(tokens.size());
+      push(1, "n", 2);
+      push(2, ":", 3);
+      push(3, value_of(ki), 4);
+      push(4, "\n", 5);
+      ++line;
+    }
+    push(6, " ", 1);
+  }
+  tokens.push_back(Token(0, text.size(), text.size(), 0, 0, line));
+  text += " ";
+}
+
+static void _t_parallelParse () {
+  auto table = _makeConfigTable();
+  assert(table != null);
+
+  vector<Token> tokens;
+  string text;
+  vector<int> nested_key_idxs;
+  _makeConfigTokens(40, [](int) { return "v"; }, tokens, text, nested_key_idxs);
+
+  auto expected = table->generateParseTree(text.c_str(), tokens)->toString(text.c_str(), 0, true);
+
+  auto begins = ParsingTable::findChunkBegins(tokens, 4);
+  assert(begins.size() == 3);
+  for (auto begin : begins)
+    assert(tokens[begin].type == 1 && tokens[begin].column == 0);
+
+  bool is_parallel = false;
+  auto tree = table->generateParseTreeParallel(text.c_str(), tokens, "MAP", begins, 4, &is_parallel);
+  assert(tree != null && is_parallel);
+  assert(tree->toString(text.c_str(), 0, true) == expected);
+
+  // lookahead tokens of reduced nodes match too
+  vector<unsigned char> expected_data, data;
+  assert(table->saveTree(*table->generateParseTree(text.c_str(), tokens), tokens, expected_data));
+  assert(table->saveTree(*tree, tokens, data));
+  assert(data == expected_data);
+
+  // a nested key is not a document, so it falls back
+  vector<int> bad_begins = { begins[0], nested_key_idxs[nested_key_idxs.size() / 2] };
+  std::sort(bad_begins.begin(), bad_begins.end());
+  tree = table->generateParseTreeParallel(text.c_str(), tokens, "MAP", bad_begins, 2, &is_parallel);
+  assert(tree != null && is_parallel == false);
+  assert(tree->toString(text.c_str(), 0, true) == expected);
+}
+
+static void _t_greenTree () {
+  auto table = _makeConfigTable();
+  assert(table != null);
+
+  vector<Token> tokens, same_tokens, other_tokens;
+  string text, same_text, other_text;
+  vector<int> nested_key_idxs;
+  _makeConfigTokens(40, [](int) { return "v"; }, tokens, text, nested_key_idxs);
+  _makeConfigTokens(40, [](int) { return "v"; }, same_tokens, same_text, nested_key_idxs);
+  _makeConfigTokens(40, [](int ki) { return (ki == 20)? "w": "v"; }, other_tokens, other_text, nested_key_idxs);
+
+  auto tree = table->generateParseTree(text.c_str(), tokens);
+  auto same_tree = table->generateParseTree(same_text.c_str(), same_tokens);
+  auto other_tree = table->generateParseTree(other_text.c_str(), other_tokens);
+  assert(tree != null && same_tree != null && other_tree != null);
+
+  // repeated blocks are one node
+  GreenInterner interner;
+  auto root = interner.intern(*tree, text.c_str());
+  int node_count = 0;
+  vector<const Node*> leaves;
+  NodeWalker walker;
+  walker.walk(*tree, [&](const Node &node, int) {
+    ++node_count;
+    if (node.children().empty())
+      leaves.push_back(&node);
+    return true;
+  });
+  assert(interner.request_count() == node_count);
+  assert(interner.size() * 4 < node_count);
+  assert(root->width() == tokens[tokens.size() - 2].last_idx + 1);
+
+  // same document is the same root, a changed one shares all but the
+  // changed leaf and the nodes above it
+  auto interned_size = interner.size();
+  assert(interner.intern(*same_tree, same_text.c_str()) == root);
+  assert(interner.size() == interned_size);
+  auto other_root = interner.intern(*other_tree, other_text.c_str());
+  assert(other_root != root);
+  assert(interner.size() - interned_size == 1 + 1 + 21 + 1);   // w, KV, MAPs of keys 0..20, S
+
+  // cursor finds the offsets of the tokens again
+  GreenCursor cursor(root);
+  int leaf_idx = 0;
+  do {
+    auto node = cursor.node();
+    if (node->isLeaf() == false)
+      continue;
+    auto token = leaves[leaf_idx++]->token();
+    assert(cursor.textOffset() == token->first_idx);
+    assert(node->text() == text.substr(token->first_idx, token->last_idx + 1 - token->first_idx));
+  } while (cursor.gotoNext());
+  assert(leaf_idx == leaves.size());
+
+  assert(cursor.depth() == 0 && cursor.gotoFirstChild() && cursor.depth() == 1);
+  assert(cursor.gotoParent() && cursor.gotoParent() == false);
+
+  // text of P -> E x, E -> , starts at x
+  auto term_x = make_shared<Terminal>("x", 1);
+  auto non_e = make_shared<Nonterminal>("E");
+  auto non_p = make_shared<Nonterminal>("P");
+  auto leaf_x = interner.intern(term_x, -1, "x", 2, {});
+  auto epsilon = interner.intern(non_e, 0, "", 0, {});
+  auto parent = interner.intern(non_p, 1, "", 0, { epsilon, leaf_x });
+  assert(interner.intern(term_x, -1, string("x"), 2, {}) == leaf_x);
+  GreenCursor epsilon_cursor(parent);
+  assert(epsilon_cursor.textOffset() == 2);
+  assert(epsilon_cursor.gotoFirstChild() && epsilon_cursor.textOffset() == 0);
+}
+
+static void _t_glrAmbiguous () {
+  auto term_n    = make_shared<Terminal>("n", 1);
+  auto term_plus = make_shared<Terminal>("plus", 2);
+
+  auto non_e = make_shared<Nonterminal>("E");
+  auto start = make_shared<Nonterminal>("S");
+  start->rules.push_back(Rule(start, { non_e }));
+  non_e->rules.push_back(Rule(non_e, { non_e, term_plus, non_e }));
+  non_e->rules.push_back(Rule(non_e, { term_n }));
+
+  ParsingTableGenerator generator;
+  generator.addSymbol(start, true);
+  generator.addSymbol(non_e);
+  auto table = generator.generateTable();
+  assert(table->hasConflicts());
+
+  vector<Token> tokens;
+  for (int ti=0; ti<5; ++ti)
+    tokens.push_back(Token((ti % 2 == 0)? 1: 2, ti, ti, 0, 0, 0));
+  tokens.push_back(Token(0, 5, 5, 0, 0, 0));
+
+  auto root = table->generateParseForest("n+n+n", tokens);
+  assert(root != null && root->termnon() == start);
+
+  auto e = root->children()[0];
+  assert(e->isAmbiguous() && e->alternatives().size() == 1);
+
+  // (n+n)+n and n+(n+n)
+  auto alt = e->alternatives()[0];
+  assert(e->children().size() == 3 && alt->children().size() == 3);
+  assert(e->children()[0]->children().size() != alt->children()[0]->children().size());
+
+  // "n + n" has one derivation
+  vector<Token> short_tokens(tokens.begin(), tokens.begin() + 3);
+  short_tokens.push_back(Token(0, 3, 3, 0, 0, 0));
+  auto short_root = table->generateParseForest("n+n", short_tokens);
+  assert(short_root != null && short_root->children()[0]->isAmbiguous() == false);
+
+  // heads are bounded
+  assert(table->generateParseForest("n+n+n", tokens, 1) == null);
+}
+
+static void _t_nodeTraversal () {
+  auto term_a = make_shared<Terminal>("a", 1);
+  auto non_l  = make_shared<Nonterminal>("L");
+  const char *text = "aa";
+
+  Token::to_string_func = [](const char *text, const Token *t) {
+    return string("Token(") + text[t->first_idx] + ")";
+  };
+
+  Token t0(1, 0, 0, 0, 0, 0), t1(1, 1, 1, 0, 0, 0);
+  auto root  = make_shared<Node>(non_l, &t0);
+  auto inner = make_shared<Node>(non_l, &t0);
+  inner->addChild(make_shared<Node>(term_a, &t0));
+  root->addChild(inner);
+  root->addChild(make_shared<Node>(term_a, &t1));
+
+  // children keep indent_inc
+  auto str = root->toString(text, 0, true, 4);
+  assert(str ==
+      "Nonterminal(\"L\")\n"
+      "|---Nonterminal(\"L\")\n"
+      "|---|---Terminal(\"a\", Token(a))\n"
+      "|---Terminal(\"a\", Token(a))");
+
+  stringstream ss;
+  root->print(ss, text, 0, true, 4);
+  assert(ss.str() == str);
+
+  string buffer = ">";
+  root->appendTo(buffer, text, 0, true, 4);
+  assert(buffer == ">" + str);
+
+  // append_func writes tokens in place, to_string_func isn't called then
+  int to_string_count = 0;
+  Token::to_string_func = [&to_string_count](const char *text, const Token *t) {
+    ++to_string_count;
+    return string();
+  };
+  Token::append_func = [](string &buffer, const char *text, const Token *t) {
+    buffer += "Token(";
+    buffer += text[t->first_idx];
+    buffer += ')';
+  };
+  buffer.clear();
+  root->appendTo(buffer, text, 0, true, 4);
+  stringstream append_ss;
+  root->print(append_ss, text, 0, true, 4);
+  assert(buffer == str && append_ss.str() == str && to_string_count == 0);
+  Token::append_func = null;
+  Token::to_string_func = [](const char *text, const Token *t) {
+    return string("Token(") + text[t->first_idx] + ")";
+  };
+
+  // pre and post order
+  string order;
+  NodeWalker walker;
+  walker.walk(*root,
+      [&](const Node &node, int depth) {
+        order += "<" + to_string(depth) + node.termnon()->name;
+        return true;
+      },
+      [&](const Node &node, int depth) {
+        order += ">";
+      });
+  assert(order == "<0L<1L<2a>><1a>>");
+
+  // skipped children still get post
+  order.clear();
+  walker.walk(*root,
+      [&](const Node &node, int depth) {
+        order += node.termnon()->name;
+        return depth == 0;
+      },
+      [&](const Node &node, int depth) {
+        order += "/";
+      });
+  assert(order == "LL/a//");
+
+  // deep trees don't recurse
+  auto deep = make_shared<Node>(non_l, &t0);
+  auto last = deep;
+  for (int di=0; di<200000; ++di) {
+    auto next = make_shared<Node>(non_l, &t0);
+    last->addChild(next);
+    last = next;
+  }
+  int max_depth = 0;
+  walker.walk(*deep, [&](const Node &node, int depth) {
+    max_depth = std::max(max_depth, depth);
+    return true;
+  });
+  assert(max_depth == 200000);
+
+  // free from the root down, releasing the whole chain at once would recurse
+  vector<shared_ptr<Node>> chain;
+  for (auto node = deep; node != null; ) {
+    chain.push_back(node);
+    node = node->children().empty()? null: node->children()[0];
+  }
+  deep = last = null;
+  for (auto &node : chain)
+    node = null;
+}
+
+static void _t_tokenBuffer () {
+  TokenBuffer buffer;
+  assert(buffer.push(70000, 0, 0) == false);
+
+  // positions beyond 16 bits and jumps which don't fit a delta
+  vector<Token> tokens;
+  for (int ti=0; ti<1000; ++ti) {
+    unsigned int line = ti * 100;
+    if (ti == 500)
+      line = 5000000;
+    tokens.push_back(Token(ti % 7, ti * 3, ti * 3 + 1, ti % 9, (ti * 37) % 300, line));
+    assert(buffer.push(tokens.back()) == true);
+  }
+  assert(buffer.size() == tokens.size());
+
+  auto same = [](const Token &a, const Token &b) {
+    return a.type == b.type && a.first_idx == b.first_idx && a.last_idx == b.last_idx
+        && a.indent == b.indent && a.column == b.column && a.line == b.line;
+  };
+  for (int ti=0; ti<tokens.size(); ++ti) {
+    assert(same(buffer.at(ti), tokens[ti]));
+    assert(same(*buffer.token(ti), tokens[ti]));
+  }
+  assert(buffer.line(999) == 99900 && buffer.line(500) == 5000000);
+
+  // made tokens don't move when pushed after
+  auto last = buffer.token(999);
+  for (int ti=0; ti<600; ++ti)
+    buffer.push(1, ti, ti, 0, 0, 200000);
+  assert(last == buffer.token(999) && same(*last, tokens[999]));
+  assert(buffer.token(1599)->line == 200000 && buffer.token(1000)->first_idx == 0);
+
+  // without positions
+  TokenBuffer types_only(false);
+  types_only.push(3, 10, 12, 4, 5, 6);
+  assert(types_only.type(0) == 3 && types_only.last_idx(0) == 12 && types_only.line(0) == 0);
+}
+
+static void _t_lineIndex () {
+  const char *text = "a: 1\r\n  b:\n\t\tc\n\nlast";
+  LineIndex index(text);
+  assert(index.line_count() == 5);
+  assert(index.lineStart(1) == 6 && index.lineStart(4) == 16);
+
+  auto pos = index.position(0);
+  assert(pos.line == 0 && pos.column == 0 && pos.indent == 0);
+  pos = index.position(4);  // '\r' stays on its line
+  assert(pos.line == 0 && pos.column == 4);
+  pos = index.position(8);
+  assert(pos.line == 1 && pos.column == 2 && pos.indent == 2);
+  pos = index.position(13);
+  assert(pos.line == 2 && pos.column == 2 && pos.indent == 2);
+  pos = index.position(15);
+  assert(pos.line == 3 && pos.column == 0 && pos.indent == 0);
+  pos = index.position(1000);  // clamped to end
+  assert(pos.line == 4 && pos.column == 4);
+
+  // length limits the text
+  LineIndex first_line(text, 4);
+  assert(first_line.line_count() == 1 && first_line.lineOf(10) == 0);
+
+  LineIndex empty(null);
+  assert(empty.line_count() == 1 && empty.position(0).line == 0);
+}
+
+static void _t_parsingTableCache () {
+  // same grammar made again from new objects, like another process would
+  auto make_generator = [](int c_type, ParsingTableGenerator::LrMode mode) {
+    auto term_a = make_shared<Terminal>("a", 1);
+    auto term_c = make_shared<Terminal>("c", c_type);
+    auto non_l = make_shared<Nonterminal>("L");
+    auto start = make_shared<Nonterminal>("S");
+    start->rules.push_back(Rule(start, { non_l, term_c }));
+    non_l->rules.push_back(Rule(non_l, { non_l, term_a }));
+    non_l->rules.push_back(Rule(non_l, { term_a }));
+
+    auto generator = make_shared<ParsingTableGenerator>();
+    generator->addSymbol(start, true);
+    generator->addSymbol(non_l);
+    generator->lr_mode(mode);
+    return std::make_pair(generator, vector<shared_ptr<Nonterminal>>{ start, non_l });
+  };
+
+  auto first = make_generator(3, ParsingTableGenerator::LALR);
+  auto again = make_generator(3, ParsingTableGenerator::LALR);
+  auto fingerprint = first.first->fingerprint();
+  assert(fingerprint == again.first->fingerprint());
+  assert(fingerprint != make_generator(4, ParsingTableGenerator::LALR).first->fingerprint());
+  assert(fingerprint != make_generator(3, ParsingTableGenerator::CANONICAL_LR).first->fingerprint());
+
+  auto directory = (std::filesystem::temp_directory_path() / "lalr_parsergen_cache_test").string();
+  std::filesystem::remove_all(directory);
+
+  ParsingTableCache cache(directory);
+  auto generated = cache.generateTable(*first.first);
+  assert(generated != null && cache.miss_count() == 1 && cache.hit_count() == 0);
+  assert(std::filesystem::exists(cache.path(fingerprint)));
+
+  auto cached = cache.generateTable(*again.first);
+  assert(cached != null && cache.hit_count() == 1);
+  assert(cached->isEquivalent(*generated));
+
+  vector<Token> tokens = {
+    Token(1, 0, 0, 0, 0, 0),
+    Token(1, 1, 1, 0, 0, 0),
+    Token(3, 2, 2, 0, 0, 0),
+    Token(0, 3, 3, 0, 0, 0),
+  };
+  assert(cached->generateParseTree("aac", tokens) != null);
+
+  // broken file is not used
+  {
+    std::fstream fs(cache.path(fingerprint), std::ios::in | std::ios::out | std::ios::binary);
+    fs.seekp(40);
+    fs.put('x');
+  }
+  auto regenerated = cache.generateTable(*again.first);
+  assert(regenerated != null && cache.miss_count() == 2);
+  assert(cache.load(fingerprint) != null);
+
+  std::filesystem::remove_all(directory);
+}
+
+static void _t_treeSerialization () {
+  auto table = _makeConfigTable();
+  assert(table != null);
+
+  vector<Token> tokens, other_tokens;
+  string text, other_text;
+  vector<int> nested_key_idxs;
+  _makeConfigTokens(40, [](int) { return "v"; }, tokens, text, nested_key_idxs);
+  _makeConfigTokens(40, [](int ki) { return (ki == 20)? "ww": "v"; }, other_tokens, other_text, nested_key_idxs);
+  auto tree = table->generateParseTree(text.c_str(), tokens);
+  assert(tree != null);
+  auto expected = tree->toString(text.c_str(), 0, true);
+
+  // same tree and tokens back, about 2 bytes a node
+  vector<unsigned char> data;
+  assert(table->saveTree(*tree, tokens, data));
+  assert(data.size() < tokens.size() * 10);
+  auto loaded = table->loadTree(data.data(), data.size());
+  assert(loaded != null && loaded->tokens.size() == tokens.size());
+  for (int ti=0; ti<tokens.size(); ++ti) {
+    auto &t = tokens[ti], &l = loaded->tokens[ti];
+    assert(t.type == l.type && t.first_idx == l.first_idx && t.last_idx == l.last_idx);
+    assert(t.indent == l.indent && t.column == l.column && t.line == l.line);
+  }
+  assert(loaded->root->toString(text.c_str(), 0, true) == expected);
+  assert(loaded->root->children()[0]->token() == &loaded->tokens.back());
+
+  // cut, or saved with other rules
+  assert(table->loadTree(data.data(), data.size() - 1) == null);
+  auto changed = data;
+  changed[0] ^= 1;
+  assert(table->loadTree(changed.data(), changed.size()) == null);
+
+  // cache next to the source is used while the text is the same
+  auto source_path = (std::filesystem::temp_directory_path() / "lalr_parsergen_tree_test.txt").string();
+  std::filesystem::remove(ParseTreeCache::path(source_path));
+  ParseTreeCache cache(table);
+  int lex_count = 0;
+  auto lex = [&](const string &source, vector<Token> &result) {
+    ++lex_count;
+    result = (source == text)? tokens: other_tokens;
+    return true;
+  };
+
+  auto first = cache.generateParseTree(source_path, text, lex);
+  assert(first != null && lex_count == 1 && cache.miss_count() == 1);
+  assert(std::filesystem::exists(ParseTreeCache::path(source_path)));
+
+  auto cached = cache.generateParseTree(source_path, text, lex);
+  assert(cached != null && lex_count == 1 && cache.hit_count() == 1);
+  assert(cached->root->toString(text.c_str(), 0, true) == expected);
+
+  auto other = cache.generateParseTree(source_path, other_text, lex);
+  assert(other != null && lex_count == 2 && cache.miss_count() == 2);
+  assert(other->root->toString(other_text.c_str(), 0, true) != expected);
+  assert(cache.load(source_path, text.c_str(), text.size()) == null);
+  assert(cache.load(source_path, other_text.c_str(), other_text.size()) != null);
+
+  // a table of other rules misses without reading the tree
+  auto other_table = _makeConfigTable(true);
+  assert(other_table != null && other_table->treeKey() != table->treeKey());
+  ParseTreeCache other_cache(other_table);
+  assert(other_cache.load(source_path, other_text.c_str(), other_text.size()) == null);
+
+  std::filesystem::remove(ParseTreeCache::path(source_path));
+}
+
+static void _t_entrySymbols () {
+  auto term_key    = make_shared<Terminal>("key", 1);
+  auto term_colon  = make_shared<Terminal>("colon", 2);
+  auto term_value  = make_shared<Terminal>("value", 3);
+  auto term_nl     = make_shared<Terminal>("nl", 4);
+  auto term_indent = make_shared<Terminal>("indent", 5);
+  auto term_dedent = make_shared<Terminal>("dedent", 6);
+
+  auto start = make_shared<Nonterminal>("S");
+  auto non_map = make_shared<Nonterminal>("MAP");
+  auto non_kv = make_shared<Nonterminal>("KV");
+  start->rules.push_back(Rule(start, { non_map }));
+  non_map->rules.push_back(Rule(non_map, { non_kv, non_map }));
+  non_map->rules.push_back(Rule(non_map, { non_kv }));
+  non_kv->rules.push_back(Rule(non_kv, { term_key, term_colon, term_value, term_nl }));
+  non_kv->rules.push_back(Rule(non_kv, { term_key, term_colon, term_nl, term_indent, non_map, term_dedent }));
+
+  auto make_table = [&](const shared_ptr<Nonterminal> &start_symbol, bool with_entries) {
+    ParsingTableGenerator generator;
+    generator.addSymbol(start, start_symbol == start);
+    generator.addSymbol(non_map, start_symbol == non_map);
+    generator.addSymbol(non_kv, start_symbol == non_kv);
+    if (with_entries == true) {
+      generator.addEntrySymbol(non_map);
+      generator.addEntrySymbol(non_kv);
+      generator.addEntrySymbol(start);
+      assert(generator.rule_count() == 8);
+    }
+    return generator.generateTable();
+  };
+  auto table = make_table(start, true);
+  auto map_table = make_table(non_map, false);
+  auto kv_table = make_table(non_kv, false);
+  assert(table != null && map_table != null && kv_table != null);
+  assert(table->entryState("S") == 0 && table->entryState("KV") > 0 && table->entryState("x") < 0);
+
+  // one automaton is smaller than a table per entry
+  auto single_table = make_table(start, false);
+  assert(table->state_count() < single_table->state_count() + map_table->state_count() + kv_table->state_count());
+
+  vector<Token> tokens;
+  string text;
+  vector<int> nested_key_idxs;
+  _makeConfigTokens(7, [](int) { return "v"; }, tokens, text, nested_key_idxs);
+  // key 1 has a value, key 0 a nested block of 3 keys
+  vector<Token> kv_tokens(tokens.begin() + 17, tokens.begin() + 21);
+  assert(kv_tokens[0].type == 1 && kv_tokens[2].type == 3);
+  kv_tokens.push_back(Token(0, kv_tokens[3].last_idx + 1, kv_tokens[3].last_idx + 1, 0, 0, kv_tokens[3].line + 1));
+
+  // same trees as separate tables
+  auto expected = single_table->generateParseTree(text.c_str(), tokens)->toString(text.c_str(), 0, true);
+  auto expected_map = map_table->generateParseTree(text.c_str(), tokens)->toString(text.c_str(), 0, true);
+  auto expected_kv = kv_table->generateParseTree(text.c_str(), kv_tokens)->toString(text.c_str(), 0, true);
+  assert(table->generateParseTree(text.c_str(), tokens)->toString(text.c_str(), 0, true) == expected);
+  assert(table->generateEntryParseTree("S", text.c_str(), tokens)->toString(text.c_str(), 0, true) == expected);
+  auto map_tree = table->generateEntryParseTree("MAP", text.c_str(), tokens);
+  assert(map_tree != null && map_tree->termnon() == non_map);
+  assert(map_tree->toString(text.c_str(), 0, true) == expected_map);
+
+  ParseContext context;
+  context.prints_errors(false);
+  auto kv_tree = table->generateEntryParseTree("KV", text.c_str(), kv_tokens, context);
+  assert(kv_tree != null && kv_tree->toString(text.c_str(), 0, true) == expected_kv);
+  assert(table->generateEntryParseTree("KV", text.c_str(), tokens, context) == null);
+  assert(table->generateEntryParseTree("x", text.c_str(), kv_tokens, context) == null);
+
+  // entries survive saving and state changes
+  vector<unsigned char> data;
+  assert(table->saveBinary(data));
+  ParsingTable loaded(data);
+  assert(loaded.isEquivalent(*table) && loaded.entryState("KV") == table->entryState("KV"));
+  auto minimized = table->minimizeStates();
+  assert(minimized->isEquivalent(*table));
+  vector<int> order(table->state_count());
+  for (int si=0; si<order.size(); ++si)
+    order[si] = (si == 0)? 0: order.size() - si;
+  auto renumbered = table->renumberStates(order);
+  assert(renumbered->isEquivalent(*table));
+  for (auto &t : { minimized, renumbered }) {
+    assert(t->generateEntryParseTree("KV", text.c_str(), kv_tokens)->toString(text.c_str(), 0, true) == expected_kv);
+    assert(t->generateEntryParseTree("MAP", text.c_str(), tokens)->toString(text.c_str(), 0, true) == expected_map);
+  }
+  assert(loaded.generateEntryParseTree("KV", text.c_str(), kv_tokens)->toString(text.c_str(), 0, true) == expected_kv);
+}
+
 int main () {
   _t_generateParseTree();
   _t_generatePawPrintParsingTable();
+  _t_pawPrintPushSequence();
+  _t_pawPrintArray();
+  _t_pawPrintStringTable();
+  _t_frozenMergerCursor();
+  _t_mapLoader();
+  _t_lrModes();
+  _t_closureLookaheads();
+  _t_minimizeStates();
+  _t_cppSource();
+  _t_parseContext();
+  _t_tokenStream();
+  _t_parallelParse();
+  _t_greenTree();
+  _t_treeSerialization();
+  _t_entrySymbols();
+  _t_glrAmbiguous();
+  _t_nodeTraversal();
+  _t_tokenBuffer();
+  _t_lineIndex();
+  _t_parsingTableCache();
   return 0;
 }